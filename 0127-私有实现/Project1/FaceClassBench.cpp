@@ -0,0 +1,186 @@
+// FaceClassBench.cpp - vector<faceClass> 扩容和排序测试
+// =====================================================
+// 独立的测试程序（有自己的 main，已在项目中排除编译）
+// 对比两种元素类型：
+//   - faceClass   ：有 noexcept 移动构造/赋值，扩容和排序时只是搬指针
+//   - CopyOnlyFace：包一层只允许拷贝的 faceClass，扩容和排序时每次都深拷贝
+// 统计耗时和 operator new 次数（替换了全局 operator new 来计数）
+// 然后对比在打乱顺序的 vector<faceClass> 和 faceClassArray 里查找一个 ID 的耗时
+// 最后测一批对象整体创建/销毁，在 PimplArenaScope 内外各一次（需要 -DFACECLASS_PIMPL_ARENA=1），
+// 以及 1% 的对象比 scope 活得久时留住了多少 chunk
+//
+// Linux 编译（可加 -DFACECLASS_PIMPL_MODE=1 测 INLINE 模式，=2 测 SHARED 模式）：
+//   g++ -std=c++20 -O2 faceClass.cpp faceClassArray.cpp PimplArena.cpp FaceClassBench.cpp -o FaceClassBench
+#include "faceClass.h"
+#include "faceClassArray.h"
+#include "PimplArena.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+static size_t g_allocations = 0;  // 单线程测试，不需要原子
+
+void* operator new(size_t size)
+{
+	++g_allocations;
+	if (void* p = malloc(size ? size : 1)) return p;
+	throw bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	free(p);
+}
+
+// 只有拷贝、没有移动（声明了拷贝操作，编译器就不再生成移动操作）
+struct CopyOnlyFace
+{
+	faceClass face;
+
+	CopyOnlyFace() {}
+	CopyOnlyFace(const CopyOnlyFace& other) : face(other.face) {}
+	CopyOnlyFace& operator=(const CopyOnlyFace& other) { face = other.face; return *this; }
+};
+
+static faceClass& Face(faceClass& f) { return f; }
+static faceClass& Face(CopyOnlyFace& f) { return f.face; }
+
+static const int kCount = 1000000;
+
+template <class T>
+static void Run(const char* name, const vector<int>& ids)
+{
+	vector<T> v;
+
+	// 1. 不预留容量，逐个 push_back，测扩容的代价
+	size_t allocBefore = g_allocations;
+	auto begin = chrono::steady_clock::now();
+	for (int id : ids) {
+		T item;
+		Face(item).setID(id);
+		v.push_back(static_cast<T&&>(item));
+	}
+	auto grown = chrono::steady_clock::now();
+	size_t growAllocs = g_allocations - allocBefore;
+
+	// 2. 按 ID 排序
+	allocBefore = g_allocations;
+	sort(v.begin(), v.end(), [](T& a, T& b) { return Face(a).getID() < Face(b).getID(); });
+	auto sorted = chrono::steady_clock::now();
+	size_t sortAllocs = g_allocations - allocBefore;
+
+	bool ok = true;
+	for (size_t i = 1; i < v.size(); ++i) {
+		if (Face(v[i - 1]).getID() > Face(v[i]).getID()) ok = false;
+	}
+
+	printf("%-14s %12.2f %14.2f %12.2f %14.2f %6s\n", name,
+		chrono::duration<double, milli>(grown - begin).count(), (double)growAllocs / kCount,
+		chrono::duration<double, milli>(sorted - grown).count(), (double)sortAllocs / kCount,
+		ok ? "ok" : "FAIL");
+}
+
+// 查找一个不存在的 ID（必须扫描全部元素）
+static void RunScan(const vector<int>& ids)
+{
+	// 打乱顺序后 innerClass 在堆上的位置和遍历顺序无关，接近长期运行后的状态
+	vector<faceClass> faces(ids.size());
+	for (size_t i = 0; i < ids.size(); ++i) faces[i].setID(ids[i]);
+	shuffle(faces.begin(), faces.end(), mt19937(1));
+
+	faceClassArray arr;
+	arr.reserve(faces.size());
+	for (faceClass& f : faces) arr.push_back(f);
+
+	const int kRounds = 20;
+	const int missing = -1;
+	size_t found = 0;
+
+	auto begin = chrono::steady_clock::now();
+	for (int r = 0; r < kRounds; ++r) {
+		for (faceClass& f : faces) {
+			if (f.getID() == missing) { ++found; break; }
+		}
+	}
+	auto mid = chrono::steady_clock::now();
+	for (int r = 0; r < kRounds; ++r) {
+		if (arr.findID(missing) != faceClassArray::npos) ++found;
+	}
+	auto end = chrono::steady_clock::now();
+
+	double bytes = (double)kRounds * ids.size() * sizeof(int);
+	double faceSec = chrono::duration<double>(mid - begin).count();
+	double arrSec = chrono::duration<double>(end - mid).count();
+	printf("\n扫描查找（%d 轮，found=%zu）\n", kRounds, found);
+	printf("%-22s %10.2f ms %10.2f GB/s\n", "vector<faceClass>", faceSec * 1e3 / kRounds, bytes / faceSec / 1e9);
+	printf("%-22s %10.2f ms %10.2f GB/s\n", "faceClassArray::findID", arrSec * 1e3 / kRounds, bytes / arrSec / 1e9);
+}
+
+// 一批对象一起创建、一起销毁
+static void RunBatch(const char* name, bool useArena)
+{
+	const int kRounds = 5;
+	size_t allocBefore = g_allocations;
+	auto begin = chrono::steady_clock::now();
+	for (int r = 0; r < kRounds; ++r) {
+		PimplArenaScope* scope = useArena ? new PimplArenaScope : nullptr;
+		{
+			vector<faceClass> batch(kCount);
+			for (int i = 0; i < kCount; ++i) batch[i].setID(i);
+		}
+		delete scope;
+	}
+	auto end = chrono::steady_clock::now();
+
+	// vector 本身每轮分配一次，不计入
+	double allocs = (double)(g_allocations - allocBefore - kRounds) / kRounds / kCount;
+	double ms = chrono::duration<double, milli>(end - begin).count() / kRounds;
+	printf("%-22s %10.2f ms %10.4f allocs/el\n", name, ms, allocs);
+}
+
+// 每 100 个留下一个到 scope 之外：幸存者分散在各个 chunk 里，是留住内存最多的情况
+static void RunSurvivors()
+{
+	vector<faceClass> survivors;
+	survivors.reserve(kCount / 100);
+	{
+		PimplArenaScope scope;
+		vector<faceClass> batch(kCount);
+		for (int i = 0; i < kCount; i += 100) survivors.push_back(std::move(batch[i]));
+	}
+	size_t count = survivors.size();
+	double pinned = PimplArena::ChunkBytes() / 1048576.0;
+	survivors.clear();
+	printf("幸存 %zu 个（1%%，分散）    chunk 占用 %.1f MiB，幸存者析构后 %.1f MiB\n",
+		count, pinned, PimplArena::ChunkBytes() / 1048576.0);
+}
+
+int main()
+{
+	vector<int> ids(kCount);
+	mt19937 rng(12345);
+	for (int& id : ids) id = (int)(rng() % 1000000);
+
+	printf("vector 扩容 + 排序（%d 个元素，FACECLASS_PIMPL_MODE=%d）\n", kCount, FACECLASS_PIMPL_MODE);
+	printf("%-14s %12s %14s %12s %14s %6s\n", "type", "grow ms", "grow allocs/el", "sort ms", "sort allocs/el", "");
+	Run<faceClass>("faceClass", ids);
+	Run<CopyOnlyFace>("CopyOnlyFace", ids);
+	RunScan(ids);
+
+	printf("\n批量创建/销毁（%d 个元素，FACECLASS_PIMPL_ARENA=%d）\n", kCount, FACECLASS_PIMPL_ARENA);
+	RunBatch("global heap", false);
+	RunBatch("PimplArenaScope", true);
+	RunSurvivors();
+	return 0;
+}
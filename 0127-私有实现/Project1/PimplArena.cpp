@@ -0,0 +1,218 @@
+/*
+ * PimplArena 实现
+ *
+ * 每次分配前面都有一个块头，记录内存来自哪个 chunk（空闲链表分配的为 nullptr），
+ * 释放时据此决定走哪条路径。块头占 alignof(max_align_t) 字节，保证对象的对齐
+ *
+ * chunk 的计数：
+ *   - allocated / ownerFreed 是普通变量，只有创建 chunk 的线程在 scope 结束前修改
+ *   - 别的线程释放时对 remote 原子减一（可能减成负数）
+ *   - scope 结束时把每个 chunk "退役"：把 allocated - ownerFreed 一次性加到 remote 上，
+ *     结果为 0 说明对象都已经释放了，整块归还；否则由最后一个释放者（remote 回到 0）归还
+ *   - 退役之后的释放（包括创建线程）都走 remote 的原子减法
+ */
+
+#include "PimplArena.h"
+#include <atomic>
+#include <new>
+
+namespace
+{
+	const size_t kHeaderSize = alignof(std::max_align_t);
+
+	// 空闲链表最多保留的块数，超出的直接还给系统
+	const size_t kMaxFreeListLength = 4096;
+
+	struct BlockHeader
+	{
+		PimplArenaScope::Chunk* chunk;
+	};
+	static_assert(sizeof(BlockHeader) <= kHeaderSize, "block header does not fit");
+
+	struct FreeNode
+	{
+		FreeNode* next;
+	};
+
+	thread_local PimplArenaScope* t_current = nullptr;
+}
+
+struct PimplArenaScope::Chunk
+{
+	Chunk*                 next;        // 同一个 scope 的 chunk 链表
+	size_t                 size;        // 整块的字节数（包括这个头）
+	const void*            owner;       // 创建 chunk 的线程（t_threadTag 的地址）
+	bool                   retired;     // scope 已经结束（只有 owner 线程读写）
+	ptrdiff_t              allocated;   // 已分配的对象数（只有 owner 线程读写）
+	ptrdiff_t              ownerFreed;  // owner 线程在退役前释放的对象数
+	std::atomic<ptrdiff_t> remote;
+};
+
+namespace
+{
+	thread_local char t_threadTag;  // 只用它的地址区分线程
+
+	std::atomic<size_t> s_chunkBytes{ 0 };
+
+	void deleteChunk(PimplArenaScope::Chunk* chunk)
+	{
+		size_t size = chunk->size;
+		chunk->~Chunk();
+		::operator delete(chunk);
+		s_chunkBytes.fetch_sub(size, std::memory_order_relaxed);
+	}
+}
+
+static const size_t kChunkHeaderSize =
+	(sizeof(PimplArenaScope::Chunk) + kHeaderSize - 1) / kHeaderSize * kHeaderSize;
+
+
+PimplArenaScope::PimplArenaScope(size_t chunkSize)
+	:m_prev(t_current)
+	,m_chunkSize(chunkSize < 4096 ? 4096 : chunkSize)
+	,m_chunks(nullptr)
+	,m_cur(nullptr)
+	,m_end(nullptr)
+{
+	t_current = this;
+}
+
+PimplArenaScope::~PimplArenaScope()
+{
+	// 一次性结算所有 chunk
+	Chunk* chunk = m_chunks;
+	while (chunk) {
+		Chunk* next = chunk->next;
+		chunk->retired = true;
+		ptrdiff_t live = chunk->allocated - chunk->ownerFreed;
+		if (chunk->remote.fetch_add(live, std::memory_order_acq_rel) + live == 0) {
+			deleteChunk(chunk);
+		}
+		chunk = next;
+	}
+	t_current = m_prev;
+}
+
+PimplArenaScope* PimplArenaScope::current()
+{
+	return t_current;
+}
+
+void PimplArenaScope::newChunk()
+{
+	char* mem = static_cast<char*>(::operator new(m_chunkSize));
+	s_chunkBytes.fetch_add(m_chunkSize, std::memory_order_relaxed);
+	Chunk* chunk = new (mem) Chunk;
+	chunk->next = m_chunks;
+	chunk->size = m_chunkSize;
+	chunk->owner = &t_threadTag;
+	chunk->retired = false;
+	chunk->allocated = 0;
+	chunk->ownerFreed = 0;
+	chunk->remote.store(0, std::memory_order_relaxed);
+	m_chunks = chunk;
+	m_cur = mem + kChunkHeaderSize;
+	m_end = mem + m_chunkSize;
+}
+
+void* PimplArenaScope::allocate(size_t size)
+{
+	size_t need = kHeaderSize + (size + kHeaderSize - 1) / kHeaderSize * kHeaderSize;
+	if (need > m_chunkSize - kChunkHeaderSize) {
+		return nullptr;
+	}
+
+	if ((size_t)(m_end - m_cur) < need) {
+		Chunk* chunk = m_chunks;
+		// 对象全部由本线程释放了（每个对象只释放一次，所以别的线程不会再碰它）：从头复用
+		if (chunk && chunk->allocated == chunk->ownerFreed) {
+			chunk->allocated = chunk->ownerFreed = 0;
+			m_cur = reinterpret_cast<char*>(chunk) + kChunkHeaderSize;
+		}
+		else {
+			newChunk();
+		}
+	}
+
+	char* block = m_cur;
+	m_cur += need;
+	++m_chunks->allocated;
+
+	reinterpret_cast<BlockHeader*>(block)->chunk = m_chunks;
+	return block + kHeaderSize;
+}
+
+
+namespace PimplArena
+{
+	FreeList::~FreeList()
+	{
+		FreeNode* node = static_cast<FreeNode*>(head);
+		while (node) {
+			FreeNode* next = node->next;
+			::operator delete(node);
+			node = next;
+		}
+		// 之后（线程退出的更晚阶段）再释放的块直接还给系统
+		head = nullptr;
+		count = kMaxFreeListLength;
+	}
+
+	void* Allocate(size_t size, FreeList& list)
+	{
+		if (t_current) {
+			if (void* p = t_current->allocate(size)) {
+				return p;
+			}
+		}
+
+		char* block;
+		if (list.head) {
+			FreeNode* node = static_cast<FreeNode*>(list.head);
+			list.head = node->next;
+			--list.count;
+			block = reinterpret_cast<char*>(node);
+		}
+		else {
+			block = static_cast<char*>(::operator new(kHeaderSize + size));
+		}
+
+		reinterpret_cast<BlockHeader*>(block)->chunk = nullptr;
+		return block + kHeaderSize;
+	}
+
+	void Free(void* p, FreeList& list)
+	{
+		if (!p) return;
+
+		char* block = static_cast<char*>(p) - kHeaderSize;
+		PimplArenaScope::Chunk* chunk = reinterpret_cast<BlockHeader*>(block)->chunk;
+
+		if (chunk) {
+			// 创建线程在 scope 结束前释放：普通加法（retired 只有创建线程读写，先比较 owner）
+			if (chunk->owner == &t_threadTag && !chunk->retired) {
+				++chunk->ownerFreed;
+				return;
+			}
+			// 退役后最后一个释放的对象负责归还 chunk（退役前 remote 不会大于 0）
+			if (chunk->remote.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				deleteChunk(chunk);
+			}
+			return;
+		}
+
+		if (list.count >= kMaxFreeListLength) {
+			::operator delete(block);
+			return;
+		}
+		FreeNode* node = reinterpret_cast<FreeNode*>(block);
+		node->next = static_cast<FreeNode*>(list.head);
+		list.head = node;
+		++list.count;
+	}
+
+	size_t ChunkBytes()
+	{
+		return s_chunkBytes.load(std::memory_order_relaxed);
+	}
+}
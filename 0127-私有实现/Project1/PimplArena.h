@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+
+/*
+ * PimplArena - Pimpl 实现对象（innerClass 等）的分配器
+ *
+ * 两条路径：
+ *   1. arena scope 内：从本线程的 bump arena 分配（指针加一下就完成）
+ *      arena 按块（chunk）向系统申请，scope 结束时一次性结算并归还所有 chunk
+ *   2. scope 外：每个类型有自己的线程局部空闲链表，释放的块留着给下一次分配复用
+ *
+ *   {
+ *       PimplArenaScope scope;          // 本线程之后创建的 innerClass 都来自 arena
+ *       vector<faceClass> batch(1000000);
+ *       ...
+ *   }                                   // batch 先析构，scope 结束时 chunk 一次性归还
+ *
+ * 释放的开销：
+ *   - scope 还在时由创建线程释放（最常见的情况）：chunk 上的普通计数加一，没有原子操作
+ *   - 当前 chunk 用满时，如果里面的对象已经全部释放，直接从头复用，不再申请新 chunk
+ *   - 别的线程释放，或者 scope 结束之后才释放：chunk 计数原子减一
+ *
+ * 比 scope 活得更久的对象：对象不能搬家，它所在的 chunk 要保留到这些对象全部析构
+ * （最后一个释放的线程负责归还）。一个幸存者最多占住一个 chunk（默认 64 KiB）：
+ * FaceClassBench 里 100 万个对象分散留下 1%，约 30 MiB 的 chunk 被留住，幸存者析构后全部归还。
+ * 所以 scope 只适合"一起创建、一起销毁"的批量对象；长期存活的对象应该在 scope 外创建，走空闲链表，
+ * 可以用 ChunkBytes() 检查有没有 chunk 被意外留住
+ */
+
+class PimplArenaScope
+{
+public:
+	static const size_t kDefaultChunkSize = 64 * 1024;
+
+	explicit PimplArenaScope(size_t chunkSize = kDefaultChunkSize);
+	~PimplArenaScope();
+
+	PimplArenaScope(const PimplArenaScope&) = delete;
+	PimplArenaScope& operator=(const PimplArenaScope&) = delete;
+
+	// 在当前 chunk 里分配，放不下时换一个新 chunk；size 超过 chunk 容量时返回 nullptr
+	void* allocate(size_t size);
+
+	// 本线程当前（最内层）的 scope，没有时返回 nullptr
+	static PimplArenaScope* current();
+
+	struct Chunk;  // 定义在 PimplArena.cpp 中
+
+private:
+	void newChunk();
+
+	PimplArenaScope* m_prev;       // 外层 scope（scope 可以嵌套）
+	size_t           m_chunkSize;
+	Chunk*           m_chunks;     // 本 scope 申请的所有 chunk，第一个是正在分配的
+	char*            m_cur;
+	char*            m_end;
+};
+
+namespace PimplArena
+{
+	// 单个类型在单个线程上的空闲链表
+	struct FreeList
+	{
+		void*  head = nullptr;
+		size_t count = 0;
+
+		~FreeList();  // 线程退出时归还给系统
+	};
+
+	// 有 scope 时从 arena 分配，否则从 list 分配；失败抛 std::bad_alloc
+	void* Allocate(size_t size, FreeList& list);
+
+	// 释放 Allocate 返回的内存：arena 里的减少 chunk 计数，其余的挂回 list
+	void Free(void* p, FreeList& list);
+
+	// 所有线程的 arena chunk 当前占用的字节数（包括被幸存对象留住的）
+	size_t ChunkBytes();
+}
+
+// 每个类型一个分配器，给类的 operator new/delete 使用
+template <class T>
+class PimplAllocator
+{
+public:
+	static void* allocate() { return PimplArena::Allocate(sizeof(T), freeList()); }
+	static void deallocate(void* p) { PimplArena::Free(p, freeList()); }
+
+private:
+	static PimplArena::FreeList& freeList()
+	{
+		static thread_local PimplArena::FreeList s_list;
+		return s_list;
+	}
+};
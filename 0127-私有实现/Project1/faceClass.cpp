@@ -14,9 +14,23 @@
  *   - 头文件中只有前向声明：class innerClass;
  *   - cpp 文件中才有 innerClass 的完整定义
  *   - innerClass 必须在使用之前定义（编译器从上往下读）
+ *
+ * 存储方式见 faceClass.h 中的 FACECLASS_PIMPL_MODE：
+ *   HEAP   ：d_ptr 指向 new 出来的 innerClass
+ *   INLINE ：innerClass 用 placement new 构造在 faceClass::m_impl 里，析构时手动调用析构函数
+ *   SHARED ：多个 faceClass 共享一个带原子引用计数的 innerClass，写时才复制（detach）
+ *            共享中的 innerClass 只读，多个线程同时读各自的副本是安全的；
+ *            同一个 faceClass 对象仍然不能在多个线程里同时读写
+ *
+ * FACECLASS_PIMPL_ARENA 打开时 innerClass 重载 operator new/delete，
+ * 上面的 new/delete 代码不用改，内存改由 PimplArena 提供
  */
 
 #include "faceClass.h"
+#include "PimplArena.h"
+#include <atomic>
+#include <new>
+#include <utility>
 
 class innerClass
 {
@@ -27,13 +41,76 @@ public:
 	// 供外部调用的函数都要public
 	int getID();
 	void setID(int id);
+	void setParent(faceClass* parent);  // 宿主对象被移动后，指回新的宿主
+
+#if FACECLASS_PIMPL_MODE == FACECLASS_PIMPL_SHARED
+	// 共享模式下的引用计数（创建时为 1）
+	void addRef();
+	void release();        // 减到 0 时 delete this
+	bool isShared() const; // 是否还有别的 faceClass 在用
+
+private:
+	std::atomic<int> m_ref;
+#endif
 
 public:
 	innerClass(faceClass* parent);
 	~innerClass();
+
+#if FACECLASS_PIMPL_ARENA && FACECLASS_PIMPL_MODE != FACECLASS_PIMPL_INLINE
+	// INLINE 模式下 innerClass 用 placement new 构造在 faceClass 里，不需要分配器；
+	// 而且类自己的 operator new 会遮住 placement new，new (m_impl) innerClass(...) 将无法编译
+	static void* operator new(size_t size);
+	static void operator delete(void* p);
+#endif
 };
 
+#if FACECLASS_PIMPL_MODE == FACECLASS_PIMPL_INLINE
+// 头文件里预留的缓冲区必须放得下 innerClass，对齐也要满足
+static_assert(sizeof(innerClass) <= faceClass::kImplSize,
+	"faceClass::kImplSize is too small for innerClass");
+static_assert(alignof(innerClass) <= faceClass::kImplAlign,
+	"faceClass::kImplAlign is too weak for innerClass");
+
+inline innerClass* faceClass::d_func() const
+{
+	// m_impl 里构造的就是 innerClass，launder 后可以直接当作它来访问
+	return std::launder(reinterpret_cast<innerClass*>(const_cast<unsigned char*>(m_impl)));
+}
+#else
+inline innerClass* faceClass::d_func() const
+{
+	return d_ptr;
+}
+#endif
+
 
+#if FACECLASS_PIMPL_MODE == FACECLASS_PIMPL_INLINE
+faceClass::faceClass()
+{
+	// 在内联缓冲区里构造，不分配堆内存
+	new (m_impl) innerClass(this);
+}
+
+faceClass::~faceClass()
+{
+	// placement new 构造的对象不能 delete，只调用析构函数
+	d_func()->~innerClass();
+}
+#elif FACECLASS_PIMPL_MODE == FACECLASS_PIMPL_SHARED
+faceClass::faceClass()
+	:d_ptr(new innerClass(nullptr))  // 可能被多个宿主共享，不记录 p_ptr
+{
+}
+
+faceClass::~faceClass()
+{
+	// 不能直接 delete，别的对象可能还在共享；最后一个引用释放时才删除
+	if (d_ptr) {
+		d_ptr->release();
+	}
+}
+#else
 faceClass::faceClass()
 	:d_ptr(new innerClass(this))
 {
@@ -44,6 +121,7 @@ faceClass::~faceClass()
 	// 这里需要 delete，否则会内存泄露
 	delete d_ptr;
 }
+#endif
 
 /*
  * 拷贝构造函数 vs 赋值运算符 使用场景对比：
@@ -58,7 +136,23 @@ faceClass::~faceClass()
  */
 
 // 拷贝构造函数 - 深拷贝
-// 场景：对象刚被创建，d_ptr 还不存在，必须 new
+// 场景：对象刚被创建，d_ptr 还不存在，必须 new（INLINE 模式下在缓冲区里构造）
+#if FACECLASS_PIMPL_MODE == FACECLASS_PIMPL_INLINE
+faceClass::faceClass(const faceClass& other)
+{
+	new (m_impl) innerClass(this);
+	d_func()->setID(other.d_func()->getID());
+}
+#elif FACECLASS_PIMPL_MODE == FACECLASS_PIMPL_SHARED
+// 共享：不分配，只增加引用计数
+faceClass::faceClass(const faceClass& other)
+	:d_ptr(other.d_ptr)
+{
+	if (d_ptr) {
+		d_ptr->addRef();
+	}
+}
+#else
 faceClass::faceClass(const faceClass& other)
 	:d_ptr(new innerClass(this))  // 创建新的 innerClass
 {
@@ -67,39 +161,142 @@ faceClass::faceClass(const faceClass& other)
 		d_ptr->setID(other.d_ptr->getID());
 	}
 }
+#endif
 
 // 赋值运算符 - 深拷贝
 // 场景：对象已经存在，d_ptr 在构造时就创建好了，复用它即可
+#if FACECLASS_PIMPL_MODE == FACECLASS_PIMPL_SHARED
+// 共享：改为引用 other 的 innerClass，释放自己原来的（先 addRef 再 release，自赋值也安全）
+faceClass& faceClass::operator=(const faceClass& other)
+{
+	innerClass* old = d_ptr;
+	d_ptr = other.d_ptr;
+	if (d_ptr) {
+		d_ptr->addRef();
+	}
+	if (old) {
+		old->release();
+	}
+	return *this;
+}
+#else
 faceClass& faceClass::operator=(const faceClass& other)
 {
 	if (this != &other) {  // 防止自赋值
+#if FACECLASS_PIMPL_MODE == FACECLASS_PIMPL_HEAP
+		if (!d_ptr) {
+			d_ptr = new innerClass(this);  // 被移动走的对象重新获得实现
+		}
+#endif
 		// 复制数据（不需要重新创建 d_ptr，复用现有的）
-		if (d_ptr && other.d_ptr) {
-			d_ptr->setID(other.d_ptr->getID());
+		if (d_func() && other.d_func()) {
+			d_func()->setID(other.d_func()->getID());
 		}
 	}
 	return *this;
 }
+#endif
 
-int faceClass::getID()
+/*
+ * 移动构造 / 移动赋值：
+ *
+ *   HEAP 模式：直接偷走 other.d_ptr，other 置空；innerClass 里的 p_ptr 要改成指向新宿主
+ *   INLINE 模式：innerClass 就在对象内部，没有指针可偷，按值复制数据（同样不分配内存）
+ *   SHARED 模式：同样偷指针，引用计数不变；innerClass 可能被共享，不记录宿主
+ */
+#if FACECLASS_PIMPL_MODE == FACECLASS_PIMPL_INLINE
+faceClass::faceClass(faceClass&& other) noexcept
 {
+	new (m_impl) innerClass(this);
+	d_func()->setID(other.d_func()->getID());
+}
+
+faceClass& faceClass::operator=(faceClass&& other) noexcept
+{
+	if (this != &other) {
+		d_func()->setID(other.d_func()->getID());
+	}
+	return *this;
+}
+#elif FACECLASS_PIMPL_MODE == FACECLASS_PIMPL_SHARED
+faceClass::faceClass(faceClass&& other) noexcept
+	:d_ptr(other.d_ptr)
+{
+	other.d_ptr = nullptr;
+}
+
+faceClass& faceClass::operator=(faceClass&& other) noexcept
+{
+	// 交换后自己原来的 innerClass 由 other 析构时释放
+	std::swap(d_ptr, other.d_ptr);
+	return *this;
+}
+#else
+faceClass::faceClass(faceClass&& other) noexcept
+	:d_ptr(other.d_ptr)
+{
+	other.d_ptr = nullptr;
 	if (d_ptr) {
-		return d_ptr->getID();
+		d_ptr->setParent(this);
+	}
+}
+
+faceClass& faceClass::operator=(faceClass&& other) noexcept
+{
+	if (this != &other) {
+		// 交换实现：自己原来的 innerClass 交给 other，在 other 析构时释放
+		std::swap(d_ptr, other.d_ptr);
+		if (d_ptr) {
+			d_ptr->setParent(this);
+		}
+		if (other.d_ptr) {
+			other.d_ptr->setParent(&other);
+		}
+	}
+	return *this;
+}
+#endif
+
+int faceClass::getID()
+{
+	if (d_func()) {
+		return d_func()->getID();
 	}
+	return 0;  // 被移动走的对象
 }
 
 void faceClass::setID(int id)
 {
-	if (d_ptr)
+	if (d_func())
 	{
-		d_ptr->setID(id);
+#if FACECLASS_PIMPL_MODE == FACECLASS_PIMPL_SHARED
+		detach();  // 写时复制
+#endif
+		d_func()->setID(id);
+	}
+}
+
+#if FACECLASS_PIMPL_MODE == FACECLASS_PIMPL_SHARED
+void faceClass::detach()
+{
+	// 引用计数为 1 时只有自己在用，直接原地修改
+	// （别的对象要共享它，只能通过拷贝本对象，而本对象此时不会被别的线程访问）
+	if (d_ptr && d_ptr->isShared()) {
+		innerClass* copy = new innerClass(nullptr);
+		copy->setID(d_ptr->getID());
+		d_ptr->release();
+		d_ptr = copy;
 	}
 }
+#endif
 
 
 innerClass::innerClass(faceClass* parent)
 	:p_ptr(parent)
 	,m_nId(999)
+#if FACECLASS_PIMPL_MODE == FACECLASS_PIMPL_SHARED
+	,m_ref(1)
+#endif
 {
 }
 
@@ -119,6 +316,47 @@ void innerClass::setID(int id)
 	m_nId = id;
 }
 
+void innerClass::setParent(faceClass* parent)
+{
+	p_ptr = parent;
+}
+
+#if FACECLASS_PIMPL_ARENA && FACECLASS_PIMPL_MODE != FACECLASS_PIMPL_INLINE
+void* innerClass::operator new(size_t size)
+{
+	(void)size;  // 总是 sizeof(innerClass)（innerClass 没有派生类）
+	return PimplAllocator<innerClass>::allocate();
+}
+
+void innerClass::operator delete(void* p)
+{
+	PimplAllocator<innerClass>::deallocate(p);
+}
+#endif
+
+#if FACECLASS_PIMPL_MODE == FACECLASS_PIMPL_SHARED
+void innerClass::addRef()
+{
+	// 只有已经持有引用的对象才能 addRef，不需要同步其他数据
+	m_ref.fetch_add(1, std::memory_order_relaxed);
+}
+
+void innerClass::release()
+{
+	// release 保证之前对 innerClass 的读写都在 delete 之前完成
+	if (m_ref.fetch_sub(1, std::memory_order_release) == 1) {
+		std::atomic_thread_fence(std::memory_order_acquire);
+		delete this;
+	}
+}
+
+bool innerClass::isShared() const
+{
+	// acquire：别的副本刚释放时，保证它之前的读已经结束，可以安全地原地修改
+	return m_ref.load(std::memory_order_acquire) > 1;
+}
+#endif
+
 
 
 
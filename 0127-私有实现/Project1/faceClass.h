@@ -1,22 +1,75 @@
 #pragma once
+#include <cstddef>
+
+/*
+ * Pimpl 存储方式（编译期选择，例如 /D FACECLASS_PIMPL_MODE=1）：
+ *   FACECLASS_PIMPL_HEAP   (0)：innerClass 在堆上，faceClass 里只有一个指针（默认，经典写法）
+ *   FACECLASS_PIMPL_INLINE (1)：innerClass 直接放在 faceClass 内部的定长缓冲区里（"fast pimpl"）
+ *                                构造/拷贝不分配堆内存，访问成员也少一次指针跳转
+ *   FACECLASS_PIMPL_SHARED (2)：隐式共享（copy-on-write），拷贝只增加 innerClass 的原子引用计数，
+ *                                setID 时如果还有别的对象共享，才复制出一份私有的 innerClass
+ *
+ * INLINE 模式下头文件依然看不到 innerClass 的定义，只需要知道它的大小上限和对齐；
+ * faceClass.cpp 里用 static_assert 检查 innerClass 能放进缓冲区
+ */
+#define FACECLASS_PIMPL_HEAP   0
+#define FACECLASS_PIMPL_INLINE 1
+#define FACECLASS_PIMPL_SHARED 2
+
+#ifndef FACECLASS_PIMPL_MODE
+#define FACECLASS_PIMPL_MODE FACECLASS_PIMPL_HEAP
+#endif
+
+/*
+ * FACECLASS_PIMPL_ARENA=1：HEAP/SHARED 模式下 innerClass 不再用全局 new，
+ * 改用 PimplArena（见 PimplArena.h）：在 PimplArenaScope 内从线程局部的 bump arena 分配，
+ * scope 外从 innerClass 专用的空闲链表分配
+ */
+#ifndef FACECLASS_PIMPL_ARENA
+#define FACECLASS_PIMPL_ARENA 0
+#endif
 
 // 前置声明
 class innerClass;
 
 class faceClass
 {
+public:
+#if FACECLASS_PIMPL_MODE == FACECLASS_PIMPL_INLINE
+	// 内联缓冲区的大小和对齐（innerClass 变大时要同步修改，否则 faceClass.cpp 编译失败）
+	static const size_t kImplSize = 2 * sizeof(void*);
+	static const size_t kImplAlign = alignof(void*);
+#endif
+
 private:
+#if FACECLASS_PIMPL_MODE == FACECLASS_PIMPL_INLINE
+	alignas(kImplAlign) unsigned char m_impl[kImplSize];
+#else
 	innerClass* d_ptr;
+#endif
+
+	// 取得私有实现（各种模式下 cpp 里的代码都通过它访问 innerClass）
+	innerClass* d_func() const;
+
+#if FACECLASS_PIMPL_MODE == FACECLASS_PIMPL_SHARED
+	// 写之前调用：innerClass 被共享时换成私有的副本
+	void detach();
+#endif
 
 public:
 	faceClass();
 	~faceClass();
 
-	// 深拷贝：拷贝构造函数和赋值运算符
+	// 深拷贝：拷贝构造函数和赋值运算符（SHARED 模式下是浅拷贝 + 引用计数）
 	faceClass(const faceClass& other);
 	faceClass& operator=(const faceClass& other);
 
+	// 移动：接管对方的 innerClass，不分配内存、不抛异常
+	// 声明为 noexcept 后 vector 扩容、std::sort 等会用移动代替拷贝
+	// 被移动后的对象只能析构或重新赋值（HEAP/SHARED 模式下 getID() 返回 0）
+	faceClass(faceClass&& other) noexcept;
+	faceClass& operator=(faceClass&& other) noexcept;
+
 	int getID();
 	void setID(int id);
 };
-
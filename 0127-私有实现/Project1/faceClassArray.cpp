@@ -0,0 +1,105 @@
+/*
+ * faceClassArray 实现
+ *
+ * getIDs/setIDs 就是连续内存的复制（memcpy 本身已经按内存带宽运行）
+ * findID 用 SSE2 每次比较 16 个 int，命中后再在这 16 个里定位；非 x86 平台用普通循环
+ */
+
+#include "faceClassArray.h"
+#include "faceClass.h"
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#define FACECLASS_ARRAY_SSE2 1
+#else
+#define FACECLASS_ARRAY_SSE2 0
+#endif
+
+// 与 innerClass 构造时的初始 ID 保持一致
+static const int kDefaultID = faceClass().getID();
+
+faceClassArray::faceClassArray()
+{
+}
+
+faceClassArray::faceClassArray(size_t count)
+	:m_ids(count, kDefaultID)
+{
+}
+
+void faceClassArray::resize(size_t count)
+{
+	m_ids.resize(count, kDefaultID);
+}
+
+size_t faceClassArray::push_back(int id)
+{
+	m_ids.push_back(id);
+	return m_ids.size() - 1;
+}
+
+size_t faceClassArray::push_back(faceClass& face)
+{
+	return push_back(face.getID());
+}
+
+faceClass faceClassArray::toFaceClass(size_t index) const
+{
+	faceClass face;
+	face.setID(m_ids[index]);
+	return face;
+}
+
+void faceClassArray::getIDs(size_t first, size_t count, int* ids) const
+{
+	if (count) {
+		memcpy(ids, m_ids.data() + first, count * sizeof(int));
+	}
+}
+
+void faceClassArray::setIDs(size_t first, size_t count, const int* ids)
+{
+	if (count) {
+		memcpy(m_ids.data() + first, ids, count * sizeof(int));
+	}
+}
+
+size_t faceClassArray::findID(int id, size_t first) const
+{
+	const int* p = m_ids.data();
+	size_t n = m_ids.size();
+	size_t i = first;
+
+#if FACECLASS_ARRAY_SSE2
+	const __m128i key = _mm_set1_epi32(id);
+	for (; i + 16 <= n; i += 16) {
+		// 4 组一起比较，只有命中时才分支
+		__m128i e0 = _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i)), key);
+		__m128i e1 = _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i + 4)), key);
+		__m128i e2 = _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i + 8)), key);
+		__m128i e3 = _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i + 12)), key);
+		__m128i any = _mm_or_si128(_mm_or_si128(e0, e1), _mm_or_si128(e2, e3));
+		if (_mm_movemask_epi8(any)) {
+			// 每个 int 在 movemask 里占 4 位
+			unsigned mask = (unsigned)_mm_movemask_epi8(e0)
+				| ((unsigned)_mm_movemask_epi8(e1) << 16);
+			if (mask) {
+				for (unsigned k = 0; k < 8; ++k) {
+					if (mask & (1u << (k * 4))) return i + k;
+				}
+			}
+			mask = (unsigned)_mm_movemask_epi8(e2)
+				| ((unsigned)_mm_movemask_epi8(e3) << 16);
+			for (unsigned k = 0; k < 8; ++k) {
+				if (mask & (1u << (k * 4))) return i + 8 + k;
+			}
+		}
+	}
+#endif
+
+	for (; i < n; ++i) {
+		if (p[i] == id) return i;
+	}
+	return npos;
+}
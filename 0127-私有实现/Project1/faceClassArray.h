@@ -0,0 +1,68 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+class faceClass;
+
+/*
+ * faceClassArray - 大量 faceClass 数据的连续存储（struct-of-arrays）
+ *
+ * 结构：
+ *   vector<faceClass>  ：每个元素一个 d_ptr ──▶ 分散在堆上的 innerClass（遍历时大量缓存未命中）
+ *   faceClassArray     ：所有元素的 m_nId 放在一个连续的 int 数组里
+ *
+ *   faceClassArray arr(1000000);
+ *   arr[5].setID(100);                    // 句柄，用法和 faceClass 一样
+ *   size_t i = arr.findID(100);           // 整体扫描，SIMD 一次比较多个元素
+ *   arr.getIDs(0, n, buffer);             // 批量读写
+ *
+ * 句柄只是"数组 + 下标"，不分配内存；和 vector 的迭代器一样，resize/push_back 后旧句柄失效
+ */
+class faceClassArray
+{
+public:
+	static const size_t npos = static_cast<size_t>(-1);
+
+	// 轻量句柄：提供和 faceClass 相同的 getID/setID 接口
+	class handle
+	{
+	private:
+		int* m_pId;
+
+	public:
+		explicit handle(int* pId) : m_pId(pId) {}
+
+		int getID() const { return *m_pId; }
+		void setID(int id) { *m_pId = id; }
+	};
+
+private:
+	std::vector<int> m_ids;  // 所有元素的 ID，连续存放
+
+public:
+	faceClassArray();
+	explicit faceClassArray(size_t count);  // count 个默认元素（ID 与 faceClass 的初始值相同）
+
+	size_t size() const { return m_ids.size(); }
+	void reserve(size_t count) { m_ids.reserve(count); }
+	void resize(size_t count);
+
+	handle operator[](size_t index) { return handle(&m_ids[index]); }
+
+	// 追加一个元素，返回它的下标
+	size_t push_back(int id);
+	size_t push_back(faceClass& face);
+
+	// 转换回独立的 faceClass 对象
+	faceClass toFaceClass(size_t index) const;
+
+	// 批量操作：[first, first + count) 范围内的 ID 读出/写入
+	void getIDs(size_t first, size_t count, int* ids) const;
+	void setIDs(size_t first, size_t count, const int* ids);
+
+	// 从 first 开始查找第一个等于 id 的元素，找不到返回 npos
+	size_t findID(int id, size_t first = 0) const;
+
+	// 直接访问连续存储
+	const int* data() const { return m_ids.data(); }
+};
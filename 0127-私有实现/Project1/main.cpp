@@ -8,6 +8,7 @@
  * 2. 拷贝语义：
  *    - 默认拷贝构造函数只拷贝指针，会导致两个对象共享同一个 innerClass
  *    - 需要自定义拷贝构造函数和赋值运算符（深拷贝），或者禁用它们
+ *    - 再加上 noexcept 的移动构造/移动赋值（偷指针），放进 vector 时扩容和排序都不用深拷贝
  *
  * 3. 推荐使用智能指针：
  *    - 用 std::unique_ptr<innerClass> 代替裸指针
@@ -16,6 +17,10 @@
  * 4. 性能开销：
  *    - 每次访问成员需要通过指针间接访问
  *    - 构造时额外的堆分配开销
+ *    - 对性能敏感时可以用 FACECLASS_PIMPL_INLINE（fast pimpl，见 faceClass.h）：
+ *      代价是头文件要写死缓冲区大小，innerClass 变大后需要同步修改并重新编译使用方
+ *    - 拷贝多、修改少时可以用 FACECLASS_PIMPL_SHARED（写时复制）：拷贝只是原子加一
+ *    - 大批对象同生共死时可以打开 FACECLASS_PIMPL_ARENA，在 PimplArenaScope 里批量分配、整块释放
  */
 
 #include "faceClass.h"
@@ -0,0 +1,318 @@
+// Apartment.cpp - 单线程套间和 ICalculator 代理
+#include "Apartment.h"
+#include "StandardCOM.h"
+#include "ComLog.h"
+#include "InterfaceMap.h"
+#include <new>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#define CPU_RELAX() _mm_pause()
+#else
+#define CPU_RELAX() std::this_thread::yield()
+#endif
+
+namespace
+{
+    // ApartmentCall::state
+    enum : uint32_t
+    {
+        kPending = 0,
+        kDone    = 1,  // hr 和结果已写回
+        kWaiting = 2,  // 调用方在睡眠，完成时需要 notify
+    };
+
+    // 多核时先自旋；单核上自旋只会拖慢套间线程
+    const unsigned s_spinCount = std::thread::hardware_concurrency() > 1 ? 2000 : 0;
+
+    // 只有套间线程写，其他线程读统计值
+    inline void Bump(std::atomic<uint64_t>& counter, uint64_t n = 1)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+}
+
+
+// ========================================
+// 套间
+// ========================================
+
+Apartment::Apartment()
+    : m_head(nullptr)
+    , m_sleeping(false)
+    , m_stop(false)
+    , m_calls(0)
+    , m_batches(0)
+    , m_wakes(0)
+{
+    m_thread = std::thread([this] { ThreadMain(); });
+    m_threadId = m_thread.get_id();
+}
+
+Apartment::~Apartment()
+{
+    struct StopCall : ApartmentCall
+    {
+        Apartment* apartment;
+    } call;
+    call.apartment = this;
+    call.invoke = [](ApartmentCall* c) { static_cast<StopCall*>(c)->apartment->m_stop = true; };
+    Invoke(&call);
+    m_thread.join();
+}
+
+HRESULT Apartment::Invoke(ApartmentCall* call)
+{
+    call->hr = S_OK;
+    if (IsCurrentThread())
+    {
+        call->invoke(call);
+        return call->hr;
+    }
+
+    call->state.store(kPending, std::memory_order_relaxed);
+
+    // 入队：CAS 压到链表头
+    ApartmentCall* head = m_head.load(std::memory_order_relaxed);
+    do
+    {
+        call->next = head;
+    } while (!m_head.compare_exchange_weak(head, call, std::memory_order_seq_cst, std::memory_order_relaxed));
+
+    // 队列原来非空：套间线程一定还会再来取，不需要唤醒
+    // 原来为空：只有套间线程已经登记睡眠时才 notify（和 ThreadMain 中的登记配对，两边都是 seq_cst）
+    if (!head && m_sleeping.load(std::memory_order_seq_cst))
+        m_head.notify_one();
+
+    // 等结果：先自旋，再登记 kWaiting 睡眠
+    uint32_t s = kPending;
+    for (unsigned i = 0; i < s_spinCount; ++i)
+    {
+        s = call->state.load(std::memory_order_acquire);
+        if (s == kDone) return call->hr;
+        CPU_RELAX();
+    }
+    // 持锁登记 kWaiting：套间线程看到 kWaiting 后要先拿到这把锁才 notify，此时调用方已经在 wait 里
+    std::unique_lock<std::mutex> lock(m_waitLock);
+    if (call->state.compare_exchange_strong(s, kWaiting, std::memory_order_acquire))
+    {
+        m_waitCv.wait(lock, [call] { return call->state.load(std::memory_order_acquire) == kDone; });
+    }
+    return call->hr;
+}
+
+// 在套间线程上执行并交回结果；写入 kDone 之后记录可能立即失效（在调用方栈上），不能再碰它
+void Apartment::Complete(ApartmentCall* call)
+{
+    call->invoke(call);
+    if (call->state.exchange(kDone, std::memory_order_acq_rel) == kWaiting)
+    {
+        { std::lock_guard<std::mutex> guard(m_waitLock); }
+        m_waitCv.notify_all();  // 多个调用方共用条件变量，各自检查自己的记录
+    }
+}
+
+void Apartment::ThreadMain()
+{
+    while (!m_stop)
+    {
+        ApartmentCall* list = m_head.exchange(nullptr, std::memory_order_acquire);
+        if (!list)
+        {
+            // 短暂自旋：负载高时下一批很快就来，省掉一次睡眠/唤醒
+            for (unsigned i = 0; i < s_spinCount && !m_head.load(std::memory_order_relaxed); ++i)
+                CPU_RELAX();
+            if (m_head.load(std::memory_order_relaxed)) continue;
+
+            m_sleeping.store(true, std::memory_order_seq_cst);
+            if (!m_head.load(std::memory_order_seq_cst))
+            {
+                m_head.wait(nullptr, std::memory_order_seq_cst);
+                Bump(m_wakes);
+            }
+            m_sleeping.store(false, std::memory_order_relaxed);
+            continue;
+        }
+
+        // 链表是后进先出，反转后按提交顺序执行
+        ApartmentCall* ordered = nullptr;
+        uint64_t count = 0;
+        while (list)
+        {
+            ApartmentCall* next = list->next;
+            list->next = ordered;
+            ordered = list;
+            list = next;
+            ++count;
+        }
+        while (ordered)
+        {
+            ApartmentCall* next = ordered->next;  // Complete 之后记录可能已经失效
+            Complete(ordered);
+            ordered = next;
+        }
+
+        Bump(m_calls, count);
+        Bump(m_batches);
+    }
+}
+
+ApartmentStats Apartment::GetStats() const
+{
+    ApartmentStats stats;
+    stats.calls = m_calls.load(std::memory_order_relaxed);
+    stats.batches = m_batches.load(std::memory_order_relaxed);
+    stats.wakes = m_wakes.load(std::memory_order_relaxed);
+    return stats;
+}
+
+
+// ========================================
+// ICalculator 代理
+// ========================================
+
+namespace
+{
+    class CalculatorApartmentProxy final : public ICalculator
+    {
+    private:
+        RefCount     m_refCount;
+        Apartment*   m_apartment;
+        ICalculator* m_target;  // 套间线程上的真实对象（持有一个引用）
+
+        // 一次 ICalculator 调用的记录
+        struct Call : ApartmentCall
+        {
+            ICalculator* target;
+            AsyncOp      op;
+            int          a;
+            int          b;
+            int          result;
+        };
+
+        static void Invoke(ApartmentCall* c)
+        {
+            Call* call = static_cast<Call*>(c);
+            switch (call->op)
+            {
+            case AsyncOp_Add:      call->hr = call->target->Add(call->a, call->b, &call->result); break;
+            case AsyncOp_Subtract: call->hr = call->target->Subtract(call->a, call->b, &call->result); break;
+            case AsyncOp_Multiply: call->hr = call->target->Multiply(call->a, call->b, &call->result); break;
+            case AsyncOp_Divide:   call->hr = call->target->Divide(call->a, call->b, &call->result); break;
+            default:               call->hr = E_INVALIDARG; break;
+            }
+        }
+
+        HRESULT Forward(AsyncOp op, int a, int b, int* result)
+        {
+            if (!result) return E_POINTER;
+            Call call;
+            call.invoke = &Invoke;
+            call.target = m_target;
+            call.op = op;
+            call.a = a;
+            call.b = b;
+            call.result = 0;
+            HRESULT hr = m_apartment->Invoke(&call);
+            *result = call.result;
+            return hr;
+        }
+
+    public:
+        CalculatorApartmentProxy(Apartment* apartment, ICalculator* target)
+            : m_refCount(1)
+            , m_apartment(apartment)
+            , m_target(target)
+        {
+        }
+
+        ~CalculatorApartmentProxy()
+        {
+            // 真实对象只能在套间线程上释放
+            struct ReleaseCall : ApartmentCall
+            {
+                ICalculator* target;
+            } call;
+            call.invoke = [](ApartmentCall* c) { static_cast<ReleaseCall*>(c)->target->Release(); };
+            call.target = m_target;
+            m_apartment->Invoke(&call);
+        }
+
+        // IUnknown 接口（代理自己的引用计数，不跨线程）
+        virtual HRESULT __stdcall QueryInterface(REFIID riid, void** ppvObject) override;
+
+        virtual ULONG __stdcall AddRef() override
+        {
+            return m_refCount.Increment();
+        }
+
+        virtual ULONG __stdcall Release() override
+        {
+            ULONG count = m_refCount.Decrement();
+            if (count == 0) delete this;
+            return count;
+        }
+
+        // ICalculator 接口：转发到套间线程
+        virtual HRESULT __stdcall Add(int a, int b, int* result) override { return Forward(AsyncOp_Add, a, b, result); }
+        virtual HRESULT __stdcall Subtract(int a, int b, int* result) override { return Forward(AsyncOp_Subtract, a, b, result); }
+        virtual HRESULT __stdcall Multiply(int a, int b, int* result) override { return Forward(AsyncOp_Multiply, a, b, result); }
+        virtual HRESULT __stdcall Divide(int a, int b, int* result) override { return Forward(AsyncOp_Divide, a, b, result); }
+    };
+
+    static constexpr InterfaceEntry s_proxyInterfaces[] =
+    {
+        COM_INTERFACE_ENTRY(CalculatorApartmentProxy, ICalculator),
+        COM_INTERFACE_ENTRY2(CalculatorApartmentProxy, IUnknown, ICalculator),
+    };
+    static constinit InterfaceMap s_proxyMap("[ApartmentProxy]", s_proxyInterfaces);
+
+    HRESULT __stdcall CalculatorApartmentProxy::QueryInterface(REFIID riid, void** ppvObject)
+    {
+        return s_proxyMap.Query(this, riid, ppvObject);
+    }
+}
+
+HRESULT Apartment::CreateInstance(REFCLSID rclsid, REFIID riid, void** ppv)
+{
+    if (!ppv) return E_POINTER;
+    *ppv = nullptr;
+
+    // 在套间线程上通过类工厂创建真实对象
+    struct CreateCall : ApartmentCall
+    {
+        const CLSID* clsid;
+        ICalculator* object;
+    } call;
+    call.clsid = &rclsid;
+    call.object = nullptr;
+    call.invoke = [](ApartmentCall* c)
+    {
+        CreateCall* self = static_cast<CreateCall*>(c);
+        ComPtr<IClassFactory> pFactory;
+        self->hr = DllGetClassObject(*self->clsid, IID_IClassFactory, (void**)pFactory.ReleaseAndGetAddressOf());
+        if (FAILED(self->hr)) return;
+        self->hr = pFactory->CreateInstance(nullptr, IID_ICalculator, (void**)&self->object);
+    };
+    HRESULT hr = Invoke(&call);
+    if (FAILED(hr)) return hr;
+
+    CalculatorApartmentProxy* proxy = new (std::nothrow) CalculatorApartmentProxy(this, call.object);
+    if (!proxy)
+    {
+        // 没有代理来释放它：投递一次 Release
+        struct ReleaseCall : ApartmentCall
+        {
+            ICalculator* target;
+        } release;
+        release.invoke = [](ApartmentCall* c) { static_cast<ReleaseCall*>(c)->target->Release(); };
+        release.target = call.object;
+        Invoke(&release);
+        return E_OUTOFMEMORY;
+    }
+
+    COM_LOG_DEBUG("[Apartment] 对象已创建，返回代理");
+    hr = proxy->QueryInterface(riid, ppv);
+    proxy->Release();  // 成功时 QueryInterface 已经 AddRef；失败时销毁代理（并释放对象）
+    return hr;
+}
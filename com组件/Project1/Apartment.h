@@ -0,0 +1,81 @@
+// Apartment.h - 单线程套间（STA）和跨线程代理
+// =====================================================
+// 对象固定在套间自己的线程上创建、调用和销毁，其他线程只拿到代理：
+//
+//   Apartment sta;
+//   ICalculator* p = nullptr;
+//   sta.CreateInstance(CLSID_Calculator, IID_ICalculator, (void**)&p);  // p 是代理
+//   // 任意线程：
+//   p->Add(1, 2, &r);  // 调用记录进入套间的队列，由套间线程执行后把结果交回
+//
+// 调用方式：
+//   - 调用记录就在调用方的栈上，入队是一次 CAS（无锁的多生产者队列），不分配内存、不加锁
+//   - 套间线程一次取走队列里的全部记录（一次 exchange），按提交顺序逐个执行
+//   - 只有队列从空变为非空、并且套间线程在睡眠时才唤醒它；负载高时多个调用共用一次唤醒
+//   - 调用方先短暂自旋等结果，仍未完成才睡眠；套间线程只在确实有人睡眠时才 notify。
+//     睡眠用的是套间自己的条件变量而不是记录里的原子量：调用方被唤醒后记录就会失效，
+//     notify 的对象必须比记录活得久
+//   - 在套间线程上调用代理（例如在对象的方法里回调）直接执行，不会自己等自己
+#pragma once
+#include "ComPlatform.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+// 投递到套间线程执行的一次调用（嵌在调用方栈上的具体记录里）
+struct ApartmentCall
+{
+    void                 (*invoke)(ApartmentCall* self);  // 在套间线程上执行，结果写回记录
+    ApartmentCall*        next;
+    std::atomic<uint32_t> state;  // 完成状态，见 Apartment.cpp
+    HRESULT               hr;
+};
+
+// 套间统计
+struct ApartmentStats
+{
+    uint64_t calls;    // 执行的调用数
+    uint64_t batches;  // 取队列的次数（calls / batches 就是平均每批的调用数）
+    uint64_t wakes;    // 套间线程被唤醒的次数
+};
+
+class Apartment
+{
+private:
+    alignas(64) std::atomic<ApartmentCall*> m_head;  // 调用方压入（后进先出），套间线程整体取走
+    std::atomic<bool>                       m_sleeping;
+    bool                                    m_stop;  // 只由套间线程读写
+
+    alignas(64) std::atomic<uint64_t> m_calls;
+    std::atomic<uint64_t>             m_batches;
+    std::atomic<uint64_t>             m_wakes;
+    std::thread                       m_thread;
+    std::thread::id                   m_threadId;
+
+    // 睡眠中的调用方共用（只有自旋后仍未完成的调用才用到）
+    std::mutex              m_waitLock;
+    std::condition_variable m_waitCv;
+
+    void ThreadMain();
+    void Complete(ApartmentCall* call);
+
+public:
+    Apartment();   // 启动套间线程
+    ~Apartment();  // 执行完已投递的调用后退出；之后不能再通过代理调用
+
+    Apartment(const Apartment&) = delete;
+    Apartment& operator=(const Apartment&) = delete;
+
+    // 在套间线程上创建对象，返回代理（目前支持 IID_ICalculator/IID_IUnknown）
+    // 对象和代理之间的引用关系：代理持有对象的一个引用，代理最后一次 Release 时在套间线程上释放对象
+    HRESULT CreateInstance(REFCLSID rclsid, REFIID riid, void** ppv);
+
+    // 同步执行：投递到套间线程并等待完成；在套间线程上调用时直接执行
+    HRESULT Invoke(ApartmentCall* call);
+
+    bool IsCurrentThread() const { return std::this_thread::get_id() == m_threadId; }
+
+    ApartmentStats GetStats() const;
+};
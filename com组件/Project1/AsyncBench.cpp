@@ -0,0 +1,142 @@
+// AsyncBench.cpp - IAsyncCalculator 吞吐量测试
+// =====================================================
+// 独立的测试程序（有自己的 main，已在项目中排除编译）
+// 测量在途调用数（outstanding）从 1 增加到 1024 时每秒完成的调用数：
+//   - future   ：保持 N 个 CalcFuture 在途，最早的完成后立即补一个新的
+//   - coroutine：N 个协程并发，每个协程顺序 co_await 自己的调用
+//   - batch    ：每次 SubmitBatch 提交 N 个请求，等整批完成（一次通知）
+// 同步调用 ICalculator::Add 作为对照
+//
+// Linux 编译：在仓库根目录 make（生成 build/AsyncBench）
+#include "StandardCOM.h"
+#include "AsyncTask.h"
+#include "WorkStealingPool.h"
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+using namespace std;
+
+static const int kCalls = 200000;  // 每项测试的总调用数
+
+static double Seconds(chrono::steady_clock::time_point begin)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+}
+
+static double RunFutures(IAsyncCalculator* p, int outstanding)
+{
+    vector<CalcFuture> window(outstanding);
+    long long sum = 0;
+
+    auto begin = chrono::steady_clock::now();
+    for (int i = 0; i < kCalls; ++i)
+    {
+        CalcFuture& slot = window[i % outstanding];
+        if (i >= outstanding) sum += slot.Get().value;
+        slot = StartAsync(p, AsyncOp_Add, i, 1);
+    }
+    for (CalcFuture& f : window) sum += f.Get().value;
+    double s = Seconds(begin);
+
+    if (sum != (long long)kCalls * (kCalls + 1) / 2) printf("  future: 结果错误！\n");
+    return kCalls / s;
+}
+
+static CalcTask<long long> Worker(IAsyncCalculator* p, int first, int count)
+{
+    long long sum = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        CalcResult r = co_await StartAsync(p, AsyncOp_Add, first + i, 1);
+        sum += r.value;
+    }
+    co_return sum;
+}
+
+static double RunCoroutines(IAsyncCalculator* p, int outstanding)
+{
+    int perTask = kCalls / outstanding;
+    vector<CalcTask<long long>> tasks;
+    tasks.reserve(outstanding);
+
+    auto begin = chrono::steady_clock::now();
+    for (int t = 0; t < outstanding; ++t) tasks.push_back(Worker(p, t * perTask, perTask));
+    long long sum = 0;
+    for (CalcTask<long long>& task : tasks) sum += task.Get();
+    double s = Seconds(begin);
+
+    long long n = (long long)perTask * outstanding;
+    if (sum != n * (n + 1) / 2) printf("  coroutine: 结果错误！\n");
+    return n / s;
+}
+
+static double RunBatches(IAsyncCalculator* p, int outstanding)
+{
+    vector<AsyncRequest> requests(outstanding);
+    int batches = kCalls / outstanding;
+
+    auto begin = chrono::steady_clock::now();
+    for (int b = 0; b < batches; ++b)
+    {
+        for (int i = 0; i < outstanding; ++i) requests[i] = { AsyncOp_Add, b, i, 0, S_OK };
+        IAsyncCall* call = nullptr;
+        if (FAILED(p->SubmitBatch(requests.data(), requests.size(), &call))) return 0;
+        call->Wait(nullptr);
+        call->Release();
+    }
+    double s = Seconds(begin);
+    return (double)batches * outstanding / s;
+}
+
+static double RunSync(ICalculator* p)
+{
+    long long sum = 0;
+    auto begin = chrono::steady_clock::now();
+    for (int i = 0; i < kCalls * 10; ++i)
+    {
+        int r;
+        p->Add(i, 1, &r);
+        sum += r;
+    }
+    double s = Seconds(begin);
+    if (sum == 42) printf(" ");  // 使用结果
+    return kCalls * 10 / s;
+}
+
+int main()
+{
+    IClassFactory* pFactory = nullptr;
+    ICalculator* pCalc = nullptr;
+    IAsyncCalculator* pAsync = nullptr;
+    if (FAILED(DllGetClassObject(CLSID_Calculator, IID_IClassFactory, (void**)&pFactory)) ||
+        FAILED(pFactory->CreateInstance(nullptr, IID_ICalculator, (void**)&pCalc)) ||
+        FAILED(pCalc->QueryInterface(IID_IAsyncCalculator, (void**)&pAsync)))
+    {
+        fprintf(stderr, "创建 Calculator 失败\n");
+        return 1;
+    }
+
+    WorkStealingPool& pool = WorkStealingPool::Default();
+    printf("IAsyncCalculator 吞吐量（%u 个工作线程，每项 %d 次调用）\n", pool.WorkerCount(), kCalls);
+    printf("同步 ICalculator::Add: %.2f Mcalls/s\n\n", RunSync(pCalc) / 1e6);
+
+    printf("%12s %16s %16s %16s\n", "outstanding", "future Mcalls/s", "coro Mcalls/s", "batch Mcalls/s");
+    for (int n = 1; n <= 1024; n *= 4)
+    {
+        double f = RunFutures(pAsync, n);
+        double c = RunCoroutines(pAsync, n);
+        double b = RunBatches(pAsync, n);
+        printf("%12d %16.3f %16.3f %16.3f\n", n, f / 1e6, c / 1e6, b / 1e6);
+    }
+
+    PoolCounters c = pool.GetCounters();
+    printf("\n线程池: executed %llu, stolen %llu, injected %llu, sleeps %llu\n",
+        (unsigned long long)c.executed, (unsigned long long)c.stolen,
+        (unsigned long long)c.injected, (unsigned long long)c.sleeps);
+
+    pAsync->Release();
+    pCalc->Release();
+    pFactory->Release();
+    return 0;
+}
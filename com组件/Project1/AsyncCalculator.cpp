@@ -0,0 +1,378 @@
+// AsyncCalculator.cpp - IAsyncCalculator 实现
+// =====================================================
+// 每次异步调用是一个引用计数的 AsyncCall 对象（IAsyncCall），同时也是线程池任务：
+//   - 创建时引用计数为 2：一个交给调用方，一个由"在途"的任务持有，执行完后释放
+//   - 对象来自专用的 slab 对象池，提交和完成都不调用 malloc
+//   - 完成状态用一个原子字：只有真的有线程在 Wait 时才 notify，只有注册了回调才回调
+//
+// 批量调用（SubmitBatch）把请求切成若干块，作为一串任务一次提交；
+// 每块完成时只减一个计数，最后一块完成时整个批次才完成一次（一次唤醒/回调）
+#include "StandardCOM.h"
+#include "ComLog.h"
+#include "InterfaceMap.h"
+#include "WorkStealingPool.h"
+#include <atomic>
+#include <new>
+
+namespace
+{
+    // 完成状态的各个位
+    enum : uint32_t
+    {
+        kDone        = 1,  // 已完成，m_hr/m_result 可读
+        kHasCallback = 2,  // 已注册回调
+        kHasWaiter   = 4,  // 有线程阻塞在 Wait 中
+        kRegistering = 8,  // 某个线程已经抢到注册回调的资格，正在写 m_callback/m_context
+    };
+
+    class AsyncCallBase : public IAsyncCall
+    {
+    protected:
+        RefCount              m_refCount;
+        std::atomic<uint32_t> m_state;
+        HRESULT               m_hr;
+        int                   m_result;
+        AsyncCallback         m_callback;
+        void*                 m_context;
+
+    public:
+        explicit AsyncCallBase(ULONG initialRefs)
+            : m_refCount(initialRefs)
+            , m_state(0)
+            , m_hr(E_PENDING)
+            , m_result(0)
+            , m_callback(nullptr)
+            , m_context(nullptr)
+        {
+        }
+
+        virtual ~AsyncCallBase() {}
+
+        // IUnknown 接口
+        virtual HRESULT __stdcall QueryInterface(REFIID riid, void** ppvObject) override;
+
+        virtual ULONG __stdcall AddRef() override
+        {
+            return m_refCount.Increment();
+        }
+
+        virtual ULONG __stdcall Release() override
+        {
+            ULONG count = m_refCount.Decrement();
+            if (count == 0) delete this;
+            return count;
+        }
+
+        // IAsyncCall 接口
+        virtual BOOL __stdcall IsCompleted() override
+        {
+            return (m_state.load(std::memory_order_acquire) & kDone) ? TRUE : FALSE;
+        }
+
+        virtual HRESULT __stdcall Wait(int* result) override
+        {
+            uint32_t s = m_state.load(std::memory_order_acquire);
+            while (!(s & kDone))
+            {
+                // 先登记"有人在等"，完成方看到这一位才会 notify
+                if (!(s & kHasWaiter))
+                {
+                    if (!m_state.compare_exchange_weak(s, s | kHasWaiter, std::memory_order_acquire))
+                        continue;
+                    s |= kHasWaiter;
+                }
+                m_state.wait(s, std::memory_order_acquire);
+                s = m_state.load(std::memory_order_acquire);
+            }
+            if (result) *result = m_result;
+            return m_hr;
+        }
+
+        virtual HRESULT __stdcall GetResult(int* result) override
+        {
+            if (!(m_state.load(std::memory_order_acquire) & kDone)) return E_PENDING;
+            if (result) *result = m_result;
+            return m_hr;
+        }
+
+        virtual HRESULT __stdcall OnCompleted(AsyncCallback callback, void* context) override
+        {
+            if (!callback) return E_POINTER;
+
+            // 先用 CAS 抢到 kRegistering，只有抢到的线程才能写回调，两次并发注册不会交错
+            uint32_t s = m_state.load(std::memory_order_acquire);
+            do
+            {
+                if (s & kDone) return S_FALSE;
+                if (s & (kHasCallback | kRegistering)) return E_UNEXPECTED;
+            } while (!m_state.compare_exchange_weak(s, s | kRegistering,
+                         std::memory_order_acquire, std::memory_order_acquire));
+
+            // 再用 release 发布 kHasCallback；完成方 acq_rel 读到这一位后才调用。
+            // 写的过程中已经完成：完成方看不到 kHasCallback，不会回调，这里返回 S_FALSE（与注册前就完成一样）
+            m_callback = callback;
+            m_context = context;
+            s = m_state.fetch_or(kHasCallback, std::memory_order_acq_rel);
+            return (s & kDone) ? S_FALSE : S_OK;
+        }
+
+    protected:
+        // 只由执行任务的工作线程调用一次；调用方仍持有"在途"引用，回调里释放调用方引用也安全
+        void Complete(HRESULT hr, int result)
+        {
+            m_hr = hr;
+            m_result = result;
+            uint32_t s = m_state.fetch_or(kDone, std::memory_order_acq_rel);
+            if (s & kHasWaiter) m_state.notify_all();
+            if (s & kHasCallback) m_callback(m_context);
+        }
+    };
+
+    static constexpr InterfaceEntry s_asyncCallInterfaces[] =
+    {
+        COM_INTERFACE_ENTRY(AsyncCallBase, IAsyncCall),
+        COM_INTERFACE_ENTRY2(AsyncCallBase, IUnknown, IAsyncCall),
+    };
+    static constinit InterfaceMap s_asyncCallMap("[AsyncCall]", s_asyncCallInterfaces);
+
+    HRESULT __stdcall AsyncCallBase::QueryInterface(REFIID riid, void** ppvObject)
+    {
+        return s_asyncCallMap.Query(this, riid, ppvObject);
+    }
+
+
+    // ========================================
+    // 单次调用
+    // ========================================
+
+    SlabPool& AsyncCallPool();
+
+    class AsyncCall final : public AsyncCallBase, private PoolTask
+    {
+    private:
+        Calculator* m_calc;  // 在途期间持有一个引用
+        AsyncOp     m_op;
+        int         m_a;
+        int         m_b;
+
+    public:
+        AsyncCall(Calculator* calc, AsyncOp op, int a, int b)
+            : AsyncCallBase(2)  // 调用方 + 在途任务
+            , m_calc(calc)
+            , m_op(op)
+            , m_a(a)
+            , m_b(b)
+        {
+            m_calc->AddRef();
+            run = &Run;
+            next = nullptr;
+        }
+
+        static void* operator new(size_t size) noexcept
+        {
+            if (size != sizeof(AsyncCall)) return ::operator new(size, std::nothrow);
+            return AsyncCallPool().Allocate();
+        }
+
+        static void operator delete(void* p, size_t size) noexcept
+        {
+            if (size != sizeof(AsyncCall))
+            {
+                ::operator delete(p);
+                return;
+            }
+            AsyncCallPool().Free(p);
+        }
+
+        void Start()
+        {
+            WorkStealingPool::Default().Submit(this);
+        }
+
+    private:
+        static void Run(PoolTask* task)
+        {
+            AsyncCall* self = static_cast<AsyncCall*>(task);
+
+            int result = 0;
+            HRESULT hr = self->m_calc->Execute(self->m_op, self->m_a, self->m_b, &result);
+            self->m_calc->Release();
+            self->m_calc = nullptr;
+
+            self->Complete(hr, result);
+            self->Release();  // 释放在途引用
+        }
+    };
+
+    // 对象池故意不销毁：进程退出时可能还有调用在途
+    SlabPool& AsyncCallPool()
+    {
+        static SlabPool* pool = new SlabPool(sizeof(AsyncCall));
+        return *pool;
+    }
+
+
+    // ========================================
+    // 批量调用
+    // ========================================
+
+    const size_t kBatchChunk = 1024;  // 每个任务处理的请求数
+
+    class AsyncBatchCall final : public AsyncCallBase
+    {
+    private:
+        struct Chunk : PoolTask
+        {
+            AsyncBatchCall* owner;
+            size_t          begin;
+            size_t          end;
+        };
+
+        Calculator*         m_calc;
+        AsyncRequest*       m_requests;
+        Chunk*              m_chunks;
+        size_t              m_chunkCount;
+        std::atomic<size_t> m_remaining;  // 还没完成的块数
+        std::atomic<int>    m_failed;     // 失败的请求数
+
+    public:
+        AsyncBatchCall(Calculator* calc, AsyncRequest* requests, size_t count)
+            : AsyncCallBase(2)
+            , m_calc(calc)
+            , m_requests(requests)
+            , m_chunks(nullptr)
+            , m_chunkCount((count + kBatchChunk - 1) / kBatchChunk)
+            , m_remaining(m_chunkCount)
+            , m_failed(0)
+        {
+            m_calc->AddRef();
+            m_chunks = new (std::nothrow) Chunk[m_chunkCount];
+            if (!m_chunks) return;
+
+            for (size_t i = 0; i < m_chunkCount; ++i)
+            {
+                Chunk& c = m_chunks[i];
+                c.run = &RunChunk;
+                c.next = i + 1 < m_chunkCount ? &m_chunks[i + 1] : nullptr;
+                c.owner = this;
+                c.begin = i * kBatchChunk;
+                c.end = c.begin + kBatchChunk < count ? c.begin + kBatchChunk : count;
+            }
+        }
+
+        virtual ~AsyncBatchCall()
+        {
+            if (m_calc) m_calc->Release();  // 只有创建失败、没有提交时才会走到这里
+            delete[] m_chunks;
+        }
+
+        bool Valid() const { return m_chunks != nullptr; }
+
+        void Start()
+        {
+            // 所有块一次入队（一次加锁、一次唤醒）
+            WorkStealingPool::Default().SubmitList(&m_chunks[0], &m_chunks[m_chunkCount - 1], m_chunkCount);
+        }
+
+    private:
+        static void RunChunk(PoolTask* task)
+        {
+            Chunk* chunk = static_cast<Chunk*>(task);
+            AsyncBatchCall* self = chunk->owner;
+
+            int failed = 0;
+            for (size_t i = chunk->begin; i < chunk->end; ++i)
+            {
+                AsyncRequest& r = self->m_requests[i];
+                r.hr = self->m_calc->Execute(r.op, r.a, r.b, &r.result);
+                if (FAILED(r.hr)) ++failed;
+            }
+            if (failed) self->m_failed.fetch_add(failed, std::memory_order_relaxed);
+
+            // 最后完成的块负责完成整个批次
+            if (self->m_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                self->m_calc->Release();
+                self->m_calc = nullptr;
+
+                int totalFailed = self->m_failed.load(std::memory_order_relaxed);
+                self->Complete(totalFailed ? S_FALSE : S_OK, totalFailed);
+                self->Release();
+            }
+        }
+    };
+}
+
+
+// ========================================
+// Calculator 的 IAsyncCalculator 实现
+// ========================================
+
+HRESULT Calculator::Execute(AsyncOp op, int a, int b, int* result)
+{
+    // 直接调用运算核心（不经过虚函数表，可以内联）
+    switch (op)
+    {
+    case AsyncOp_Add:      return Direct().Add(a, b, result);
+    case AsyncOp_Subtract: return Direct().Subtract(a, b, result);
+    case AsyncOp_Multiply: return Direct().Multiply(a, b, result);
+    case AsyncOp_Divide:   return Direct().Divide(a, b, result);
+    }
+    return E_INVALIDARG;
+}
+
+static HRESULT StartAsyncCall(Calculator* calc, AsyncOp op, int a, int b, IAsyncCall** ppCall)
+{
+    if (!ppCall) return E_POINTER;
+    *ppCall = nullptr;
+
+    AsyncCall* call = new AsyncCall(calc, op, a, b);
+    if (!call) return E_OUTOFMEMORY;
+
+    COM_LOG_TRACE("[Calculator] 异步调用提交: op = {}, a = {}, b = {}", (int)op, a, b);
+    *ppCall = call;  // 初始引用之一交给调用方
+    call->Start();
+    return S_OK;
+}
+
+HRESULT __stdcall Calculator::AddAsync(int a, int b, IAsyncCall** ppCall)
+{
+    return StartAsyncCall(this, AsyncOp_Add, a, b, ppCall);
+}
+
+HRESULT __stdcall Calculator::SubtractAsync(int a, int b, IAsyncCall** ppCall)
+{
+    return StartAsyncCall(this, AsyncOp_Subtract, a, b, ppCall);
+}
+
+HRESULT __stdcall Calculator::MultiplyAsync(int a, int b, IAsyncCall** ppCall)
+{
+    return StartAsyncCall(this, AsyncOp_Multiply, a, b, ppCall);
+}
+
+HRESULT __stdcall Calculator::DivideAsync(int a, int b, IAsyncCall** ppCall)
+{
+    return StartAsyncCall(this, AsyncOp_Divide, a, b, ppCall);
+}
+
+HRESULT __stdcall Calculator::SubmitBatch(AsyncRequest* requests, size_t count, IAsyncCall** ppCall)
+{
+    if (!ppCall) return E_POINTER;
+    *ppCall = nullptr;
+    if (count == 0) return E_INVALIDARG;
+    if (!requests) return E_POINTER;
+
+    AsyncBatchCall* call = new (std::nothrow) AsyncBatchCall(this, requests, count);
+    if (!call) return E_OUTOFMEMORY;
+    if (!call->Valid())
+    {
+        call->Release();  // 两个初始引用
+        call->Release();
+        return E_OUTOFMEMORY;
+    }
+
+    COM_LOG_TRACE("[Calculator] 批量异步提交: count = {}", count);
+    *ppCall = call;
+    call->Start();
+    return S_OK;
+}
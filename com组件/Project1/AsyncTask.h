@@ -0,0 +1,212 @@
+// AsyncTask.h - IAsyncCalculator 的 C++20 协程适配（只有头文件）
+// =====================================================
+// CalcFuture：持有一次异步调用（IAsyncCall 的一个引用），两种用法：
+//
+//   CalcFuture f = StartAsync(pAsync, AsyncOp_Add, 1, 2);
+//   CalcResult r = f.Get();                 // 阻塞等待
+//
+//   CalcTask<int> Sum(IAsyncCalculator* p)  // 协程：co_await 不阻塞线程，
+//   {                                       // 调用完成后在线程池的工作线程上继续执行
+//       CalcResult x = co_await StartAsync(p, AsyncOp_Add, 1, 2);
+//       CalcResult y = co_await StartAsync(p, AsyncOp_Multiply, x.value, 10);
+//       co_return y.value;
+//   }
+//
+// CalcTask<T>：立即开始执行的协程返回类型，可以 Get() 阻塞等待，也可以被其他协程 co_await
+#pragma once
+#include "StandardCOM.h"
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <utility>
+
+struct CalcResult
+{
+    HRESULT hr;
+    int     value;
+};
+
+class CalcFuture
+{
+private:
+    IAsyncCall* m_call;
+    HRESULT     m_hr;  // 发起调用失败时的错误码（此时 m_call 为空）
+
+    static void __stdcall Resume(void* context)
+    {
+        std::coroutine_handle<>::from_address(context).resume();
+    }
+
+public:
+    CalcFuture() noexcept : m_call(nullptr), m_hr(E_UNEXPECTED) {}
+
+    // 接管 call 的一个引用
+    CalcFuture(IAsyncCall* call, HRESULT hr) noexcept : m_call(call), m_hr(hr) {}
+
+    CalcFuture(CalcFuture&& other) noexcept : m_call(other.m_call), m_hr(other.m_hr)
+    {
+        other.m_call = nullptr;
+    }
+
+    CalcFuture& operator=(CalcFuture&& other) noexcept
+    {
+        std::swap(m_call, other.m_call);
+        std::swap(m_hr, other.m_hr);
+        return *this;
+    }
+
+    CalcFuture(const CalcFuture&) = delete;
+    CalcFuture& operator=(const CalcFuture&) = delete;
+
+    ~CalcFuture()
+    {
+        if (m_call) m_call->Release();
+    }
+
+    bool IsReady() const { return !m_call || m_call->IsCompleted(); }
+
+    // 阻塞到完成
+    CalcResult Get()
+    {
+        if (!m_call) return { m_hr, 0 };
+        int value = 0;
+        HRESULT hr = m_call->Wait(&value);
+        return { hr, value };
+    }
+
+    // co_await 支持：已完成时不挂起；否则注册回调，完成时在工作线程上恢复协程
+    bool await_ready() const { return IsReady(); }
+
+    bool await_suspend(std::coroutine_handle<> h)
+    {
+        return m_call->OnCompleted(&Resume, h.address()) == S_OK;  // S_FALSE：刚好完成，直接继续
+    }
+
+    CalcResult await_resume()
+    {
+        if (!m_call) return { m_hr, 0 };
+        int value = 0;
+        HRESULT hr = m_call->GetResult(&value);
+        return { hr, value };
+    }
+};
+
+// 发起一次异步调用
+inline CalcFuture StartAsync(IAsyncCalculator* p, AsyncOp op, int a, int b)
+{
+    IAsyncCall* call = nullptr;
+    HRESULT hr = E_INVALIDARG;
+    switch (op)
+    {
+    case AsyncOp_Add:      hr = p->AddAsync(a, b, &call); break;
+    case AsyncOp_Subtract: hr = p->SubtractAsync(a, b, &call); break;
+    case AsyncOp_Multiply: hr = p->MultiplyAsync(a, b, &call); break;
+    case AsyncOp_Divide:   hr = p->DivideAsync(a, b, &call); break;
+    }
+    return CalcFuture(SUCCEEDED(hr) ? call : nullptr, hr);
+}
+
+
+template <class T>
+class CalcTask
+{
+public:
+    struct promise_type;
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    struct promise_type
+    {
+        T                  value{};
+        std::exception_ptr error;
+
+        // nullptr：运行中；DoneMark()：已完成；其他：等待它的协程句柄
+        std::atomic<void*> state{ nullptr };
+        // 协程帧由 CalcTask 和协程本身共同持有，最后一个释放的负责销毁
+        // （完成方在 notify 之后还要访问帧，不能让等待方先销毁它）
+        std::atomic<int>   refs{ 2 };
+
+        static void* DoneMark() { return reinterpret_cast<void*>(1); }
+
+        CalcTask get_return_object() { return CalcTask(handle_type::from_promise(*this)); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+
+        struct FinalAwaiter
+        {
+            bool await_ready() noexcept { return false; }
+
+            std::coroutine_handle<> await_suspend(handle_type h) noexcept
+            {
+                promise_type& p = h.promise();
+                void* waiter = p.state.exchange(DoneMark(), std::memory_order_acq_rel);
+                p.state.notify_all();
+                if (p.refs.fetch_sub(1, std::memory_order_acq_rel) == 1) h.destroy();
+                if (waiter) return std::coroutine_handle<>::from_address(waiter);
+                return std::noop_coroutine();
+            }
+
+            void await_resume() noexcept {}
+        };
+
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void return_value(T v) { value = std::move(v); }
+        void unhandled_exception() { error = std::current_exception(); }
+    };
+
+    CalcTask(CalcTask&& other) noexcept : m_handle(std::exchange(other.m_handle, nullptr)) {}
+    CalcTask(const CalcTask&) = delete;
+    CalcTask& operator=(const CalcTask&) = delete;
+    CalcTask& operator=(CalcTask&&) = delete;
+
+    ~CalcTask()
+    {
+        if (m_handle && m_handle.promise().refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            m_handle.destroy();
+    }
+
+    bool IsReady() const
+    {
+        return m_handle.promise().state.load(std::memory_order_acquire) == promise_type::DoneMark();
+    }
+
+    // 阻塞到协程结束；同一个任务只能 Get 或 co_await 其中之一
+    T Get()
+    {
+        promise_type& p = m_handle.promise();
+        void* s;
+        while ((s = p.state.load(std::memory_order_acquire)) != promise_type::DoneMark())
+            p.state.wait(s, std::memory_order_acquire);
+        if (p.error) std::rethrow_exception(p.error);
+        return std::move(p.value);
+    }
+
+    // 在另一个协程里 co_await
+    struct Awaiter
+    {
+        handle_type h;
+
+        bool await_ready() const
+        {
+            return h.promise().state.load(std::memory_order_acquire) == promise_type::DoneMark();
+        }
+
+        bool await_suspend(std::coroutine_handle<> waiter)
+        {
+            void* expected = nullptr;
+            return h.promise().state.compare_exchange_strong(expected, waiter.address(),
+                std::memory_order_acq_rel, std::memory_order_acquire);  // 失败说明已经完成
+        }
+
+        T await_resume()
+        {
+            if (h.promise().error) std::rethrow_exception(h.promise().error);
+            return std::move(h.promise().value);
+        }
+    };
+
+    Awaiter operator co_await() & { return Awaiter{ m_handle }; }
+
+private:
+    explicit CalcTask(handle_type h) : m_handle(h) {}
+
+    handle_type m_handle;
+};
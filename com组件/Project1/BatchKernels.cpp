@@ -0,0 +1,538 @@
+// BatchKernels.cpp - 整数数组四则运算内核实现
+#include "BatchKernels.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define BATCH_HAS_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#else
+#define BATCH_HAS_X86 0
+#endif
+
+// GCC/Clang 需要给使用高级指令集的函数单独打开目标特性
+// MSVC 允许直接使用所有 intrinsics，不需要标注
+#if defined(__GNUC__)
+#define BATCH_TARGET(x) __attribute__((target(x)))
+#else
+#define BATCH_TARGET(x)
+#endif
+
+
+// ========================================
+// Scalar：对照标准
+// ========================================
+// 用无符号运算实现补码回绕，避免有符号溢出的未定义行为
+
+static void ScalarAdd(const int* a, const int* b, int* out, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        out[i] = (int)((unsigned)a[i] + (unsigned)b[i]);
+}
+
+static void ScalarSub(const int* a, const int* b, int* out, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        out[i] = (int)((unsigned)a[i] - (unsigned)b[i]);
+}
+
+static void ScalarMul(const int* a, const int* b, int* out, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        out[i] = (int)((unsigned)a[i] * (unsigned)b[i]);
+}
+
+static void ScalarDiv(const int* a, const int* b, int* out, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+    {
+        // INT_MIN / -1 会溢出，按回绕处理为 INT_MIN（与 SIMD 内核一致）
+        out[i] = (b[i] == -1) ? (int)(0u - (unsigned)a[i]) : a[i] / b[i];
+    }
+}
+
+static bool ScalarHasZero(const int* b, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        if (b[i] == 0) return true;
+    return false;
+}
+
+static void ScalarDivBy(const int* a, const BatchDivisor& d, int* out, size_t n)
+{
+    for (size_t i = 0; i < n; ++i)
+        out[i] = BatchDivide(a[i], d);
+}
+
+static const BatchKernelTable s_scalarKernels =
+{
+    BatchIsa::Scalar, "Scalar",
+    ScalarAdd, ScalarSub, ScalarMul, ScalarDiv, ScalarHasZero, ScalarDivBy,
+};
+
+
+#if BATCH_HAS_X86
+
+// 说明：
+//   除法没有整数 SIMD 指令，这里转成 double 计算再向零截断
+//   |a| < 2^53，double 商的舍入误差不会跨过整数边界，所以结果与整数除法逐位一致
+//   不变除数（divBy）用 32x32 → 64 位乘法取高 32 位，再加减、移位，全部是整数指令
+
+// ========================================
+// SSE2：每次 4 个 int
+// ========================================
+
+BATCH_TARGET("sse2")
+static void Sse2Add(const int* a, const int* b, int* out, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_add_epi32(va, vb));
+    }
+    ScalarAdd(a + i, b + i, out + i, n - i);
+}
+
+BATCH_TARGET("sse2")
+static void Sse2Sub(const int* a, const int* b, int* out, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_sub_epi32(va, vb));
+    }
+    ScalarSub(a + i, b + i, out + i, n - i);
+}
+
+BATCH_TARGET("sse2")
+static void Sse2Mul(const int* a, const int* b, int* out, size_t n)
+{
+    // SSE2 没有 32 位低位乘法（_mm_mullo_epi32 是 SSE4.1）
+    // 用两次 _mm_mul_epu32 分别算偶数/奇数通道，再拼回来（低 32 位与有符号乘法相同）
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+        __m128i even = _mm_mul_epu32(va, vb);
+        __m128i odd = _mm_mul_epu32(_mm_srli_si128(va, 4), _mm_srli_si128(vb, 4));
+        __m128i r = _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                                       _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+        _mm_storeu_si128((__m128i*)(out + i), r);
+    }
+    ScalarMul(a + i, b + i, out + i, n - i);
+}
+
+BATCH_TARGET("sse2")
+static void Sse2Div(const int* a, const int* b, int* out, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+        __m128d lo = _mm_div_pd(_mm_cvtepi32_pd(va), _mm_cvtepi32_pd(vb));
+        __m128d hi = _mm_div_pd(_mm_cvtepi32_pd(_mm_srli_si128(va, 8)),
+                                _mm_cvtepi32_pd(_mm_srli_si128(vb, 8)));
+        __m128i r = _mm_unpacklo_epi64(_mm_cvttpd_epi32(lo), _mm_cvttpd_epi32(hi));
+        _mm_storeu_si128((__m128i*)(out + i), r);
+    }
+    ScalarDiv(a + i, b + i, out + i, n - i);
+}
+
+BATCH_TARGET("sse2")
+static bool Sse2HasZero(const int* b, size_t n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(vb, zero)) != 0) return true;
+    }
+    return ScalarHasZero(b + i, n - i);
+}
+
+BATCH_TARGET("sse2")
+static void Sse2DivBy(const int* a, const BatchDivisor& d, int* out, size_t n)
+{
+    // SSE2 只有无符号的 _mm_mul_epu32，有符号高位 = 无符号高位 - (a < 0 ? magic : 0) - (magic < 0 ? a : 0)
+    const __m128i magic = _mm_set1_epi32(d.magic);
+    const __m128i magicNeg = _mm_set1_epi32(d.magic < 0 ? -1 : 0);
+    const __m128i oddMask = _mm_set_epi32(-1, 0, -1, 0);
+    const __m128i addMask = _mm_set1_epi32(d.addMask);
+    const __m128i addSign = _mm_set1_epi32(d.addSign);
+    const __m128i roundMask = _mm_set1_epi32(d.roundMask);
+    const __m128i shift = _mm_cvtsi32_si128(d.shift);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i even = _mm_srli_epi64(_mm_mul_epu32(va, magic), 32);
+        __m128i odd = _mm_and_si128(_mm_mul_epu32(_mm_srli_epi64(va, 32), magic), oddMask);
+        __m128i hi = _mm_or_si128(even, odd);
+        hi = _mm_sub_epi32(hi, _mm_and_si128(_mm_srai_epi32(va, 31), magic));
+        hi = _mm_sub_epi32(hi, _mm_and_si128(va, magicNeg));
+        __m128i t = _mm_and_si128(_mm_sub_epi32(_mm_xor_si128(va, addSign), addSign), addMask);
+        __m128i q = _mm_sra_epi32(_mm_add_epi32(hi, t), shift);
+        q = _mm_add_epi32(q, _mm_and_si128(_mm_srli_epi32(q, 31), roundMask));
+        _mm_storeu_si128((__m128i*)(out + i), q);
+    }
+    ScalarDivBy(a + i, d, out + i, n - i);
+}
+
+static const BatchKernelTable s_sse2Kernels =
+{
+    BatchIsa::SSE2, "SSE2",
+    Sse2Add, Sse2Sub, Sse2Mul, Sse2Div, Sse2HasZero, Sse2DivBy,
+};
+
+
+// ========================================
+// AVX2：每次 8 个 int
+// ========================================
+
+BATCH_TARGET("avx2")
+static void Avx2Add(const int* a, const int* b, int* out, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_add_epi32(va, vb));
+    }
+    ScalarAdd(a + i, b + i, out + i, n - i);
+}
+
+BATCH_TARGET("avx2")
+static void Avx2Sub(const int* a, const int* b, int* out, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_sub_epi32(va, vb));
+    }
+    ScalarSub(a + i, b + i, out + i, n - i);
+}
+
+BATCH_TARGET("avx2")
+static void Avx2Mul(const int* a, const int* b, int* out, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_mullo_epi32(va, vb));
+    }
+    ScalarMul(a + i, b + i, out + i, n - i);
+}
+
+BATCH_TARGET("avx2")
+static void Avx2Div(const int* a, const int* b, int* out, size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        __m256d va = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)(a + i)));
+        __m256d vb = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)(b + i)));
+        _mm_storeu_si128((__m128i*)(out + i), _mm256_cvttpd_epi32(_mm256_div_pd(va, vb)));
+    }
+    ScalarDiv(a + i, b + i, out + i, n - i);
+}
+
+BATCH_TARGET("avx2")
+static bool Avx2HasZero(const int* b, size_t n)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(vb, zero)) != 0) return true;
+    }
+    return ScalarHasZero(b + i, n - i);
+}
+
+BATCH_TARGET("avx2")
+static void Avx2DivBy(const int* a, const BatchDivisor& d, int* out, size_t n)
+{
+    // _mm256_mul_epi32 只乘偶数通道：奇数通道右移 32 位后再乘一次，两次结果的高 32 位拼起来
+    const __m256i magic = _mm256_set1_epi32(d.magic);
+    const __m256i addMask = _mm256_set1_epi32(d.addMask);
+    const __m256i addSign = _mm256_set1_epi32(d.addSign);
+    const __m256i roundMask = _mm256_set1_epi32(d.roundMask);
+    const __m128i shift = _mm_cvtsi32_si128(d.shift);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i even = _mm256_srli_epi64(_mm256_mul_epi32(va, magic), 32);
+        __m256i odd = _mm256_mul_epi32(_mm256_srli_epi64(va, 32), magic);
+        __m256i hi = _mm256_blend_epi32(even, odd, 0xAA);
+        __m256i t = _mm256_and_si256(_mm256_sub_epi32(_mm256_xor_si256(va, addSign), addSign), addMask);
+        __m256i q = _mm256_sra_epi32(_mm256_add_epi32(hi, t), shift);
+        q = _mm256_add_epi32(q, _mm256_and_si256(_mm256_srli_epi32(q, 31), roundMask));
+        _mm256_storeu_si256((__m256i*)(out + i), q);
+    }
+    ScalarDivBy(a + i, d, out + i, n - i);
+}
+
+static const BatchKernelTable s_avx2Kernels =
+{
+    BatchIsa::AVX2, "AVX2",
+    Avx2Add, Avx2Sub, Avx2Mul, Avx2Div, Avx2HasZero, Avx2DivBy,
+};
+
+
+// ========================================
+// AVX-512：每次 16 个 int
+// ========================================
+
+// GCC 的非掩码写法（_mm512_cvtepi32_pd 等）内部以未初始化的值作为源操作数，-Wall 下会报 -Wmaybe-uninitialized；
+// 这些指令改用全 1 掩码的 maskz 形式（源操作数是 0，结果相同）
+static const __mmask8  kAll8 = 0xFF;
+static const __mmask16 kAll16 = 0xFFFF;
+
+BATCH_TARGET("avx512f")
+static void Avx512Add(const int* a, const int* b, int* out, size_t n)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m512i va = _mm512_loadu_si512((const void*)(a + i));
+        __m512i vb = _mm512_loadu_si512((const void*)(b + i));
+        _mm512_storeu_si512((void*)(out + i), _mm512_add_epi32(va, vb));
+    }
+    ScalarAdd(a + i, b + i, out + i, n - i);
+}
+
+BATCH_TARGET("avx512f")
+static void Avx512Sub(const int* a, const int* b, int* out, size_t n)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m512i va = _mm512_loadu_si512((const void*)(a + i));
+        __m512i vb = _mm512_loadu_si512((const void*)(b + i));
+        _mm512_storeu_si512((void*)(out + i), _mm512_sub_epi32(va, vb));
+    }
+    ScalarSub(a + i, b + i, out + i, n - i);
+}
+
+BATCH_TARGET("avx512f")
+static void Avx512Mul(const int* a, const int* b, int* out, size_t n)
+{
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m512i va = _mm512_loadu_si512((const void*)(a + i));
+        __m512i vb = _mm512_loadu_si512((const void*)(b + i));
+        _mm512_storeu_si512((void*)(out + i), _mm512_mullo_epi32(va, vb));
+    }
+    ScalarMul(a + i, b + i, out + i, n - i);
+}
+
+BATCH_TARGET("avx512f")
+static void Avx512Div(const int* a, const int* b, int* out, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        __m512d va = _mm512_maskz_cvtepi32_pd(kAll8, _mm256_loadu_si256((const __m256i*)(a + i)));
+        __m512d vb = _mm512_maskz_cvtepi32_pd(kAll8, _mm256_loadu_si256((const __m256i*)(b + i)));
+        _mm256_storeu_si256((__m256i*)(out + i), _mm512_maskz_cvttpd_epi32(kAll8, _mm512_div_pd(va, vb)));
+    }
+    ScalarDiv(a + i, b + i, out + i, n - i);
+}
+
+BATCH_TARGET("avx512f")
+static bool Avx512HasZero(const int* b, size_t n)
+{
+    const __m512i zero = _mm512_setzero_si512();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m512i vb = _mm512_loadu_si512((const void*)(b + i));
+        if (_mm512_cmpeq_epi32_mask(vb, zero) != 0) return true;
+    }
+    return ScalarHasZero(b + i, n - i);
+}
+
+BATCH_TARGET("avx512f")
+static void Avx512DivBy(const int* a, const BatchDivisor& d, int* out, size_t n)
+{
+    const __m512i magic = _mm512_set1_epi32(d.magic);
+    const __m512i addMask = _mm512_set1_epi32(d.addMask);
+    const __m512i addSign = _mm512_set1_epi32(d.addSign);
+    const __m512i roundMask = _mm512_set1_epi32(d.roundMask);
+    const __m128i shift = _mm_cvtsi32_si128(d.shift);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m512i va = _mm512_loadu_si512((const void*)(a + i));
+        __m512i even = _mm512_maskz_srli_epi64(kAll8, _mm512_maskz_mul_epi32(kAll8, va, magic), 32);
+        __m512i odd = _mm512_maskz_mul_epi32(kAll8, _mm512_maskz_srli_epi64(kAll8, va, 32), magic);
+        __m512i hi = _mm512_mask_blend_epi32(0xAAAA, even, odd);
+        __m512i t = _mm512_and_si512(_mm512_sub_epi32(_mm512_xor_si512(va, addSign), addSign), addMask);
+        __m512i q = _mm512_maskz_sra_epi32(kAll16, _mm512_add_epi32(hi, t), shift);
+        q = _mm512_add_epi32(q, _mm512_and_si512(_mm512_maskz_srli_epi32(kAll16, q, 31), roundMask));
+        _mm512_storeu_si512((void*)(out + i), q);
+    }
+    ScalarDivBy(a + i, d, out + i, n - i);
+}
+
+static const BatchKernelTable s_avx512Kernels =
+{
+    BatchIsa::AVX512, "AVX512",
+    Avx512Add, Avx512Sub, Avx512Mul, Avx512Div, Avx512HasZero, Avx512DivBy,
+};
+
+
+// ========================================
+// CPUID 检测
+// ========================================
+
+#ifdef _MSC_VER
+
+// 除了 CPUID 位，还要确认操作系统保存了对应的寄存器状态（XCR0）
+static bool CpuSupports(BatchIsa isa)
+{
+    int info[4] = {};
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+
+    __cpuid(info, 1);
+    const bool sse2 = (info[3] & (1 << 26)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (isa == BatchIsa::SSE2) return sse2;
+    if (!osxsave || !avx || maxLeaf < 7) return false;
+
+    const unsigned long long xcr0 = _xgetbv(0);
+    __cpuidex(info, 7, 0);
+    if (isa == BatchIsa::AVX2)
+        return (xcr0 & 0x06) == 0x06 && (info[1] & (1 << 5)) != 0;
+    if (isa == BatchIsa::AVX512)
+        return (xcr0 & 0xE6) == 0xE6 && (info[1] & (1 << 16)) != 0;
+    return false;
+}
+
+#else
+
+// __builtin_cpu_supports 已经检查了 XCR0
+static bool CpuSupports(BatchIsa isa)
+{
+    __builtin_cpu_init();
+    switch (isa)
+    {
+    case BatchIsa::SSE2:   return __builtin_cpu_supports("sse2");
+    case BatchIsa::AVX2:   return __builtin_cpu_supports("avx2");
+    case BatchIsa::AVX512: return __builtin_cpu_supports("avx512f");
+    default:               return false;
+    }
+}
+
+#endif  // _MSC_VER
+
+#endif  // BATCH_HAS_X86
+
+
+// ========================================
+// 不变除数的乘数和移位量
+// ========================================
+// 《Hacker's Delight》图 10-1：找最小的 p >= 32，使 2^p / |d| 向上取整后的乘数误差不影响任何 32 位被除数的商
+// 乘数超过 2^31 时按有符号数保存，运行时再加回被除数（addMask），除数为负时取反（addSign）
+
+bool PrepareBatchDivisor(int divisor, BatchDivisor* prepared)
+{
+    if (divisor == 0 || !prepared) return false;
+
+    BatchDivisor d = {};
+    d.divisor = divisor;
+    if (divisor == 1 || divisor == -1)
+    {
+        // 乘数为 0，商就是 ±a（-1 时按回绕，INT_MIN / -1 = INT_MIN，与 div 一致）
+        d.addMask = -1;
+        d.addSign = divisor < 0 ? -1 : 0;
+        *prepared = d;
+        return true;
+    }
+
+    const unsigned two31 = 0x80000000u;
+    const unsigned ad = divisor < 0 ? 0u - (unsigned)divisor : (unsigned)divisor;
+    const unsigned t = two31 + ((unsigned)divisor >> 31);
+    const unsigned anc = t - 1 - t % ad;  // |nc|
+    int p = 31;
+    unsigned q1 = two31 / anc, r1 = two31 - q1 * anc;
+    unsigned q2 = two31 / ad, r2 = two31 - q2 * ad;
+    unsigned delta;
+    do
+    {
+        ++p;
+        q1 *= 2; r1 *= 2;
+        if (r1 >= anc) { ++q1; r1 -= anc; }
+        q2 *= 2; r2 *= 2;
+        if (r2 >= ad) { ++q2; r2 -= ad; }
+        delta = ad - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+
+    unsigned magic = q2 + 1;
+    if (divisor < 0) magic = 0u - magic;
+    d.magic = (int)magic;
+    d.shift = p - 32;
+    if (divisor > 0 && d.magic < 0) d.addMask = -1;  // 加上被除数
+    if (divisor < 0 && d.magic > 0)
+    {
+        d.addMask = -1;                               // 减去被除数
+        d.addSign = -1;
+    }
+    d.roundMask = -1;
+    *prepared = d;
+    return true;
+}
+
+
+const BatchKernelTable* GetBatchKernels(BatchIsa isa)
+{
+    switch (isa)
+    {
+    case BatchIsa::Scalar:
+        return &s_scalarKernels;
+#if BATCH_HAS_X86
+    case BatchIsa::SSE2:
+        return CpuSupports(isa) ? &s_sse2Kernels : nullptr;
+    case BatchIsa::AVX2:
+        return CpuSupports(isa) ? &s_avx2Kernels : nullptr;
+    case BatchIsa::AVX512:
+        return CpuSupports(isa) ? &s_avx512Kernels : nullptr;
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+static const BatchKernelTable& SelectBestBatchKernels()
+{
+    const BatchIsa order[] = { BatchIsa::AVX512, BatchIsa::AVX2, BatchIsa::SSE2 };
+    for (BatchIsa isa : order)
+    {
+        if (const BatchKernelTable* table = GetBatchKernels(isa))
+            return *table;
+    }
+    return s_scalarKernels;
+}
+
+const BatchKernelTable& GetBestBatchKernels()
+{
+    static const BatchKernelTable& best = SelectBestBatchKernels();
+    return best;
+}
@@ -0,0 +1,70 @@
+// BatchKernels.h - 整数数组四则运算内核（SIMD）
+// =====================================================
+// IBatchCalculator 的底层实现：一次处理整个数组
+//   - Scalar ：纯 C++ 循环，任何平台都可用，也是其他内核的对照标准
+//   - SSE2   ：每次 4 个 int
+//   - AVX2   ：每次 8 个 int
+//   - AVX512 ：每次 16 个 int
+// 运行时通过 CPUID 选择当前 CPU 支持的最快版本
+//
+// 运算语义与 Calculator 的单次调用一致：
+//   - 加减乘按 32 位补码回绕
+//   - 除法向零截断；调用 div 前必须先用 hasZero 排除除数为 0 的情况
+//
+// 不变除数：同一个除数要除很多数时，先用 PrepareBatchDivisor 算出乘数和移位量，
+// divBy 用乘法取高 32 位 + 移位代替除法（Granlund & Montgomery，《Hacker's Delight》10-4 节），
+// 结果与 div 逐位一致
+#pragma once
+#include <cstddef>
+
+enum class BatchIsa
+{
+    Scalar,
+    SSE2,
+    AVX2,
+    AVX512,
+};
+
+// 预先处理好的除数：q = ((mulhi(a, magic) + ±a) >> shift) + (q < 0)
+// 每个字段都是 0/-1 掩码或常量，SIMD 内核里不需要分支
+struct BatchDivisor
+{
+    int divisor;
+    int magic;      // 乘数（有符号）
+    int shift;      // 算术右移位数
+    int addMask;    // -1：乘积高位还要加上（或减去）被除数
+    int addSign;    // -1：减去被除数
+    int roundMask;  // -1：负商加 1（向零截断）；除数为 ±1 时为 0
+};
+
+// 计算 divisor 的乘数和移位量；divisor 为 0 时返回 false
+bool PrepareBatchDivisor(int divisor, BatchDivisor* prepared);
+
+// 单个数除以预先处理好的除数（Scalar 内核和表达式解释器共用）
+inline int BatchDivide(int a, const BatchDivisor& d)
+{
+    unsigned hi = (unsigned)(((long long)a * d.magic) >> 32);
+    unsigned t = (((unsigned)a ^ (unsigned)d.addSign) - (unsigned)d.addSign) & (unsigned)d.addMask;
+    int q = (int)(hi + t) >> d.shift;
+    return (int)((unsigned)q + (((unsigned)q >> 31) & (unsigned)d.roundMask));
+}
+
+// 一组内核函数（同一指令集）
+struct BatchKernelTable
+{
+    BatchIsa    isa;
+    const char* name;
+
+    void (*add)(const int* a, const int* b, int* out, size_t n);
+    void (*sub)(const int* a, const int* b, int* out, size_t n);
+    void (*mul)(const int* a, const int* b, int* out, size_t n);
+    void (*div)(const int* a, const int* b, int* out, size_t n);  // 要求 b 中没有 0
+    bool (*hasZero)(const int* b, size_t n);                       // b 中是否有 0
+    void (*divBy)(const int* a, const BatchDivisor& d, int* out, size_t n);  // out[i] = a[i] / d.divisor
+};
+
+// 返回指定指令集的内核；当前 CPU（或编译目标）不支持时返回 nullptr
+const BatchKernelTable* GetBatchKernels(BatchIsa isa);
+
+// 返回当前 CPU 上最快的内核（第一次调用时检测，之后直接返回缓存结果）
+const BatchKernelTable& GetBestBatchKernels();
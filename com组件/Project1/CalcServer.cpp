@@ -0,0 +1,39 @@
+// CalcServer.cpp - Calculator 的进程外服务器（宿主进程）
+// =====================================================
+// 独立的程序（有自己的 main，已在项目中排除编译；只在 Linux 上可用）
+// 运行后其他进程可以用 CreateLocalInstance(CLSID_Calculator, ...) 连接，Ctrl+C 退出
+//
+// Linux 编译：在仓库根目录 make（生成 build/CalcServer）
+#include "StandardCOM.h"
+#include "LocalServer.h"
+#include <csignal>
+#include <cstdio>
+
+static LocalServer* s_server = nullptr;
+
+static void OnSignal(int)
+{
+    if (s_server) s_server->Stop();  // 只有原子操作和一次系统调用，可以在信号处理函数中调用
+}
+
+int main()
+{
+    LocalServer server;
+    HRESULT hr = server.Start(CLSID_Calculator);
+    if (FAILED(hr))
+    {
+        fprintf(stderr, "启动服务器失败: 0x%08X\n", (unsigned)hr);
+        return 1;
+    }
+
+    s_server = &server;
+    signal(SIGINT, OnSignal);
+    signal(SIGTERM, OnSignal);
+
+    printf("Calculator 服务器已启动，Ctrl+C 退出\n");
+    fflush(stdout);
+    server.Run();
+
+    printf("服务器退出，共处理 %llu 次调用\n", (unsigned long long)server.Served());
+    return 0;
+}
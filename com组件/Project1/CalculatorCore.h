@@ -0,0 +1,66 @@
+// CalculatorCore.h - 四则运算的静态分派核心（CRTP）
+// =====================================================
+// ICalculator 的每次调用都要经过虚函数表，__stdcall 虚函数边界也挡住了内联。
+// 运算本身放在这个只有头文件的模板里，COM 对象和进程内的直接调用者共用同一份代码：
+//
+//   DirectCalculator calc;                 // 没有虚函数表、没有引用计数
+//   int r;
+//   calc.Add(100, 50, &r);                 // 编译器可以完全内联
+//
+//   HRESULT __stdcall Calculator::Add(int a, int b, int* result)   // COM 包装：转给同一个核心
+//   {
+//       return Core::Add(a, b, result);
+//   }
+//   pCalculator->Direct().Add(100, 50, &r);   // 已经持有 Calculator* 的进程内代码：不经过虚函数表
+//
+// 派生类通过 CRTP 提供钩子 OnResult（例如 Calculator 写日志）；默认钩子是空函数，内联后完全消失。
+// 运算语义与 BatchKernels 一致：加减乘按 32 位补码回绕，除法向零截断，INT_MIN / -1 = INT_MIN，
+// 除数为 0 返回 E_INVALIDARG
+#pragma once
+#include "ComPlatform.h"
+
+template <class Derived>
+class CalculatorCore
+{
+public:
+    HRESULT Add(int a, int b, int* result) const
+    {
+        if (!result) return E_POINTER;
+        *result = (int)((unsigned)a + (unsigned)b);
+        Derived::OnResult('+', a, b, *result);
+        return S_OK;
+    }
+
+    HRESULT Subtract(int a, int b, int* result) const
+    {
+        if (!result) return E_POINTER;
+        *result = (int)((unsigned)a - (unsigned)b);
+        Derived::OnResult('-', a, b, *result);
+        return S_OK;
+    }
+
+    HRESULT Multiply(int a, int b, int* result) const
+    {
+        if (!result) return E_POINTER;
+        *result = (int)((unsigned)a * (unsigned)b);
+        Derived::OnResult('*', a, b, *result);
+        return S_OK;
+    }
+
+    HRESULT Divide(int a, int b, int* result) const
+    {
+        if (!result) return E_POINTER;
+        if (b == 0) return E_INVALIDARG;  // 除数为 0
+        *result = (b == -1) ? (int)(0u - (unsigned)a) : a / b;  // INT_MIN / -1 会溢出，按回绕处理
+        Derived::OnResult('/', a, b, *result);
+        return S_OK;
+    }
+
+    // 默认钩子：什么也不做。op 是运算符 '+' '-' '*' '/'
+    static void OnResult(char /*op*/, int /*a*/, int /*b*/, int /*result*/) {}
+};
+
+// 进程内直接调用用的计算器：只有核心，没有 COM 外壳
+class DirectCalculator : public CalculatorCore<DirectCalculator>
+{
+};
@@ -0,0 +1,109 @@
+// ClassRegistry.cpp - 类对象注册表实现
+#include "ClassRegistry.h"
+#include <cstdint>
+#include <cstring>
+
+namespace ClassRegistry
+{
+    namespace
+    {
+        const size_t kSlotCount = kMaxClasses * 2;  // 负载因子不超过 1/2，探测很短
+        static_assert((kSlotCount & (kSlotCount - 1)) == 0, "slot count must be a power of two");
+
+        enum SlotState : uint8_t
+        {
+            Empty,
+            Used,
+            Deleted,  // 注销后的墓碑，查找时跳过但不停止
+        };
+
+        struct Slot
+        {
+            CLSID          clsid;
+            IClassFactory* factory;
+            SlotState      state;
+        };
+
+        // 零初始化的静态数组，在任何动态初始化（模块加载时的注册）之前就已可用
+        Slot   s_slots[kSlotCount];
+        size_t s_count;
+
+        Slot* FindSlot(REFCLSID rclsid)
+        {
+            size_t index = Hash(rclsid) & (kSlotCount - 1);
+            for (size_t probe = 0; probe < kSlotCount; ++probe)
+            {
+                Slot& slot = s_slots[(index + probe) & (kSlotCount - 1)];
+                if (slot.state == Empty) return nullptr;
+                if (slot.state == Used && slot.clsid == rclsid) return &slot;
+            }
+            return nullptr;
+        }
+    }
+
+    size_t Hash(REFGUID guid)
+    {
+        uint64_t lo, hi;
+        std::memcpy(&lo, &guid, 8);
+        std::memcpy(&hi, reinterpret_cast<const char*>(&guid) + 8, 8);
+        uint64_t h = (lo ^ (hi * 0x9E3779B97F4A7C15ull)) * 0xBF58476D1CE4E5B9ull;
+        return (size_t)(h ^ (h >> 31));
+    }
+
+    HRESULT Register(REFCLSID rclsid, IClassFactory* pFactory)
+    {
+        if (!pFactory) return E_POINTER;
+        if (FindSlot(rclsid)) return E_INVALIDARG;
+        if (s_count >= kMaxClasses) return E_OUTOFMEMORY;
+
+        size_t index = Hash(rclsid) & (kSlotCount - 1);
+        while (s_slots[index].state == Used)
+            index = (index + 1) & (kSlotCount - 1);
+
+        Slot& slot = s_slots[index];
+        slot.clsid = rclsid;
+        slot.factory = pFactory;
+        slot.state = Used;
+        ++s_count;
+
+        pFactory->AddRef();  // 注册表持有一个引用
+        return S_OK;
+    }
+
+    HRESULT Revoke(REFCLSID rclsid)
+    {
+        Slot* slot = FindSlot(rclsid);
+        if (!slot) return CLASS_E_CLASSNOTAVAILABLE;
+
+        IClassFactory* factory = slot->factory;
+        slot->factory = nullptr;
+        slot->state = Deleted;
+        --s_count;
+
+        factory->Release();
+        return S_OK;
+    }
+
+    IClassFactory* Find(REFCLSID rclsid)
+    {
+        Slot* slot = FindSlot(rclsid);
+        return slot ? slot->factory : nullptr;
+    }
+}
+
+
+ClassObjectRegistration::ClassObjectRegistration(REFCLSID rclsid, IClassFactory* pFactory)
+    : m_clsid(rclsid)
+    , m_hr(E_OUTOFMEMORY)
+{
+    if (pFactory)
+    {
+        m_hr = ClassRegistry::Register(rclsid, pFactory);
+        pFactory->Release();  // 注册成功后只剩注册表的引用；失败则工厂被销毁
+    }
+}
+
+ClassObjectRegistration::~ClassObjectRegistration()
+{
+    if (SUCCEEDED(m_hr)) ClassRegistry::Revoke(m_clsid);
+}
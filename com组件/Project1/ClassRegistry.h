@@ -0,0 +1,47 @@
+// ClassRegistry.h - 类对象注册表
+// =====================================================
+// 模拟 COM 运行时的类对象表（CoRegisterClassObject）：
+//   - 每个 CLSID 对应一个长期存在的类工厂，在模块加载时创建并注册
+//   - DllGetClassObject 只查表并 QueryInterface（AddRef），不再每次 new 一个工厂
+//   - 查表是开放寻址哈希表，常数时间，不分配内存
+//
+// 注册只在模块加载阶段（静态初始化，单线程）进行；之后的查找不加锁
+#pragma once
+#include "ComPlatform.h"
+#include <cstddef>
+
+namespace ClassRegistry
+{
+    const size_t kMaxClasses = 64;  // 最多注册的类数（哈希表槽数是它的两倍）
+
+    // 注册类工厂，注册表持有它的一个引用
+    // 返回 E_INVALIDARG（重复的 CLSID）或 E_OUTOFMEMORY（表已满）
+    HRESULT Register(REFCLSID rclsid, IClassFactory* pFactory);
+
+    // 注销并释放注册表持有的引用
+    HRESULT Revoke(REFCLSID rclsid);
+
+    // 查找类工厂，返回的指针没有 AddRef；找不到返回 nullptr
+    IClassFactory* Find(REFCLSID rclsid);
+
+    // GUID 的哈希值
+    size_t Hash(REFGUID guid);
+}
+
+// 在模块加载时注册、模块卸载时注销（放在全局/静态变量里使用）
+// 构造时接管 pFactory 的初始引用
+class ClassObjectRegistration
+{
+private:
+    CLSID   m_clsid;
+    HRESULT m_hr;
+
+public:
+    ClassObjectRegistration(REFCLSID rclsid, IClassFactory* pFactory);
+    ~ClassObjectRegistration();
+
+    ClassObjectRegistration(const ClassObjectRegistration&) = delete;
+    ClassObjectRegistration& operator=(const ClassObjectRegistration&) = delete;
+
+    HRESULT Result() const { return m_hr; }
+};
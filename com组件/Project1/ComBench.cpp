@@ -0,0 +1,376 @@
+// ComBench.cpp - COM 基本操作和 Pimpl 的微基准测试
+// =====================================================
+// 独立的测试程序（有自己的 main，已在项目中排除编译）
+// 逐项测量：
+//   - DllGetClassObject、CreateInstance、QueryInterface、AddRef/Release
+//   - ICalculator 的四个方法和直接调用 CalculatorCore；批量除法（逐个除数 / 不变除数）
+//   - 同一个公式：逐个调用 ICalculator 的方法 / IExpression / IExpressionCalculator（查缓存）/ 列式求值
+//   - faceClass（0127-私有实现）的构造、拷贝、getID
+//
+// 每项输出 ns/op、allocs/op（全局 operator new 次数）和百分位数
+// 单次操作只有几纳秒，计时器本身的开销更大，所以每个样本是连续 kBatch 次操作的平均值，
+// 百分位数是在这些样本上统计的
+//
+// 结果同时写成 JSON（默认 ComBench.json，可用第一个命令行参数指定），便于跟踪性能回退
+// Linux 编译：在仓库根目录 make bench
+#include "StandardCOM.h"
+#include "BatchKernels.h"
+#include "faceClass.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <new>
+#include <vector>
+
+using namespace std;
+
+// =====================================================
+// 分配计数：替换全局 operator new（单线程测试，不需要原子）
+// =====================================================
+static uint64_t g_allocations = 0;
+
+void* operator new(size_t size)
+{
+    ++g_allocations;
+    if (void* p = malloc(size ? size : 1)) return p;
+    throw bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+// 阻止编译器把结果没被使用的操作优化掉
+template <class T>
+static inline void KeepAlive(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+// =====================================================
+// 测量
+// =====================================================
+static const int kBatch = 256;     // 每个样本连续执行的次数
+static const int kSamples = 4000;  // 样本数
+
+struct BenchResult
+{
+    const char* name;
+    uint64_t    ops;
+    double      nsPerOp;
+    double      allocsPerOp;
+    double      p50, p90, p99, p999, max;
+};
+
+template <class Op>
+static BenchResult Measure(const char* name, Op op)
+{
+    using clock = chrono::steady_clock;
+
+    for (int i = 0; i < kBatch * 16; ++i) op(i);  // 预热（对象池、缓存、分支预测）
+
+    vector<double> samples(kSamples);
+    uint64_t allocBefore = g_allocations;
+    clock::time_point begin = clock::now();
+    for (int s = 0; s < kSamples; ++s)
+    {
+        clock::time_point t0 = clock::now();
+        for (int i = 0; i < kBatch; ++i) op(i);
+        clock::time_point t1 = clock::now();
+        samples[s] = chrono::duration<double, nano>(t1 - t0).count() / kBatch;
+    }
+    clock::time_point end = clock::now();
+    uint64_t allocs = g_allocations - allocBefore;
+
+    sort(samples.begin(), samples.end());
+    auto percentile = [&](double p) { return samples[(size_t)(p * (kSamples - 1))]; };
+
+    BenchResult r;
+    r.name = name;
+    r.ops = (uint64_t)kSamples * kBatch;
+    r.nsPerOp = chrono::duration<double, nano>(end - begin).count() / r.ops;  // 含计时开销分摊
+    r.allocsPerOp = (double)allocs / r.ops;
+    r.p50 = percentile(0.50);
+    r.p90 = percentile(0.90);
+    r.p99 = percentile(0.99);
+    r.p999 = percentile(0.999);
+    r.max = samples.back();
+    return r;
+}
+
+static void PrintResult(const BenchResult& r)
+{
+    printf("%-32s %9.2f %9.3f %9.2f %9.2f %9.2f %9.2f %9.2f\n",
+        r.name, r.nsPerOp, r.allocsPerOp, r.p50, r.p90, r.p99, r.p999, r.max);
+}
+
+static bool WriteJson(const char* path, const vector<BenchResult>& results)
+{
+    FILE* f = fopen(path, "w");
+    if (!f) return false;
+
+    char timestamp[32];
+    time_t now = time(nullptr);
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+#if defined(__VERSION__)
+    const char* compiler = __VERSION__;
+#elif defined(_MSC_VER)
+    const char* compiler = "MSVC";
+#else
+    const char* compiler = "unknown";
+#endif
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"suite\": \"ComBench\",\n");
+    fprintf(f, "  \"timestamp\": \"%s\",\n", timestamp);
+    fprintf(f, "  \"compiler\": \"%s\",\n", compiler);
+    fprintf(f, "  \"batch_isa\": \"%s\",\n", GetBestBatchKernels().name);
+    fprintf(f, "  \"faceclass_pimpl_mode\": %d,\n", FACECLASS_PIMPL_MODE);
+    fprintf(f, "  \"samples\": %d,\n", kSamples);
+    fprintf(f, "  \"ops_per_sample\": %d,\n", kBatch);
+    fprintf(f, "  \"results\": [\n");
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const BenchResult& r = results[i];
+        fprintf(f, "    {\"name\": \"%s\", \"ops\": %llu, \"ns_per_op\": %.3f, \"allocs_per_op\": %.4f, "
+            "\"p50_ns\": %.3f, \"p90_ns\": %.3f, \"p99_ns\": %.3f, \"p999_ns\": %.3f, \"max_ns\": %.3f}%s\n",
+            r.name, (unsigned long long)r.ops, r.nsPerOp, r.allocsPerOp,
+            r.p50, r.p90, r.p99, r.p999, r.max, i + 1 < results.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n");
+    fprintf(f, "}\n");
+    return fclose(f) == 0;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* jsonPath = argc > 1 ? argv[1] : "ComBench.json";
+
+    IClassFactory* pFactory = nullptr;
+    ICalculator* pCalc = nullptr;
+    if (FAILED(DllGetClassObject(CLSID_Calculator, IID_IClassFactory, (void**)&pFactory)) ||
+        FAILED(pFactory->CreateInstance(nullptr, IID_ICalculator, (void**)&pCalc)))
+    {
+        fprintf(stderr, "创建 Calculator 失败\n");
+        return 1;
+    }
+
+    vector<BenchResult> results;
+
+    // ---------- COM 基本操作 ----------
+    results.push_back(Measure("DllGetClassObject+Release", [&](int)
+    {
+        IClassFactory* p = nullptr;
+        DllGetClassObject(CLSID_Calculator, IID_IClassFactory, (void**)&p);
+        KeepAlive(p);
+        p->Release();
+    }));
+
+    results.push_back(Measure("CreateInstance+Release", [&](int)
+    {
+        ICalculator* p = nullptr;
+        pFactory->CreateInstance(nullptr, IID_ICalculator, (void**)&p);
+        KeepAlive(p);
+        p->Release();
+    }));
+
+    results.push_back(Measure("QueryInterface+Release", [&](int)
+    {
+        IBatchCalculator* p = nullptr;
+        pCalc->QueryInterface(IID_IBatchCalculator, (void**)&p);
+        KeepAlive(p);
+        p->Release();
+    }));
+
+    results.push_back(Measure("AddRef+Release", [&](int)
+    {
+        pCalc->AddRef();
+        pCalc->Release();
+    }));
+
+    // ---------- ICalculator 方法 ----------
+    results.push_back(Measure("ICalculator::Add", [&](int i)
+    {
+        int r;
+        pCalc->Add(i, 7, &r);
+        KeepAlive(r);
+    }));
+
+    results.push_back(Measure("ICalculator::Subtract", [&](int i)
+    {
+        int r;
+        pCalc->Subtract(i, 7, &r);
+        KeepAlive(r);
+    }));
+
+    results.push_back(Measure("ICalculator::Multiply", [&](int i)
+    {
+        int r;
+        pCalc->Multiply(i, 7, &r);
+        KeepAlive(r);
+    }));
+
+    results.push_back(Measure("ICalculator::Divide", [&](int i)
+    {
+        int r;
+        pCalc->Divide(i, 7, &r);
+        KeepAlive(r);
+    }));
+
+    // ---------- 直接调用（CalculatorCore，不经过虚函数表，可以内联）----------
+    DirectCalculator direct;
+
+    results.push_back(Measure("CalculatorCore::Add (direct)", [&](int i)
+    {
+        int r;
+        direct.Add(i, 7, &r);
+        KeepAlive(r);
+    }));
+
+    results.push_back(Measure("CalculatorCore::Divide (direct)", [&](int i)
+    {
+        int r;
+        direct.Divide(i, 7, &r);
+        KeepAlive(r);
+    }));
+
+    // ---------- 批量除法：逐个除数 vs 不变除数（一次调用 1024 个数）----------
+    {
+        IBatchCalculator2* pBatch = nullptr;
+        pCalc->QueryInterface(IID_IBatchCalculator2, (void**)&pBatch);
+        static int xs[1024], ds[1024], out[1024];
+        for (int i = 0; i < 1024; ++i)
+        {
+            xs[i] = i * 7919 - 4000000;
+            ds[i] = 7;
+        }
+        BatchDivisor by7;
+        pBatch->PrepareDivisor(7, &by7);
+
+        results.push_back(Measure("DivideN, 1024 ints/op", [&](int)
+        {
+            pBatch->DivideN(xs, ds, out, 1024);
+            KeepAlive(out[0]);
+        }));
+
+        results.push_back(Measure("DivideByN, 1024 ints/op", [&](int)
+        {
+            pBatch->DivideByN(xs, &by7, out, 1024);
+            KeepAlive(out[0]);
+        }));
+        pBatch->Release();
+    }
+
+    // ---------- 同一个公式：逐个调用 ICalculator vs 编译好的表达式 ----------
+    // (x + 3) * y - x / 7
+    results.push_back(Measure("formula via ICalculator", [&](int i)
+    {
+        int t, u, v, r;
+        pCalc->Add(i, 3, &t);
+        pCalc->Multiply(t, 5, &u);
+        pCalc->Divide(i, 7, &v);
+        pCalc->Subtract(u, v, &r);
+        KeepAlive(r);
+    }));
+
+    results.push_back(Measure("formula via CalculatorCore", [&](int i)
+    {
+        int t, u, v, r;
+        direct.Add(i, 3, &t);
+        direct.Multiply(t, 5, &u);
+        direct.Divide(i, 7, &v);
+        direct.Subtract(u, v, &r);
+        KeepAlive(r);
+    }));
+
+    IExpressionCalculator* pExpr = nullptr;
+    IExpression* pFormula = nullptr;
+    pCalc->QueryInterface(IID_IExpressionCalculator, (void**)&pExpr);
+    pExpr->Compile("(x + 3) * y - x / 7", &pFormula);
+
+    results.push_back(Measure("IExpression::Evaluate", [&](int i)
+    {
+        int vars[] = { i, 5 };
+        int r;
+        pFormula->Evaluate(vars, 2, &r);
+        KeepAlive(r);
+    }));
+
+    results.push_back(Measure("IExpressionCalculator::Evaluate", [&](int i)
+    {
+        int vars[] = { i, 5 };
+        int r;
+        pExpr->Evaluate("(x + 3) * y - x / 7", vars, 2, &r);  // 每次查缓存
+        KeepAlive(r);
+    }));
+
+    // 列式求值：一次调用算 1024 行（ns/op 是整个调用的时间）
+    {
+        static int xs[1024], ys[1024], out[1024];
+        for (int i = 0; i < 1024; ++i)
+        {
+            xs[i] = i;
+            ys[i] = 5;
+        }
+        const int* columns[] = { xs, ys };
+        results.push_back(Measure("EvaluateColumns, 1024 rows/op", [&](int)
+        {
+            pFormula->EvaluateColumns(columns, 2, 1024, out, nullptr, nullptr);
+            KeepAlive(out[0]);
+        }));
+    }
+
+    pFormula->Release();
+    pExpr->Release();
+
+    // ---------- faceClass ----------
+    faceClass source;
+    source.setID(123);
+
+    results.push_back(Measure("faceClass construct+destroy", [&](int)
+    {
+        faceClass f;
+        KeepAlive(f);
+    }));
+
+    results.push_back(Measure("faceClass copy+destroy", [&](int)
+    {
+        faceClass f(source);
+        KeepAlive(f);
+    }));
+
+    results.push_back(Measure("faceClass::getID", [&](int)
+    {
+        int id = source.getID();
+        KeepAlive(id);
+    }));
+
+    pCalc->Release();
+    pFactory->Release();
+
+    printf("%-32s %9s %9s %9s %9s %9s %9s %9s\n",
+        "benchmark", "ns/op", "allocs/op", "p50", "p90", "p99", "p99.9", "max");
+    for (const BenchResult& r : results) PrintResult(r);
+
+    if (!WriteJson(jsonPath, results))
+    {
+        fprintf(stderr, "无法写入 %s\n", jsonPath);
+        return 1;
+    }
+    printf("\n结果已写入 %s\n", jsonPath);
+    return 0;
+}
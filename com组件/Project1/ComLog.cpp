@@ -0,0 +1,346 @@
+// ComLog.cpp - 异步日志实现
+// =====================================================
+// 结构：
+//   每个线程一个 ThreadRing（单生产者单消费者环形缓冲区）
+//     生产者：写日志的线程，只移动 tail
+//     消费者：后台输出线程，只移动 head
+//   后台线程轮流清空所有 ThreadRing，格式化后一次性写入 std::cout
+//
+// 唤醒：
+//   只有当缓冲区从"空"变成"非空"时，生产者才通知后台线程（m_wake + atomic::notify）
+//   繁忙时后台线程一直在处理，生产者几乎不会触发系统调用
+//   tail/head 的发布和读取使用 seq_cst，保证"生产者认为不用通知"时后台线程一定还会再检查一遍
+#include "ComLog.h"
+#include "ComModule.h"
+#include <atomic>
+#include <charconv>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ComLog
+{
+    struct Record
+    {
+        const char* fmt;
+        Level       level;
+        uint8_t     argCount;
+        Arg         args[kMaxArgs];
+    };
+
+    struct ThreadRing
+    {
+        static const uint32_t kCapacity = 1024;  // 必须是 2 的幂
+        static const uint32_t kMask = kCapacity - 1;
+
+        alignas(64) std::atomic<uint32_t> tail{ 0 };  // 生产者写
+        alignas(64) std::atomic<uint32_t> head{ 0 };  // 消费者写
+        std::atomic<bool> closed{ false };            // 线程已退出，清空后由后台线程释放
+        Record records[kCapacity];
+    };
+
+    // 线程退出时标记自己的缓冲区，剩余日志仍会被输出
+    // 之后本线程再写的日志（例如其他 thread_local 对象的析构）改为同步输出
+    static thread_local bool t_exited = false;
+
+    struct RingHolder
+    {
+        ThreadRing* ring = nullptr;
+
+        ~RingHolder()
+        {
+            if (ring) ring->closed.store(true, std::memory_order_release);
+            ring = nullptr;
+            t_exited = true;
+        }
+    };
+
+    static thread_local RingHolder t_ring;
+
+
+    static void AppendArg(std::string& out, const Arg& arg)
+    {
+        char buf[32];
+        std::to_chars_result r{ buf, std::errc() };
+        switch (arg.type)
+        {
+        case Arg::Int:
+            r = std::to_chars(buf, buf + sizeof(buf), arg.i);
+            break;
+        case Arg::UInt:
+            r = std::to_chars(buf, buf + sizeof(buf), arg.u);
+            break;
+        case Arg::Ptr:
+            out += "0x";
+            r = std::to_chars(buf, buf + sizeof(buf), (uintptr_t)arg.p, 16);
+            break;
+        case Arg::Str:
+            out += arg.s ? arg.s : "(null)";
+            return;
+        default:
+            return;
+        }
+        out.append(buf, r.ptr);
+    }
+
+    // 把 {} 依次替换为参数，结果追加到 out（带换行）
+    static void Format(std::string& out, const char* fmt, const Arg* args, int argCount)
+    {
+        int next = 0;
+        for (const char* p = fmt; *p; ++p)
+        {
+            if (p[0] == '{' && p[1] == '}' && next < argCount)
+            {
+                AppendArg(out, args[next++]);
+                ++p;
+            }
+            else
+            {
+                out += *p;
+            }
+        }
+        out += '\n';
+    }
+
+
+    class Logger
+    {
+    private:
+        std::mutex               m_ringsLock;   // 只在线程注册和后台线程取快照时使用
+        std::vector<ThreadRing*> m_rings;
+        std::mutex               m_outputLock;  // 保证整行输出不被打断
+
+        std::atomic<uint32_t> m_wake{ 0 };           // 唤醒后台线程
+        std::atomic<uint32_t> m_drained{ 0 };        // 后台线程最近完成的一轮开始时看到的 m_wake（Flush 用）
+        std::atomic<uint64_t> m_dropped{ 0 };
+        std::atomic<bool>     m_sync{ false };
+        std::atomic<bool>     m_stopRequest{ false };
+        std::atomic<bool>     m_stopped{ false };
+        std::thread           m_thread;
+
+        // 以下只由后台线程使用
+        std::vector<ThreadRing*> m_snapshot;
+        std::vector<uint32_t>    m_tails;
+        std::string              m_buffer;
+
+    public:
+        // 故意不销毁：静态对象析构期间仍可能有日志，进程退出时由 atexit 停止后台线程
+        static Logger& Instance()
+        {
+            static Logger* instance = Create();
+            return *instance;
+        }
+
+        void Write(Level level, const char* fmt, const Arg* args, int argCount)
+        {
+            if (m_sync.load(std::memory_order_relaxed) || m_stopped.load(std::memory_order_acquire) || t_exited)
+            {
+                WriteNow(fmt, args, argCount);
+                return;
+            }
+
+            ThreadRing* ring = t_ring.ring;
+            if (!ring) ring = Register();
+
+            uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+            uint32_t head = ring->head.load(std::memory_order_acquire);
+            if (tail - head >= ThreadRing::kCapacity)
+            {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);  // 满了就丢弃，不阻塞
+                return;
+            }
+
+            Record& rec = ring->records[tail & ThreadRing::kMask];
+            rec.fmt = fmt;
+            rec.level = level;
+            rec.argCount = (uint8_t)argCount;
+            for (int i = 0; i < argCount; ++i) rec.args[i] = args[i];
+
+            ring->tail.store(tail + 1, std::memory_order_seq_cst);
+            if (ring->head.load(std::memory_order_seq_cst) == tail)  // 之前是空的，后台线程可能在睡眠
+            {
+                m_wake.fetch_add(1, std::memory_order_seq_cst);
+                m_wake.notify_one();
+            }
+        }
+
+        void SetSynchronous(bool sync)
+        {
+            if (sync) Flush();
+            m_sync.store(sync, std::memory_order_relaxed);
+        }
+
+        void Flush()
+        {
+            if (!m_stopped.load(std::memory_order_acquire))
+            {
+                // 等后台线程完整地跑完一轮在本次调用之后开始的处理
+                uint32_t target = m_wake.fetch_add(1, std::memory_order_seq_cst) + 1;
+                m_wake.notify_one();
+                for (uint32_t drained; (int32_t)((drained = m_drained.load(std::memory_order_acquire)) - target) < 0;)
+                {
+                    if (m_stopped.load(std::memory_order_acquire)) break;
+                    m_drained.wait(drained, std::memory_order_acquire);
+                }
+            }
+            std::lock_guard<std::mutex> lock(m_outputLock);
+            std::cout.flush();
+        }
+
+        uint64_t Dropped() const
+        {
+            return m_dropped.load(std::memory_order_relaxed);
+        }
+
+    private:
+        Logger()
+        {
+            ComModule::Pin();  // 后台线程运行的是本模块的代码
+            m_thread = std::thread([this] { Run(); });
+        }
+
+        static Logger* Create()
+        {
+            Logger* logger = new Logger();
+            std::atexit([] { Instance().Shutdown(); });
+            return logger;
+        }
+
+        void Shutdown()
+        {
+            m_stopRequest.store(true, std::memory_order_release);
+            m_wake.fetch_add(1, std::memory_order_seq_cst);
+            m_wake.notify_one();
+            if (m_thread.joinable()) m_thread.join();
+            // 之后的日志（例如静态对象析构）同步输出
+            m_stopped.store(true, std::memory_order_release);
+            m_drained.notify_all();
+        }
+
+        ThreadRing* Register()
+        {
+            ThreadRing* ring = new ThreadRing();
+            {
+                std::lock_guard<std::mutex> lock(m_ringsLock);
+                m_rings.push_back(ring);
+            }
+            t_ring.ring = ring;
+            return ring;
+        }
+
+        void WriteNow(const char* fmt, const Arg* args, int argCount)
+        {
+            std::string line;
+            Format(line, fmt, args, argCount);
+            std::lock_guard<std::mutex> lock(m_outputLock);
+            std::cout.write(line.data(), (std::streamsize)line.size());
+        }
+
+        // 清空所有缓冲区一次，返回处理的条数
+        size_t DrainOnce()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_ringsLock);
+                m_snapshot = m_rings;
+            }
+
+            size_t count = 0;
+            bool anyClosed = false;
+            m_tails.resize(m_snapshot.size());
+            m_buffer.clear();
+            for (size_t r = 0; r < m_snapshot.size(); ++r)
+            {
+                ThreadRing* ring = m_snapshot[r];
+                anyClosed = anyClosed || ring->closed.load(std::memory_order_acquire);
+
+                uint32_t head = ring->head.load(std::memory_order_relaxed);
+                uint32_t tail = ring->tail.load(std::memory_order_seq_cst);
+                for (uint32_t i = head; i != tail; ++i)
+                {
+                    const Record& rec = ring->records[i & ThreadRing::kMask];
+                    Format(m_buffer, rec.fmt, rec.args, rec.argCount);
+                }
+                m_tails[r] = tail;
+                count += tail - head;
+            }
+
+            if (!m_buffer.empty())
+            {
+                std::lock_guard<std::mutex> lock(m_outputLock);
+                std::cout.write(m_buffer.data(), (std::streamsize)m_buffer.size());
+                std::cout.flush();
+            }
+
+            // 输出完成后才推进 head：Flush 返回时日志一定已经写出
+            for (size_t r = 0; r < m_snapshot.size(); ++r)
+                m_snapshot[r]->head.store(m_tails[r], std::memory_order_seq_cst);
+
+            if (anyClosed) ReleaseClosed();
+            return count;
+        }
+
+        // 释放已经退出且已清空的线程缓冲区
+        void ReleaseClosed()
+        {
+            std::lock_guard<std::mutex> lock(m_ringsLock);
+            for (size_t i = 0; i < m_rings.size();)
+            {
+                ThreadRing* ring = m_rings[i];
+                if (ring->closed.load(std::memory_order_acquire) &&
+                    ring->head.load(std::memory_order_relaxed) == ring->tail.load(std::memory_order_acquire))
+                {
+                    m_rings[i] = m_rings.back();
+                    m_rings.pop_back();
+                    delete ring;
+                }
+                else
+                {
+                    ++i;
+                }
+            }
+        }
+
+        void Run()
+        {
+            for (;;)
+            {
+                uint32_t wake = m_wake.load(std::memory_order_seq_cst);
+                bool stop = m_stopRequest.load(std::memory_order_acquire);
+                size_t count = DrainOnce();
+
+                m_drained.store(wake, std::memory_order_release);
+                m_drained.notify_all();
+
+                if (count == 0)
+                {
+                    if (stop) break;
+                    m_wake.wait(wake, std::memory_order_seq_cst);
+                }
+            }
+        }
+    };
+
+
+    void WriteRecord(Level level, const char* fmt, const Arg* args, int argCount)
+    {
+        Logger::Instance().Write(level, fmt, args, argCount);
+    }
+
+    void SetSynchronous(bool sync)
+    {
+        Logger::Instance().SetSynchronous(sync);
+    }
+
+    void Flush()
+    {
+        Logger::Instance().Flush();
+    }
+
+    uint64_t DroppedCount()
+    {
+        return Logger::Instance().Dropped();
+    }
+}
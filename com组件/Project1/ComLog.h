@@ -0,0 +1,111 @@
+// ComLog.h - 编译期可关闭的异步日志
+// =====================================================
+// 用法：
+//   COM_LOG_TRACE("[Calculator] Add: {} + {} = {}", a, b, *result);
+//
+// 1. 编译期级别
+//    低于 COM_LOG_LEVEL 的日志语句在编译期被整个去掉（参数也不会求值）
+//    默认：定义了 NDEBUG（Release）时为 WARN，否则为 TRACE
+//    也可以在编译选项里指定，例如 /DCOM_LOG_LEVEL=COM_LOG_LEVEL_OFF
+//
+// 2. 异步输出
+//    调用线程只把 {格式串指针, 参数} 写进自己的无锁环形缓冲区（单生产者单消费者）
+//    后台线程负责格式化和输出，调用线程永远不会等待 std::cout 的锁
+//    缓冲区满时直接丢弃这条日志并计数，而不是阻塞
+//
+// 限制：
+//   - 格式串和字符串参数只保存指针，必须是字符串字面量或其他静态存储的字符串
+//   - 每条日志最多 kMaxArgs 个参数，占位符为 {}
+//   - 同一线程内的日志保持顺序，不同线程之间不保证顺序
+#pragma once
+#include <cstdint>
+#include <type_traits>
+
+#define COM_LOG_LEVEL_TRACE 0
+#define COM_LOG_LEVEL_DEBUG 1
+#define COM_LOG_LEVEL_INFO  2
+#define COM_LOG_LEVEL_WARN  3
+#define COM_LOG_LEVEL_ERROR 4
+#define COM_LOG_LEVEL_OFF   5
+
+#ifndef COM_LOG_LEVEL
+#ifdef NDEBUG
+#define COM_LOG_LEVEL COM_LOG_LEVEL_WARN
+#else
+#define COM_LOG_LEVEL COM_LOG_LEVEL_TRACE
+#endif
+#endif
+
+namespace ComLog
+{
+    enum Level : uint8_t
+    {
+        Trace = COM_LOG_LEVEL_TRACE,
+        Debug = COM_LOG_LEVEL_DEBUG,
+        Info  = COM_LOG_LEVEL_INFO,
+        Warn  = COM_LOG_LEVEL_WARN,
+        Error = COM_LOG_LEVEL_ERROR,
+    };
+
+    const int kMaxArgs = 4;
+
+    // 一个日志参数：整数、静态字符串或指针
+    struct Arg
+    {
+        enum Type : uint8_t { None, Int, UInt, Str, Ptr };
+
+        Type type;
+        union
+        {
+            long long          i;
+            unsigned long long u;
+            const char*        s;
+            const void*        p;
+        };
+
+        Arg() : type(None), u(0) {}
+
+        template <class T>
+            requires std::is_integral_v<T>
+        Arg(T v)
+        {
+            if constexpr (std::is_signed_v<T>) { type = Int; i = v; }
+            else                               { type = UInt; u = v; }
+        }
+
+        Arg(const char* v) : type(Str), s(v) {}
+        Arg(const void* v) : type(Ptr), p(v) {}
+    };
+
+    void WriteRecord(Level level, const char* fmt, const Arg* args, int argCount);
+
+    template <class... Args>
+    inline void Write(Level level, const char* fmt, const Args&... args)
+    {
+        static_assert(sizeof...(Args) <= kMaxArgs, "too many log arguments");
+        const Arg list[] = { Arg(args)..., Arg() };
+        WriteRecord(level, fmt, list, (int)sizeof...(Args));
+    }
+
+    // 同步模式：在调用线程上直接格式化输出
+    // 只给演示程序使用，让日志和程序自己的输出按顺序交错
+    void SetSynchronous(bool sync);
+
+    // 等待调用前写入的所有日志都已输出
+    void Flush();
+
+    // 因缓冲区满而丢弃的日志条数
+    uint64_t DroppedCount();
+}
+
+#define COM_LOG(level, ...)                                   \
+    do {                                                      \
+        if constexpr ((int)(level) >= COM_LOG_LEVEL)          \
+            ::ComLog::Write((level), __VA_ARGS__);            \
+    } while (0)
+
+#define COM_LOG_TRACE(...) COM_LOG(::ComLog::Trace, __VA_ARGS__)
+#define COM_LOG_DEBUG(...) COM_LOG(::ComLog::Debug, __VA_ARGS__)
+#define COM_LOG_INFO(...)  COM_LOG(::ComLog::Info, __VA_ARGS__)
+#define COM_LOG_WARN(...)  COM_LOG(::ComLog::Warn, __VA_ARGS__)
+#define COM_LOG_ERROR(...) COM_LOG(::ComLog::Error, __VA_ARGS__)
@@ -0,0 +1,58 @@
+// ComModule.cpp - 组件模块的生存期计数
+#include "ComModule.h"
+#include <atomic>
+
+namespace ComModule
+{
+    namespace
+    {
+        // 常量初始化：模块加载时任何动态初始化（例如注册类工厂）之前就已可用
+        // 计数可能短暂为负（并发的 AddRef/Release 交错），所以用有符号数
+        constinit std::atomic<long> s_objects{ 0 };
+        constinit std::atomic<long> s_locks{ 0 };
+        constinit std::atomic<bool> s_pinned{ false };
+    }
+
+    void AddObject()
+    {
+        s_objects.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // release：对象在析构中的所有访问，在加载器看到计数为 0 之前完成
+    void ReleaseObject()
+    {
+        s_objects.fetch_sub(1, std::memory_order_release);
+    }
+
+    void Lock()
+    {
+        s_locks.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void Unlock()
+    {
+        s_locks.fetch_sub(1, std::memory_order_release);
+    }
+
+    void Pin()
+    {
+        s_pinned.store(true, std::memory_order_release);
+    }
+
+    HRESULT CanUnloadNow()
+    {
+        if (s_pinned.load(std::memory_order_acquire)) return S_FALSE;
+        return s_objects.load(std::memory_order_acquire) == 0 &&
+               s_locks.load(std::memory_order_acquire) == 0 ? S_OK : S_FALSE;
+    }
+
+    long ObjectCount()
+    {
+        return s_objects.load(std::memory_order_relaxed);
+    }
+
+    long LockCount()
+    {
+        return s_locks.load(std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,29 @@
+// ComModule.h - 组件模块的生存期计数
+// =====================================================
+// 一个 COM 模块（DLL / .so）只有在没有人使用时才能被卸载，判断依据是两个原子计数：
+//   - 对象数：组件对象构造时 +1、析构时 -1
+//   - 锁计数：IClassFactory::LockServer(TRUE/FALSE)，以及客户端持有的类工厂引用
+// 两者都为 0 时 DllCanUnloadNow 返回 S_OK，加载器（ModuleLoader）才会卸载模块
+//
+// 另外，模块里一旦启动了后台线程（日志输出线程、异步调用的线程池），线程的代码就在模块里，
+// 模块从此不能再卸载：这些地方调用 Pin()
+#pragma once
+#include "ComPlatform.h"
+
+namespace ComModule
+{
+    void AddObject();
+    void ReleaseObject();
+
+    void Lock();
+    void Unlock();
+
+    // 模块不再允许卸载（不可撤销）
+    void Pin();
+
+    // S_OK：可以卸载；S_FALSE：仍在使用
+    HRESULT CanUnloadNow();
+
+    long ObjectCount();
+    long LockCount();
+}
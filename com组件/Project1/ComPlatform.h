@@ -0,0 +1,112 @@
+// ComPlatform.h - COM 基础类型的平台适配
+// =====================================================
+// Windows 上直接使用系统头文件（Windows.h / unknwn.h）
+// 其他平台（Linux）上提供一个最小的可移植替身：
+//   GUID / IID / CLSID、HRESULT、IUnknown、IClassFactory 以及常用错误码
+// 只为让组件代码能在 Linux 上编译和测量，不追求与 Windows SDK 完全一致
+#pragma once
+
+#ifdef _WIN32
+
+#include <Windows.h>
+#include <unknwn.h>  // IUnknown / IClassFactory
+
+// 模块导出函数：DLL 通过 .def 文件导出
+#define COM_EXPORT
+
+#else  // !_WIN32
+
+#include <cstdint>
+#include <cstring>
+
+// 调用约定和 __declspec 在非 Windows 平台上没有意义，定义为空
+#ifndef __stdcall
+#define __stdcall
+#endif
+#ifndef __declspec
+#define __declspec(x)
+#endif
+
+// 模块导出函数：编译成 .so 时用 -fvisibility=hidden，只有这些函数可见
+#define COM_EXPORT __attribute__((visibility("default")))
+
+typedef int32_t  HRESULT;
+typedef uint32_t ULONG;
+typedef uint64_t ULONGLONG;
+typedef int      BOOL;
+
+#ifndef TRUE
+#define TRUE  1
+#define FALSE 0
+#endif
+
+// 128 位全局唯一标识符，内存布局与 Windows 一致
+struct GUID
+{
+    uint32_t Data1;
+    uint16_t Data2;
+    uint16_t Data3;
+    uint8_t  Data4[8];
+};
+
+typedef GUID IID;
+typedef GUID CLSID;
+typedef const GUID& REFGUID;
+typedef const IID& REFIID;
+typedef const CLSID& REFCLSID;
+
+inline bool operator==(REFGUID a, REFGUID b)
+{
+    return std::memcmp(&a, &b, sizeof(GUID)) == 0;
+}
+
+inline bool operator!=(REFGUID a, REFGUID b)
+{
+    return !(a == b);
+}
+
+// HRESULT：最高位为 1 表示失败
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#define FAILED(hr)    (((HRESULT)(hr)) < 0)
+
+#define S_OK                      ((HRESULT)0x00000000L)
+#define S_FALSE                   ((HRESULT)0x00000001L)
+#define E_PENDING                 ((HRESULT)0x8000000AL)
+#define E_NOTIMPL                 ((HRESULT)0x80004001L)
+#define E_NOINTERFACE             ((HRESULT)0x80004002L)
+#define E_POINTER                 ((HRESULT)0x80004003L)
+#define E_FAIL                    ((HRESULT)0x80004005L)
+#define E_UNEXPECTED              ((HRESULT)0x8000FFFFL)
+#define E_OUTOFMEMORY             ((HRESULT)0x8007000EL)
+#define E_INVALIDARG              ((HRESULT)0x80070057L)
+#define CLASS_E_NOAGGREGATION     ((HRESULT)0x80040110L)
+#define CLASS_E_CLASSNOTAVAILABLE ((HRESULT)0x80040111L)
+#define RPC_E_DISCONNECTED        ((HRESULT)0x80010108L)
+#define REGDB_E_CLASSNOTREG       ((HRESULT)0x80040154L)
+#define CO_E_DLLNOTFOUND          ((HRESULT)0x800401F8L)
+#define CO_E_ERRORINDLL           ((HRESULT)0x800401F9L)
+
+// IUnknown {00000000-0000-0000-C000-000000000046}
+inline const IID IID_IUnknown =
+{ 0x00000000, 0x0000, 0x0000, { 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46 } };
+
+// IClassFactory {00000001-0000-0000-C000-000000000046}
+inline const IID IID_IClassFactory =
+{ 0x00000001, 0x0000, 0x0000, { 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46 } };
+
+class IUnknown
+{
+public:
+    virtual HRESULT __stdcall QueryInterface(REFIID riid, void** ppvObject) = 0;
+    virtual ULONG __stdcall AddRef() = 0;
+    virtual ULONG __stdcall Release() = 0;
+};
+
+class IClassFactory : public IUnknown
+{
+public:
+    virtual HRESULT __stdcall CreateInstance(IUnknown* pUnkOuter, REFIID riid, void** ppvObject) = 0;
+    virtual HRESULT __stdcall LockServer(BOOL fLock) = 0;
+};
+
+#endif  // _WIN32
@@ -0,0 +1,159 @@
+// ComPtr.h - COM 接口的智能指针
+// =====================================================
+// 持有一个引用，析构时 Release；用法与 WRL 的 Microsoft::WRL::ComPtr 相同：
+//
+//   ComPtr<IClassFactory> factory;
+//   DllGetClassObject(CLSID_Calculator, IID_IClassFactory, (void**)factory.ReleaseAndGetAddressOf());
+//   ComPtr<ICalculator> calc;
+//   factory->CreateInstance(nullptr, IID_ICalculator, (void**)calc.ReleaseAndGetAddressOf());
+//   ComPtr<IBatchCalculator> batch = calc.As<IBatchCalculator>();   // QueryInterface，失败时为空
+//
+// 每一次引用计数操作都是一次原子读-改-写，这里尽量不产生多余的操作：
+//   - 移动构造/移动赋值只转移指针，不 AddRef/Release
+//   - Attach 接管一个已有的引用（例如 new 出来的初始引用），Detach 交出引用，都不计数
+//   - 只有拷贝（真的多了一个持有者）才 AddRef
+// Debug 构建中可以用 RefCount::ThreadOps() 检查一段代码做了多少次原子增减
+#pragma once
+#include "ComPlatform.h"
+#include <cstddef>
+#include <utility>
+
+// 接口类型 → IID。接口用 COM_DECLARE_INTERFACE_ID(Itf) 登记一次（IID 变量必须叫 IID_<Itf>）
+template <class Itf>
+struct InterfaceId;
+
+#define COM_DECLARE_INTERFACE_ID(Itf) \
+    template <> struct InterfaceId<Itf> { static const IID& Get() { return IID_##Itf; } }
+
+COM_DECLARE_INTERFACE_ID(IUnknown);
+COM_DECLARE_INTERFACE_ID(IClassFactory);
+
+template <class T>
+class ComPtr
+{
+private:
+    T* m_p = nullptr;
+
+    template <class U> friend class ComPtr;
+
+public:
+    ComPtr() = default;
+    ComPtr(std::nullptr_t) {}
+
+    // 从裸指针构造：增加一个引用（调用者原有的引用不变）；接管引用请用 Attach
+    ComPtr(T* p) : m_p(p)
+    {
+        if (m_p) m_p->AddRef();
+    }
+
+    ComPtr(const ComPtr& other) : m_p(other.m_p)
+    {
+        if (m_p) m_p->AddRef();
+    }
+
+    ComPtr(ComPtr&& other) noexcept : m_p(other.m_p)
+    {
+        other.m_p = nullptr;
+    }
+
+    // 派生接口 → 基接口（例如 ComPtr<ICalculator> → ComPtr<IUnknown>）
+    template <class U>
+    ComPtr(const ComPtr<U>& other) : m_p(other.m_p)
+    {
+        if (m_p) m_p->AddRef();
+    }
+
+    template <class U>
+    ComPtr(ComPtr<U>&& other) noexcept : m_p(other.m_p)
+    {
+        other.m_p = nullptr;
+    }
+
+    ~ComPtr()
+    {
+        if (m_p) m_p->Release();
+    }
+
+    ComPtr& operator=(const ComPtr& other)
+    {
+        ComPtr(other).Swap(*this);
+        return *this;
+    }
+
+    ComPtr& operator=(ComPtr&& other) noexcept
+    {
+        ComPtr(std::move(other)).Swap(*this);
+        return *this;
+    }
+
+    ComPtr& operator=(std::nullptr_t)
+    {
+        Reset();
+        return *this;
+    }
+
+    void Swap(ComPtr& other) noexcept
+    {
+        T* p = m_p;
+        m_p = other.m_p;
+        other.m_p = p;
+    }
+
+    T* Get() const { return m_p; }
+    T* operator->() const { return m_p; }
+    explicit operator bool() const { return m_p != nullptr; }
+
+    // 作为输出参数：先释放当前持有的引用，再交出内部指针的地址
+    T** ReleaseAndGetAddressOf()
+    {
+        Reset();
+        return &m_p;
+    }
+
+    // 接管 p 的一个引用（不 AddRef）
+    void Attach(T* p)
+    {
+        if (m_p) m_p->Release();
+        m_p = p;
+    }
+
+    // 交出持有的引用（不 Release），之后由调用者负责
+    T* Detach()
+    {
+        T* p = m_p;
+        m_p = nullptr;
+        return p;
+    }
+
+    void Reset()
+    {
+        if (T* p = Detach()) p->Release();
+    }
+
+    // 再交出一个引用（AddRef），用于填写接口方法的输出参数
+    HRESULT CopyTo(T** pp) const
+    {
+        if (!pp) return E_POINTER;
+        if (m_p) m_p->AddRef();
+        *pp = m_p;
+        return S_OK;
+    }
+
+    // 类型化的 QueryInterface
+    template <class U>
+    HRESULT As(ComPtr<U>* out) const
+    {
+        if (!out) return E_POINTER;
+        if (!m_p) return E_POINTER;
+        return m_p->QueryInterface(InterfaceId<U>::Get(), (void**)out->ReleaseAndGetAddressOf());
+    }
+
+    // 同上，失败时返回空指针
+    template <class U>
+    ComPtr<U> As() const
+    {
+        ComPtr<U> out;
+        As(&out);
+        return out;
+    }
+};
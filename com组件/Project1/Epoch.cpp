@@ -0,0 +1,95 @@
+// Epoch.cpp - 基于纪元的回收实现
+#include "Epoch.h"
+#include <atomic>
+
+namespace Epoch
+{
+    // 每个线程一条记录，挂在全局链表上（只增不删，线程退出后由新线程复用）
+    struct alignas(64) ThreadRecord
+    {
+        std::atomic<uint64_t> epoch{ 0 };    // 0：不在临界区；否则是进入时的纪元
+        std::atomic<bool>     inUse{ true };
+        ThreadRecord*         next = nullptr;
+        uint32_t              depth = 0;     // 嵌套层数，只由所属线程访问
+    };
+
+    namespace
+    {
+        constinit std::atomic<uint64_t>      s_epoch{ 1 };
+        constinit std::atomic<ThreadRecord*> s_records{ nullptr };
+
+        ThreadRecord* Acquire()
+        {
+            // 先尝试复用已退出线程的记录
+            for (ThreadRecord* r = s_records.load(std::memory_order_acquire); r; r = r->next)
+            {
+                bool expected = false;
+                if (!r->inUse.load(std::memory_order_relaxed) &&
+                    r->inUse.compare_exchange_strong(expected, true, std::memory_order_acquire))
+                    return r;
+            }
+
+            ThreadRecord* r = new ThreadRecord();
+            ThreadRecord* head = s_records.load(std::memory_order_relaxed);
+            do
+            {
+                r->next = head;
+            } while (!s_records.compare_exchange_weak(head, r, std::memory_order_release, std::memory_order_relaxed));
+            return r;
+        }
+
+        // 线程退出时归还记录
+        struct RecordHolder
+        {
+            ThreadRecord* record = nullptr;
+
+            ~RecordHolder()
+            {
+                if (record) record->inUse.store(false, std::memory_order_release);
+            }
+        };
+
+        thread_local RecordHolder t_holder;
+    }
+
+    Guard::Guard()
+    {
+        ThreadRecord* r = t_holder.record;
+        if (!r) r = t_holder.record = Acquire();
+        m_record = r;
+
+        if (r->depth++ == 0)
+        {
+            // seq_cst：与写者"摘下指针 → 检查各线程纪元"配对，
+            // 要么写者看到本线程在临界区，要么本线程之后读到的已经是新指针
+            r->epoch.store(s_epoch.load(std::memory_order_relaxed), std::memory_order_seq_cst);
+        }
+    }
+
+    Guard::~Guard()
+    {
+        if (--m_record->depth == 0)
+            m_record->epoch.store(0, std::memory_order_release);
+    }
+
+    uint64_t Current()
+    {
+        return s_epoch.load(std::memory_order_seq_cst);
+    }
+
+    bool TryAdvance()
+    {
+        uint64_t current = s_epoch.load(std::memory_order_seq_cst);
+        for (ThreadRecord* r = s_records.load(std::memory_order_acquire); r; r = r->next)
+        {
+            uint64_t e = r->epoch.load(std::memory_order_seq_cst);
+            if (e != 0 && e != current) return false;  // 还有线程停留在旧纪元
+        }
+        return s_epoch.compare_exchange_strong(current, current + 1, std::memory_order_seq_cst);
+    }
+
+    bool IsSafe(uint64_t retireEpoch)
+    {
+        return Current() >= retireEpoch + 2;
+    }
+}
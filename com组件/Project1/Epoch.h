@@ -0,0 +1,45 @@
+// Epoch.h - 基于纪元的回收（EBR）
+// =====================================================
+// 读者不加锁地访问共享对象，写者把对象摘下后不能立即释放：可能还有读者拿着旧指针。
+// 做法：
+//   - 全局纪元号 Current()；读者进入临界区时把当前纪元记在自己线程的记录里，离开时清除
+//   - 写者摘下对象后记下当时的纪元 r，之后尝试推进纪元（TryAdvance）：
+//     只有所有正在临界区中的线程都已经处于当前纪元时才能推进
+//   - 纪元推进到 r + 2 时，摘下之前进入临界区的读者一定都已离开，对象可以释放（IsSafe）
+//
+//   {
+//       Epoch::Guard guard;                   // 读者：一次原子写，不加锁
+//       Module* m = entry->module.load();     // guard 存在期间 m 不会被回收
+//       ...
+//   }
+//
+// 临界区可以嵌套；不要在临界区里阻塞等待回收（会让纪元无法推进）
+#pragma once
+#include <cstdint>
+
+namespace Epoch
+{
+    struct ThreadRecord;
+
+    class Guard
+    {
+    private:
+        ThreadRecord* m_record;
+
+    public:
+        Guard();
+        ~Guard();
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+    };
+
+    // 当前纪元
+    uint64_t Current();
+
+    // 所有临界区中的线程都已处于当前纪元时推进一步，返回是否推进成功
+    bool TryAdvance();
+
+    // 在纪元 retireEpoch 摘下的对象现在是否可以回收
+    bool IsSafe(uint64_t retireEpoch);
+}
@@ -0,0 +1,1113 @@
+// Expression.cpp - 表达式编译器、解释器和缓存
+#include "Expression.h"
+#include "StandardCOM.h"
+#include "BatchKernels.h"
+#include "ComLog.h"
+#include "ComModule.h"
+#include "InterfaceMap.h"
+#include "WorkStealingPool.h"
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define EXPRESSION_THREADED_CODE 1
+#else
+#define EXPRESSION_THREADED_CODE 0
+#endif
+
+namespace Expression
+{
+    namespace
+    {
+        // 寄存器机 + 累加器：最近一次运算的结果留在累加器里（解释器中是一个局部变量，即 CPU 寄存器），
+        // 指令的另一个操作数是寄存器或常量。连续的运算不经过内存，只有累加器要让给别的子表达式时
+        // 才把它存进寄存器（St）
+        //
+        // 指令集：
+        //   Ld r                     acc = r
+        //   Add/Sub/Mul/Div r        acc = acc op r（Div 在运行时检查除数）
+        //   AddK/SubK/MulK/DivK k    acc = acc op k（DivK 的除数在编译时已确认不为 0，并算好了乘数和移位量）
+        //   RSub/RDiv r              acc = r op acc
+        //   RSubK/RDivK k            acc = k op acc
+        //   Neg                      acc = -acc
+        //   St r                     r = acc
+        //   StLd r, t                t = acc; acc = r（把累加器让出来再装入另一个操作数，省一次分派）
+        //   Ret / RetK k             返回 acc / 返回 k
+        // 读寄存器的指令各有一个 T 版本（LdT、AddT ...、StLdT），操作数是中间结果：
+        // 单个求值时变量直接从调用者的数组里读，中间结果在解释器自己的数组里，不需要先把变量复制过来
+#define EXPRESSION_OPCODES(X) \
+        X(Ld) \
+        X(Add) X(Sub) X(Mul) X(Div) \
+        X(AddK) X(SubK) X(MulK) X(DivK) \
+        X(RSub) X(RDiv) X(RSubK) X(RDivK) \
+        X(Neg) X(St) \
+        X(Ret) X(RetK) \
+        X(LdT) X(AddT) X(SubT) X(MulT) X(DivT) X(RSubT) X(RDivT) \
+        X(StLd) X(StLdT)
+
+        enum Op : uint8_t
+        {
+#define EXPRESSION_ENUM(name) Op_##name,
+            EXPRESSION_OPCODES(EXPRESSION_ENUM)
+#undef EXPRESSION_ENUM
+        };
+
+        // 8 字节一条：变量占寄存器 [0, 变量数)，中间结果紧随其后
+        struct Instr
+        {
+            uint8_t  op;
+            uint8_t  reg;
+            uint16_t divisor;  // DivK：表达式的除数表下标
+            int32_t  k;        // 常量；StLd 是存入的寄存器
+        };
+
+        // 操作数换成中间结果的版本
+        inline uint8_t TempVariant(uint8_t op)
+        {
+            switch (op)
+            {
+            case Op_Ld:   return Op_LdT;
+            case Op_Add:  return Op_AddT;
+            case Op_Sub:  return Op_SubT;
+            case Op_Mul:  return Op_MulT;
+            case Op_Div:  return Op_DivT;
+            case Op_RSub: return Op_RSubT;
+            case Op_RDiv: return Op_RDivT;
+            case Op_StLd: return Op_StLdT;
+            default:      return op;  // St 只写中间结果，不需要区分
+            }
+        }
+
+        const size_t kMaxRegisters = kMaxVariables + kMaxTemporaries;
+        static_assert(kMaxRegisters <= 256, "register index must fit in uint8_t");
+
+        // 运算语义与 Calculator / BatchKernels 一致：32 位补码回绕，除法向零截断，INT_MIN / -1 回绕为 INT_MIN
+        inline int WrapAdd(int a, int b) { return (int)((unsigned)a + (unsigned)b); }
+        inline int WrapSub(int a, int b) { return (int)((unsigned)a - (unsigned)b); }
+        inline int WrapMul(int a, int b) { return (int)((unsigned)a * (unsigned)b); }
+        inline int WrapNeg(int a) { return (int)(0u - (unsigned)a); }
+        inline int TruncDiv(int a, int b) { return b == -1 ? WrapNeg(a) : a / b; }
+
+        // 变量从 vars 读，中间结果读写 temps（按寄存器号索引，变量占的前几个位置不用）；
+        // divisors 是 DivK 用的除数表
+        HRESULT Run(const Instr* ip, const int* vars, int* temps, const BatchDivisor* divisors, int* result)
+        {
+            int acc = 0;
+#if EXPRESSION_THREADED_CODE
+#define EXPRESSION_LABEL(name) &&L_##name,
+            static const void* const s_labels[] = { EXPRESSION_OPCODES(EXPRESSION_LABEL) };
+#undef EXPRESSION_LABEL
+#define VM_OP(name) L_##name:
+#define VM_NEXT()   goto *s_labels[(++ip)->op]
+            goto *s_labels[ip->op];
+#else
+#define VM_OP(name) case Op_##name:
+#define VM_NEXT()   ++ip; continue
+            for (;;)
+            {
+                switch (ip->op)
+                {
+                default:
+                    return E_UNEXPECTED;
+#endif
+            VM_OP(Ld)    acc = vars[ip->reg]; VM_NEXT();
+            VM_OP(Add)   acc = WrapAdd(acc, vars[ip->reg]); VM_NEXT();
+            VM_OP(Sub)   acc = WrapSub(acc, vars[ip->reg]); VM_NEXT();
+            VM_OP(Mul)   acc = WrapMul(acc, vars[ip->reg]); VM_NEXT();
+            VM_OP(Div)
+                if (vars[ip->reg] == 0) return E_INVALIDARG;  // 与 Divide 一致：除数为 0
+                acc = TruncDiv(acc, vars[ip->reg]);
+                VM_NEXT();
+            VM_OP(AddK)  acc = WrapAdd(acc, ip->k); VM_NEXT();
+            VM_OP(SubK)  acc = WrapSub(acc, ip->k); VM_NEXT();
+            VM_OP(MulK)  acc = WrapMul(acc, ip->k); VM_NEXT();
+            VM_OP(DivK)  acc = BatchDivide(acc, divisors[ip->divisor]); VM_NEXT();
+            VM_OP(RSub)  acc = WrapSub(vars[ip->reg], acc); VM_NEXT();
+            VM_OP(RDiv)
+                if (acc == 0) return E_INVALIDARG;
+                acc = TruncDiv(vars[ip->reg], acc);
+                VM_NEXT();
+            VM_OP(RSubK) acc = WrapSub(ip->k, acc); VM_NEXT();
+            VM_OP(RDivK)
+                if (acc == 0) return E_INVALIDARG;
+                acc = TruncDiv(ip->k, acc);
+                VM_NEXT();
+            VM_OP(Neg)   acc = WrapNeg(acc); VM_NEXT();
+            VM_OP(St)    temps[ip->reg] = acc; VM_NEXT();
+            VM_OP(Ret)   *result = acc; return S_OK;
+            VM_OP(RetK)  *result = ip->k; return S_OK;
+            VM_OP(LdT)   acc = temps[ip->reg]; VM_NEXT();
+            VM_OP(AddT)  acc = WrapAdd(acc, temps[ip->reg]); VM_NEXT();
+            VM_OP(SubT)  acc = WrapSub(acc, temps[ip->reg]); VM_NEXT();
+            VM_OP(MulT)  acc = WrapMul(acc, temps[ip->reg]); VM_NEXT();
+            VM_OP(DivT)
+                if (temps[ip->reg] == 0) return E_INVALIDARG;
+                acc = TruncDiv(acc, temps[ip->reg]);
+                VM_NEXT();
+            VM_OP(RSubT) acc = WrapSub(temps[ip->reg], acc); VM_NEXT();
+            VM_OP(RDivT)
+                if (acc == 0) return E_INVALIDARG;
+                acc = TruncDiv(temps[ip->reg], acc);
+                VM_NEXT();
+            VM_OP(StLd)  temps[ip->k] = acc; acc = vars[ip->reg]; VM_NEXT();
+            VM_OP(StLdT) temps[ip->k] = acc; acc = temps[ip->reg]; VM_NEXT();
+#if !EXPRESSION_THREADED_CODE
+                }
+            }
+#endif
+#undef VM_OP
+#undef VM_NEXT
+        }
+
+        // ========================================
+        // 编译器：递归下降，边分析边生成指令
+        // ========================================
+        //   expr    := term (('+' | '-') term)*
+        //   term    := unary (('*' | '/') unary)*
+        //   unary   := ('-' | '+') unary | primary
+        //   primary := 整数 | 标识符 | '(' expr ')'
+        class Compiler
+        {
+        private:
+            // 编译期间中间结果的寄存器号从 kTempBase 开始，最后再重新编号到变量之后
+            static const uint32_t kTempBase = 128;
+            static_assert(kMaxVariables <= kTempBase && kMaxTemporaries <= 256 - kTempBase, "register layout");
+
+            // 子表达式的值在哪里
+            enum Kind : uint8_t
+            {
+                Const,  // 编译时已知的常量 value
+                Reg,    // 寄存器 reg（变量或存下来的中间结果）
+                Acc,    // 累加器
+            };
+
+            struct Operand
+            {
+                Kind    kind;
+                int     value;
+                uint8_t reg;
+            };
+
+            const char*               m_source;
+            const char*               m_p;
+            std::vector<Instr>&       m_code;
+            std::vector<std::string>& m_names;
+            Operand*                  m_acc = nullptr;  // 当前占着累加器、还没有被使用的子表达式
+            bool                      m_tempUsed[kMaxTemporaries] = {};
+            uint32_t                  m_depth = 0;
+            const char*               m_error = nullptr;
+            size_t                    m_errorPos = 0;
+
+        public:
+            Compiler(const char* source, std::vector<Instr>& code, std::vector<std::string>& names)
+                : m_source(source), m_p(source), m_code(code), m_names(names)
+            {
+            }
+
+            HRESULT Run()
+            {
+                Operand result;
+                if (ParseExpr(result))
+                {
+                    SkipSpace();
+                    if (*m_p) Fail("多余的字符");
+                    else if (result.kind == Const) Emit(Op_RetK, 0, result.value);
+                    else if (Load(result)) Emit(Op_Ret, 0, 0);
+                }
+                if (m_error)
+                {
+                    COM_LOG_DEBUG("[Expression] 编译失败: 位置 {}: {}", m_errorPos, m_error);  // 日志只能引用静态字符串，不输出源文本
+                    return E_INVALIDARG;
+                }
+
+                // 中间结果排在变量之后，读中间结果的指令换成 T 版本
+                uint32_t varCount = (uint32_t)m_names.size();
+                for (Instr& in : m_code)
+                {
+                    if (in.op == Op_StLd) in.k = (int32_t)(varCount + in.k - kTempBase);
+                    if (in.reg < kTempBase) continue;
+                    in.reg = (uint8_t)(varCount + in.reg - kTempBase);
+                    in.op = TempVariant(in.op);
+                }
+                return S_OK;
+            }
+
+        private:
+            static Operand MakeConst(int value) { return Operand{ Const, value, 0 }; }
+            static Operand MakeReg(uint8_t reg) { return Operand{ Reg, 0, reg }; }
+
+            bool Fail(const char* message)
+            {
+                if (!m_error)
+                {
+                    m_error = message;
+                    m_errorPos = (size_t)(m_p - m_source);
+                }
+                return false;
+            }
+
+            void SkipSpace()
+            {
+                while (*m_p == ' ' || *m_p == '\t' || *m_p == '\r' || *m_p == '\n') ++m_p;
+            }
+
+            void Emit(Op op, uint8_t reg, int32_t k)
+            {
+                m_code.push_back(Instr{ (uint8_t)op, reg, 0, k });
+            }
+
+            void Free(const Operand& o)
+            {
+                if (o.kind == Reg && o.reg >= kTempBase) m_tempUsed[o.reg - kTempBase] = false;
+            }
+
+            // 累加器被别的子表达式占着时，先把它存进一个空闲寄存器
+            bool Spill()
+            {
+                if (!m_acc) return true;
+                uint32_t t = 0;
+                while (t < kMaxTemporaries && m_tempUsed[t]) ++t;
+                if (t == kMaxTemporaries) return Fail("表达式太复杂");
+                m_tempUsed[t] = true;
+                Emit(Op_St, (uint8_t)(kTempBase + t), 0);
+                *m_acc = MakeReg((uint8_t)(kTempBase + t));
+                m_acc = nullptr;
+                return true;
+            }
+
+            // 把 a 放进累加器（a 随即被使用，不再占用任何位置）
+            bool Load(const Operand& a)
+            {
+                if (a.kind == Acc)
+                {
+                    m_acc = nullptr;
+                    return true;
+                }
+                bool spilled = m_acc != nullptr;
+                if (!Spill()) return false;
+                if (spilled)  // 刚生成的 St 和这条 Ld 合成一条
+                {
+                    Instr& st = m_code.back();
+                    st = Instr{ Op_StLd, a.reg, 0, st.reg };
+                }
+                else
+                {
+                    Emit(Op_Ld, a.reg, 0);
+                }
+                Free(a);
+                return true;
+            }
+
+            void SetAcc(Operand& out)
+            {
+                out = Operand{ Acc, 0, 0 };
+                m_acc = &out;
+            }
+
+            void Move(Operand& out, const Operand& a)
+            {
+                if (&out == &a) return;
+                out = a;
+                if (a.kind == Acc) m_acc = &out;
+            }
+
+            static int Fold(char op, int a, int b)
+            {
+                switch (op)
+                {
+                case '+': return WrapAdd(a, b);
+                case '-': return WrapSub(a, b);
+                case '*': return WrapMul(a, b);
+                default:  return TruncDiv(a, b);
+                }
+            }
+
+            // out 可以和 a 是同一个对象
+            bool Binary(char op, const Operand& a, const Operand& b, Operand& out)
+            {
+                if (op == '/' && b.kind == Const && b.value == 0) return Fail("除数为常数 0");
+
+                if (a.kind == Const && b.kind == Const)  // 常量折叠
+                {
+                    out = MakeConst(Fold(op, a.value, b.value));
+                    return true;
+                }
+                if (b.kind == Const)
+                {
+                    // x + 0、x - 0、x * 1、x / 1 不生成指令
+                    if ((b.value == 0 && (op == '+' || op == '-')) || (b.value == 1 && (op == '*' || op == '/')))
+                    {
+                        Move(out, a);
+                        return true;
+                    }
+                    int k = b.value;
+                    if (!Load(a)) return false;
+                    Emit(op == '+' ? Op_AddK : op == '-' ? Op_SubK : op == '*' ? Op_MulK : Op_DivK, 0, k);
+                    SetAcc(out);
+                    return true;
+                }
+                if (a.kind == Const)
+                {
+                    if (op == '+' || op == '*') return Binary(op, b, a, out);  // 交换律
+                    if (op == '-' && a.value == 0) return Negate(b, out);
+                    int k = a.value;
+                    if (!Load(b)) return false;
+                    Emit(op == '-' ? Op_RSubK : Op_RDivK, 0, k);
+                    SetAcc(out);
+                    return true;
+                }
+                if (b.kind == Acc)  // a 一定在寄存器里：acc = a op acc
+                {
+                    m_acc = nullptr;
+                    Emit(op == '+' ? Op_Add : op == '-' ? Op_RSub : op == '*' ? Op_Mul : Op_RDiv, a.reg, 0);
+                    Free(a);
+                    SetAcc(out);
+                    return true;
+                }
+                uint8_t reg = b.reg;
+                if (!Load(a)) return false;
+                Emit(op == '+' ? Op_Add : op == '-' ? Op_Sub : op == '*' ? Op_Mul : Op_Div, reg, 0);
+                Free(b);
+                SetAcc(out);
+                return true;
+            }
+
+            bool Negate(const Operand& a, Operand& out)
+            {
+                if (a.kind == Const)
+                {
+                    out = MakeConst(WrapNeg(a.value));
+                    return true;
+                }
+                if (!Load(a)) return false;
+                Emit(Op_Neg, 0, 0);
+                SetAcc(out);
+                return true;
+            }
+
+            bool ParseExpr(Operand& out)
+            {
+                if (!ParseTerm(out)) return false;
+                for (;;)
+                {
+                    SkipSpace();
+                    char op = *m_p;
+                    if (op != '+' && op != '-') return true;
+                    ++m_p;
+                    Operand rhs;
+                    if (!ParseTerm(rhs) || !Binary(op, out, rhs, out)) return false;
+                }
+            }
+
+            bool ParseTerm(Operand& out)
+            {
+                if (!ParseUnary(out)) return false;
+                for (;;)
+                {
+                    SkipSpace();
+                    char op = *m_p;
+                    if (op != '*' && op != '/') return true;
+                    ++m_p;
+                    Operand rhs;
+                    if (!ParseUnary(rhs) || !Binary(op, out, rhs, out)) return false;
+                }
+            }
+
+            bool ParseUnary(Operand& out)
+            {
+                SkipSpace();
+                if (*m_p == '+')
+                {
+                    ++m_p;
+                    return Nested([&] { return ParseUnary(out); });
+                }
+                if (*m_p == '-')
+                {
+                    ++m_p;
+                    Operand a;
+                    return Nested([&] { return ParseUnary(a); }) && Negate(a, out);
+                }
+                return ParsePrimary(out);
+            }
+
+            // 限制递归深度，防止恶意输入耗尽栈
+            template <class F>
+            bool Nested(F parse)
+            {
+                if (++m_depth > 256) return Fail("嵌套太深");
+                bool ok = parse();
+                --m_depth;
+                return ok;
+            }
+
+            bool ParsePrimary(Operand& out)
+            {
+                SkipSpace();
+                char c = *m_p;
+                if (c >= '0' && c <= '9')
+                {
+                    // 2147483648 只能出现在负号后面，回绕后正好是 INT_MIN
+                    uint64_t value = 0;
+                    while (*m_p >= '0' && *m_p <= '9')
+                    {
+                        value = value * 10 + (uint64_t)(*m_p++ - '0');
+                        if (value > (uint64_t)INT_MAX + 1) return Fail("整数超出范围");
+                    }
+                    out = MakeConst((int)(uint32_t)value);
+                    return true;
+                }
+                if (c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))
+                {
+                    const char* begin = m_p;
+                    while (*m_p == '_' || (*m_p >= 'a' && *m_p <= 'z') || (*m_p >= 'A' && *m_p <= 'Z') ||
+                           (*m_p >= '0' && *m_p <= '9'))
+                        ++m_p;
+                    size_t length = (size_t)(m_p - begin);
+
+                    size_t index = 0;
+                    while (index < m_names.size() && m_names[index].compare(0, std::string::npos, begin, length) != 0)
+                        ++index;
+                    if (index == m_names.size())
+                    {
+                        if (index >= kMaxVariables) return Fail("变量太多");
+                        m_names.emplace_back(begin, length);
+                    }
+                    out = MakeReg((uint8_t)index);
+                    return true;
+                }
+                if (c == '(')
+                {
+                    ++m_p;
+                    if (!Nested([&] { return ParseExpr(out); })) return false;
+                    SkipSpace();
+                    if (*m_p != ')') return Fail("缺少 ')'");
+                    ++m_p;
+                    return true;
+                }
+                return Fail(c ? "应为数字、变量或 '('" : "表达式不完整");
+            }
+        };
+
+        // ========================================
+        // 列式求值：同一段字节码作用在整列数据上
+        // ========================================
+        // 行按 kColumnChunk 切成任务，多个线程（调用线程 + 线程池）按原子计数器领取；
+        // 每个任务再按 kColumnBlock 行一块执行字节码，每条指令是一次 BatchKernels 的 SIMD 调用，
+        // 一块的累加器、中间结果和常量都留在 L1/L2 里。累加器就是输出列本身，不需要额外的缓冲区
+        const size_t kColumnBlock = 1024;         // 一块的行数（4 KB 一列）
+        const size_t kColumnChunk = 32 * 1024;    // 一个任务的行数
+
+        // 用到常量块的指令（DivK 用预先算好的除数，不需要）
+        inline bool HasConstant(uint8_t op)
+        {
+            return op == Op_AddK || op == Op_SubK || op == Op_MulK || op == Op_RSubK || op == Op_RDivK;
+        }
+
+        struct ColumnProgram
+        {
+            const Instr*        code;
+            size_t              varCount;
+            size_t              tempCount;
+            const int*          constants;    // 常量块：带常量的指令每条一块，按指令顺序排列
+            const BatchDivisor* divisors;     // DivK 的除数表
+            const int* const*   columns;
+            int*                out;
+            unsigned char*      errors;       // 可以为空
+        };
+
+        const int s_zeroBlock[kColumnBlock] = {};  // Neg：0 - acc
+
+        // 每个线程一份的内存：中间结果块、除数副本和每行的失败标记。
+        // 只增不减，稳定状态下列式求值不再分配；线程退出时释放。求值过程中不会回调外部代码，不会重入
+        struct ThreadColumnMemory
+        {
+            int*          ints = nullptr;
+            size_t        capacity = 0;  // ints 的元素个数
+            unsigned char flags[kColumnBlock];
+
+            ~ThreadColumnMemory()
+            {
+                delete[] ints;
+            }
+
+            int* Reserve(size_t count)
+            {
+                if (count <= capacity) return ints;
+                int* grown = new (std::nothrow) int[count];
+                if (!grown) return nullptr;
+                delete[] ints;
+                ints = grown;
+                capacity = count;
+                return ints;
+            }
+        };
+
+        thread_local ThreadColumnMemory t_columnMemory;
+
+        // 一个线程执行字节码用的工作区（内存来自本线程的 ThreadColumnMemory）
+        class ColumnWorkspace
+        {
+        private:
+            int*                 m_ints;
+            unsigned char*       m_flags;
+            const ColumnProgram& m_program;
+            bool                 m_anyFailed = false;  // 本块是否有失败的行（m_flags 有效）
+
+        public:
+            // 只准备内存，不读字节码（线程池里的帮手在领到任务之前不能访问表达式）
+            explicit ColumnWorkspace(const ColumnProgram& program)
+                : m_ints(t_columnMemory.Reserve((program.tempCount + 1) * kColumnBlock))
+                , m_flags(t_columnMemory.flags)
+                , m_program(program)
+            {
+            }
+
+            ColumnWorkspace(const ColumnWorkspace&) = delete;
+            ColumnWorkspace& operator=(const ColumnWorkspace&) = delete;
+
+            bool Valid() const { return m_ints != nullptr; }
+
+            // 执行从 begin 开始的 n 行（n 不超过 kColumnBlock），返回失败的行数
+            size_t RunBlock(size_t begin, size_t n, const BatchKernelTable& k)
+            {
+                const ColumnProgram& p = m_program;
+                int* acc = p.out + begin;
+                const int* in = acc;  // 累加器的当前内容：Ld 之后直接指向输入列，不复制
+                const int* constant = p.constants;
+                m_anyFailed = false;
+
+                const Instr* ip = p.code;
+                for (; ip->op != Op_Ret && ip->op != Op_RetK; ++ip)
+                {
+                    switch (ip->op)
+                    {
+                    case Op_Ld:
+                    case Op_LdT:
+                        in = Reg(ip->reg, begin);
+                        continue;
+                    case Op_St:
+                        std::memcpy(Reg(ip->reg, begin), in, n * sizeof(int));
+                        continue;
+                    case Op_StLd:
+                    case Op_StLdT:
+                        std::memcpy(Reg((uint8_t)ip->k, begin), in, n * sizeof(int));
+                        in = Reg(ip->reg, begin);
+                        continue;
+                    case Op_Add:   case Op_AddT:  k.add(in, Reg(ip->reg, begin), acc, n); break;
+                    case Op_Sub:   case Op_SubT:  k.sub(in, Reg(ip->reg, begin), acc, n); break;
+                    case Op_Mul:   case Op_MulT:  k.mul(in, Reg(ip->reg, begin), acc, n); break;
+                    case Op_Div:   case Op_DivT:  Divide(in, Reg(ip->reg, begin), acc, n, k); break;
+                    case Op_AddK:                 k.add(in, constant, acc, n); constant += kColumnBlock; break;
+                    case Op_SubK:                 k.sub(in, constant, acc, n); constant += kColumnBlock; break;
+                    case Op_MulK:                 k.mul(in, constant, acc, n); constant += kColumnBlock; break;
+                    case Op_DivK:                 k.divBy(in, p.divisors[ip->divisor], acc, n); break;  // 乘法和移位代替除法
+                    case Op_RSub:  case Op_RSubT: k.sub(Reg(ip->reg, begin), in, acc, n); break;
+                    case Op_RDiv:  case Op_RDivT: Divide(Reg(ip->reg, begin), in, acc, n, k); break;
+                    case Op_RSubK:                k.sub(constant, in, acc, n); constant += kColumnBlock; break;
+                    case Op_RDivK:                Divide(constant, in, acc, n, k); constant += kColumnBlock; break;
+                    case Op_Neg:                  k.sub(s_zeroBlock, in, acc, n); break;
+                    }
+                    in = acc;  // 其余指令的结果都写在累加器里
+                }
+                if (ip->op == Op_RetK)
+                {
+                    for (size_t i = 0; i < n; ++i) acc[i] = ip->k;
+                }
+                else if (in != acc)
+                {
+                    std::memcpy(acc, in, n * sizeof(int));
+                }
+
+                if (!m_anyFailed)
+                {
+                    if (p.errors) std::memset(p.errors + begin, 0, n);
+                    return 0;
+                }
+
+                // 失败的行输出 0
+                size_t failed = 0;
+                for (size_t i = 0; i < n; ++i)
+                {
+                    if (m_flags[i])
+                    {
+                        acc[i] = 0;
+                        ++failed;
+                    }
+                }
+                if (p.errors) std::memcpy(p.errors + begin, m_flags, n);
+                return failed;
+            }
+
+        private:
+            int* Temps() const { return m_ints; }
+            int* Divisors() const { return m_ints + m_program.tempCount * kColumnBlock; }
+
+            // 寄存器 r 在本块的数据：变量指向输入列，中间结果在工作区里
+            int* Reg(uint8_t r, size_t begin) const
+            {
+                if (r < m_program.varCount) return const_cast<int*>(m_program.columns[r]) + begin;
+                return Temps() + (r - m_program.varCount) * kColumnBlock;
+            }
+
+            // 带掩码的除法：除数为 0 的行记下失败并按除数 1 计算（结果最后清 0），其余行不受影响
+            void Divide(const int* a, const int* b, int* out, size_t n, const BatchKernelTable& k)
+            {
+                if (!k.hasZero(b, n))
+                {
+                    k.div(a, b, out, n);
+                    return;
+                }
+                if (!m_anyFailed)
+                {
+                    std::memset(m_flags, 0, n);
+                    m_anyFailed = true;
+                }
+                int* d = Divisors();
+                for (size_t i = 0; i < n; ++i)
+                {
+                    d[i] = b[i] ? b[i] : 1;
+                    if (!b[i]) m_flags[i] = 1;
+                }
+                k.div(a, d, out, n);
+            }
+        };
+
+        // 一次列式求值的共享状态（堆上分配，引用计数）
+        // 线程池里的帮手可能在所有任务都完成、调用线程已经返回之后才开始运行：
+        // 那时它只会发现没有剩余的任务，释放引用后退出，不会再访问表达式和数据
+        class ColumnJob
+        {
+        private:
+            struct Helper : PoolTask
+            {
+                ColumnJob* job;
+            };
+
+            ColumnProgram           m_program;
+            const BatchKernelTable& m_kernels;
+            size_t                  m_rows;
+            size_t                  m_chunkCount;
+            std::atomic<size_t>     m_next{ 0 };    // 下一个要领取的任务
+            std::atomic<size_t>     m_done{ 0 };    // 已完成的任务数
+            std::atomic<size_t>     m_failed{ 0 };  // 失败的行数
+            std::atomic<uint32_t>   m_refs{ 1 };
+            Helper*                 m_helpers = nullptr;
+
+        public:
+            ColumnJob(const ColumnProgram& program, const BatchKernelTable& kernels, size_t rows)
+                : m_program(program)
+                , m_kernels(kernels)
+                , m_rows(rows)
+                , m_chunkCount((rows + kColumnChunk - 1) / kColumnChunk)
+            {
+            }
+
+            ~ColumnJob()
+            {
+                delete[] m_helpers;
+            }
+
+            // 在线程池上启动最多 count 个帮手
+            void StartHelpers(size_t count)
+            {
+                if (count == 0) return;
+                m_helpers = new (std::nothrow) Helper[count];
+                if (!m_helpers) return;  // 没有帮手也能完成：调用线程会领取所有任务
+
+                for (size_t i = 0; i < count; ++i)
+                {
+                    m_helpers[i].run = &RunHelper;
+                    m_helpers[i].next = i + 1 < count ? &m_helpers[i + 1] : nullptr;
+                    m_helpers[i].job = this;
+                }
+                m_refs.fetch_add((uint32_t)count, std::memory_order_relaxed);
+                WorkStealingPool::Default().SubmitList(&m_helpers[0], &m_helpers[count - 1], count);
+            }
+
+            // 领取并执行任务，直到没有剩余
+            void Work(ColumnWorkspace& ws)
+            {
+                for (;;)
+                {
+                    size_t chunk = m_next.fetch_add(1, std::memory_order_relaxed);
+                    if (chunk >= m_chunkCount) return;
+
+                    size_t begin = chunk * kColumnChunk;
+                    size_t end = begin + kColumnChunk < m_rows ? begin + kColumnChunk : m_rows;
+                    size_t failed = 0;
+                    for (size_t b = begin; b < end; b += kColumnBlock)
+                        failed += ws.RunBlock(b, end - b < kColumnBlock ? end - b : kColumnBlock, m_kernels);
+                    if (failed) m_failed.fetch_add(failed, std::memory_order_relaxed);
+
+                    if (m_done.fetch_add(1, std::memory_order_acq_rel) + 1 == m_chunkCount)
+                        m_done.notify_all();
+                }
+            }
+
+            // 调用线程：等所有任务完成，返回失败的行数
+            size_t Wait()
+            {
+                size_t done = m_done.load(std::memory_order_acquire);
+                while (done != m_chunkCount)
+                {
+                    m_done.wait(done, std::memory_order_acquire);
+                    done = m_done.load(std::memory_order_acquire);
+                }
+                return m_failed.load(std::memory_order_relaxed);
+            }
+
+            void Release()
+            {
+                if (m_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this;
+            }
+
+        private:
+            static void RunHelper(PoolTask* task)
+            {
+                ColumnJob* job = static_cast<Helper*>(task)->job;
+                {
+                    ColumnWorkspace ws(job->m_program);
+                    if (ws.Valid()) job->Work(ws);  // 分配失败时不领取任务
+                }
+                job->Release();
+            }
+        };
+
+        HRESULT EvaluateColumns(const ColumnProgram& program, size_t rows, size_t* failedRows)
+        {
+            const BatchKernelTable& kernels = GetBestBatchKernels();
+
+            // 调用线程的工作区先准备好：即使帮手一个都没有启动，调用线程也能独自完成
+            ColumnWorkspace ws(program);
+            if (!ws.Valid()) return E_OUTOFMEMORY;
+
+            size_t failed = 0;
+            size_t chunkCount = (rows + kColumnChunk - 1) / kColumnChunk;
+            unsigned workers = WorkStealingPool::Default().WorkerCount();
+            if (chunkCount <= 1 || std::thread::hardware_concurrency() <= 1 || workers == 0)
+            {
+                for (size_t b = 0; b < rows; b += kColumnBlock)
+                    failed += ws.RunBlock(b, rows - b < kColumnBlock ? rows - b : kColumnBlock, kernels);
+            }
+            else
+            {
+                ColumnJob* job = new (std::nothrow) ColumnJob(program, kernels, rows);
+                if (!job) return E_OUTOFMEMORY;
+                job->StartHelpers(chunkCount - 1 < workers ? chunkCount - 1 : workers);
+                job->Work(ws);
+                failed = job->Wait();
+                job->Release();
+            }
+
+            COM_LOG_TRACE("[Expression] 列式求值: {} 行, 失败 {} 行 ({})", rows, failed, kernels.name);
+            if (failedRows) *failedRows = failed;
+            return failed ? S_FALSE : S_OK;
+        }
+
+        // ========================================
+        // 编译结果：不可变的 COM 对象
+        // ========================================
+        class CompiledExpression final : public IExpression
+        {
+        private:
+            RefCount                  m_refCount;
+            uint64_t                  m_hash;
+            std::string               m_source;
+            std::vector<Instr>        m_code;
+            std::vector<std::string>  m_names;
+            std::vector<BatchDivisor> m_divisors;        // 每条 DivK 一项：编译时算好乘数和移位量
+            size_t                    m_tempCount = 0;   // 存中间结果用的寄存器数
+            size_t                    m_constCount = 0;  // 带常量的指令数
+            std::atomic<int*>         m_constBlocks{ nullptr };  // 列式求值用的常量块，第一次列式求值时填好
+
+        public:
+            CompiledExpression(uint64_t hash, const char* source, size_t length)
+                : m_refCount(1), m_hash(hash), m_source(source, length)
+            {
+                ComModule::AddObject();  // 没有进缓存的表达式存在期间模块不能卸载
+            }
+
+            virtual ~CompiledExpression()
+            {
+                delete[] m_constBlocks.load(std::memory_order_relaxed);
+                ComModule::ReleaseObject();
+            }
+
+            HRESULT Compile()
+            {
+                HRESULT hr = Compiler(m_source.c_str(), m_code, m_names).Run();
+                if (SUCCEEDED(hr))
+                {
+                    for (Instr& in : m_code)
+                    {
+                        if (in.op == Op_St || in.op == Op_StLd || in.op == Op_StLdT)
+                        {
+                            size_t stored = in.op == Op_St ? in.reg : (size_t)in.k;
+                            if (stored + 1 - m_names.size() > m_tempCount) m_tempCount = stored + 1 - m_names.size();
+                        }
+                        if (HasConstant(in.op)) ++m_constCount;
+                        if (in.op == Op_DivK)
+                        {
+                            if (m_divisors.size() > UINT16_MAX)
+                            {
+                                COM_LOG_DEBUG("[Expression] 编译失败: 常数除法超过 {} 个", UINT16_MAX + 1);
+                                return E_INVALIDARG;
+                            }
+                            BatchDivisor d;
+                            PrepareBatchDivisor(in.k, &d);  // 除数在编译时已确认不为 0
+                            in.divisor = (uint16_t)m_divisors.size();
+                            m_divisors.push_back(d);
+                        }
+                    }
+                    COM_LOG_DEBUG("[Expression] 编译完成: {} 条指令, {} 个变量", m_code.size(), m_names.size());
+                }
+                return hr;
+            }
+
+            bool Matches(uint64_t hash, const char* source, size_t length) const
+            {
+                return m_hash == hash && m_source.size() == length && std::memcmp(m_source.data(), source, length) == 0;
+            }
+
+            virtual HRESULT __stdcall QueryInterface(REFIID riid, void** ppvObject) override;
+
+            virtual ULONG __stdcall AddRef() override
+            {
+                return m_refCount.Increment();
+            }
+
+            virtual ULONG __stdcall Release() override
+            {
+                ULONG count = m_refCount.Decrement();
+                if (count == 0) delete this;
+                return count;
+            }
+
+            virtual HRESULT __stdcall Evaluate(const int* vars, size_t count, int* result) override
+            {
+                if (!result) return E_POINTER;
+                size_t varCount = m_names.size();
+                if (count < varCount) return E_INVALIDARG;
+                if (varCount && !vars) return E_POINTER;
+
+                int temps[kMaxRegisters];  // 只用到变量之后的部分，不需要初始化
+                return Run(m_code.data(), vars, temps, m_divisors.data(), result);
+            }
+
+            virtual HRESULT __stdcall EvaluateColumns(const int* const* columns, size_t columnCount, size_t rows,
+                                                      int* out, unsigned char* errors, size_t* failedRows) override
+            {
+                if (failedRows) *failedRows = 0;
+                if (rows == 0) return S_OK;
+                size_t varCount = m_names.size();
+                if (!out || (varCount && !columns)) return E_POINTER;
+                if (columnCount < varCount) return E_INVALIDARG;
+                for (size_t i = 0; i < varCount; ++i)
+                {
+                    if (!columns[i]) return E_POINTER;
+                }
+
+                const int* constants = ConstantBlocks();
+                if (m_constCount && !constants) return E_OUTOFMEMORY;
+
+                ColumnProgram program = { m_code.data(), varCount, m_tempCount, constants, m_divisors.data(), columns, out, errors };
+                return Expression::EvaluateColumns(program, rows, failedRows);
+            }
+
+            virtual HRESULT __stdcall GetVariableCount(size_t* count) override
+            {
+                if (!count) return E_POINTER;
+                *count = m_names.size();
+                return S_OK;
+            }
+
+            virtual HRESULT __stdcall GetVariableName(size_t index, const char** name) override
+            {
+                if (!name) return E_POINTER;
+                if (index >= m_names.size()) return E_INVALIDARG;
+                *name = m_names[index].c_str();
+                return S_OK;
+            }
+
+        private:
+            // 每条带常量的指令一块，块里 kColumnBlock 个相同的常量；只填一次，之后所有线程共用。
+            // 没有用过列式求值的表达式不占这块内存
+            const int* ConstantBlocks()
+            {
+                int* blocks = m_constBlocks.load(std::memory_order_acquire);
+                if (blocks || m_constCount == 0) return blocks;
+
+                blocks = new (std::nothrow) int[m_constCount * kColumnBlock];
+                if (!blocks) return nullptr;
+                int* c = blocks;
+                for (const Instr& in : m_code)
+                {
+                    if (!HasConstant(in.op)) continue;
+                    for (size_t i = 0; i < kColumnBlock; ++i) c[i] = in.k;
+                    c += kColumnBlock;
+                }
+
+                int* expected = nullptr;
+                if (!m_constBlocks.compare_exchange_strong(expected, blocks, std::memory_order_acq_rel, std::memory_order_acquire))
+                {
+                    delete[] blocks;  // 其他线程先填好了
+                    return expected;
+                }
+                return blocks;
+            }
+        };
+
+        static constexpr InterfaceEntry s_expressionInterfaces[] =
+        {
+            COM_INTERFACE_ENTRY(CompiledExpression, IExpression),
+            COM_INTERFACE_ENTRY2(CompiledExpression, IUnknown, IExpression),
+        };
+        static constinit InterfaceMap s_expressionMap("[Expression]", s_expressionInterfaces);
+
+        HRESULT __stdcall CompiledExpression::QueryInterface(REFIID riid, void** ppvObject)
+        {
+            return s_expressionMap.Query(this, riid, ppvObject);
+        }
+
+        // ========================================
+        // 缓存：开放寻址，查找不加锁
+        // ========================================
+        // 表项只增不删（缓存持有一个引用），读者看到非空指针后就可以一直使用它
+        static_assert((kCacheSlots & (kCacheSlots - 1)) == 0, "slot count must be a power of two");
+        const size_t kMaxProbe = 16;
+
+        constinit std::atomic<CompiledExpression*> s_cache[kCacheSlots];
+        constinit std::atomic<size_t>              s_cachedCount{ 0 };
+        std::mutex                                 s_insertLock;
+
+        // 每次取 8 个字节做乘法混合（逐字节的 FNV 在长公式上是一条很长的乘法依赖链）
+        uint64_t HashSource(const char* source, size_t& length)
+        {
+            length = std::strlen(source);
+            uint64_t h = length * 0x9E3779B97F4A7C15ull;
+            size_t i = 0;
+            for (; i + 8 <= length; i += 8)
+            {
+                uint64_t w;
+                std::memcpy(&w, source + i, 8);
+                h = (h ^ w) * 0xBF58476D1CE4E5B9ull;
+                h ^= h >> 29;
+            }
+            if (i < length)
+            {
+                uint64_t w = 0;
+                std::memcpy(&w, source + i, length - i);
+                h = (h ^ w) * 0xBF58476D1CE4E5B9ull;
+            }
+            return h ^ (h >> 31);
+        }
+
+        CompiledExpression* Find(uint64_t hash, const char* source, size_t length)
+        {
+            for (size_t probe = 0; probe < kMaxProbe; ++probe)
+            {
+                CompiledExpression* e = s_cache[(hash + probe) & (kCacheSlots - 1)].load(std::memory_order_acquire);
+                if (!e) return nullptr;
+                if (e->Matches(hash, source, length)) return e;
+            }
+            return nullptr;
+        }
+
+        // 编译并放进缓存；返回的指针带一个引用（由调用者释放）
+        HRESULT CompileAndInsert(uint64_t hash, const char* source, size_t length, CompiledExpression** ppExpr)
+        {
+            *ppExpr = nullptr;
+            CompiledExpression* e = nullptr;
+            try
+            {
+                e = new CompiledExpression(hash, source, length);
+                HRESULT hr = e->Compile();
+                if (FAILED(hr))
+                {
+                    e->Release();
+                    return hr;
+                }
+            }
+            catch (const std::bad_alloc&)  // 异常不能穿过 COM 接口
+            {
+                if (e) e->Release();
+                return E_OUTOFMEMORY;
+            }
+
+            std::lock_guard<std::mutex> lock(s_insertLock);
+            for (size_t probe = 0; probe < kMaxProbe; ++probe)
+            {
+                std::atomic<CompiledExpression*>& slot = s_cache[(hash + probe) & (kCacheSlots - 1)];
+                CompiledExpression* existing = slot.load(std::memory_order_relaxed);
+                if (!existing)
+                {
+                    e->AddRef();  // 缓存的引用
+                    slot.store(e, std::memory_order_release);
+                    if (s_cachedCount.fetch_add(1, std::memory_order_relaxed) == 0)
+                        ComModule::Pin();  // 缓存里的表达式一直保留，它们的代码在本模块里
+                    break;
+                }
+                if (existing->Matches(hash, source, length))  // 其他线程刚编译好同一个表达式
+                {
+                    existing->AddRef();
+                    e->Release();
+                    e = existing;
+                    break;
+                }
+            }
+            // 探测范围内没有空位时不缓存，调用者仍然得到可用的表达式
+            *ppExpr = e;
+            return S_OK;
+        }
+    }
+
+    HRESULT Compile(const char* source, IExpression** ppExpr)
+    {
+        if (!ppExpr) return E_POINTER;
+        *ppExpr = nullptr;
+        if (!source) return E_POINTER;
+
+        size_t length;
+        uint64_t hash = HashSource(source, length);
+        if (CompiledExpression* e = Find(hash, source, length))
+        {
+            e->AddRef();
+            *ppExpr = e;
+            return S_OK;
+        }
+
+        CompiledExpression* e = nullptr;
+        HRESULT hr = CompileAndInsert(hash, source, length, &e);
+        *ppExpr = e;
+        return hr;
+    }
+
+    HRESULT Evaluate(const char* source, const int* vars, size_t count, int* result)
+    {
+        if (!source || !result) return E_POINTER;
+
+        // 命中缓存时：一次哈希、一次比较，然后直接解释执行（缓存的表达式不会被释放，不需要 AddRef）
+        size_t length;
+        uint64_t hash = HashSource(source, length);
+        if (CompiledExpression* e = Find(hash, source, length)) return e->Evaluate(vars, count, result);
+
+        CompiledExpression* e = nullptr;
+        HRESULT hr = CompileAndInsert(hash, source, length, &e);
+        if (FAILED(hr)) return hr;
+        hr = e->Evaluate(vars, count, result);
+        e->Release();
+        return hr;
+    }
+
+    size_t CachedCount()
+    {
+        return s_cachedCount.load(std::memory_order_relaxed);
+    }
+}
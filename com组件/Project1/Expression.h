@@ -0,0 +1,48 @@
+// Expression.h - 表达式编译器和字节码解释器
+// =====================================================
+// IExpressionCalculator 的实现：把公式编译成寄存器字节码，一次调用求出结果
+//
+//   IExpression* p = nullptr;
+//   Expression::Compile("(x + 3) * y - x / 7", &p);   // x 是变量 0，y 是变量 1
+//   int vars[] = { 10, 2 };
+//   p->Evaluate(vars, 2, &r);                          // r = 25
+//
+// 编译：
+//   - 递归下降分析，直接生成指令（没有语法树）；变量就是寄存器
+//   - 寄存器机 + 累加器：每条指令是 acc = acc op 寄存器/常量，连续运算的中间结果留在 CPU 寄存器里，
+//     不像三地址码那样每一步都写回内存再读出来
+//   - 常量折叠：只含常量的子表达式在编译时算好，x + 0、x * 1 之类不生成指令
+//   - 除数是常量时在编译时检查：为 0 直接报错，否则生成不带检查的除法指令，
+//     并像 IBatchCalculator2::PrepareDivisor 一样预先算好乘数和移位量，求值时只做乘法和移位
+//   - 累加器让位（St）和紧接着的装入（Ld）合成一条指令；单个求值时变量直接从调用者的数组里读
+// 解释器：
+//   - GCC/Clang 用 computed goto（threaded code），每条指令末尾直接跳到下一条的处理代码；
+//     其他编译器退化为 switch
+// 列式求值（IExpression::EvaluateColumns）：
+//   - 同一段字节码作用在整列上：每条指令是对 1024 行的一次 SIMD 内核调用，中间结果放在每线程的工作区里
+//     （按需增长、之后复用）；常量块每个表达式只填一次
+//   - 大输入切成 32K 行的任务，调用线程和线程池一起领取；除数为 0 的行记入掩码，输出 0，不影响其他行
+// 缓存：
+//   - 以源文本为键的开放寻址哈希表，查找不加锁；编译结果进入缓存后一直保留（不淘汰），表满后不再缓存
+#pragma once
+#include "ComPlatform.h"
+#include <cstddef>
+
+class IExpression;
+
+namespace Expression
+{
+    const size_t kMaxVariables = 128;   // 一个表达式最多的变量数
+    const size_t kMaxTemporaries = 128; // 同时存活的中间结果数（约等于括号嵌套深度）
+    const size_t kCacheSlots = 1024;    // 缓存容量
+
+    // 编译 source，或从缓存取出已经编译好的；返回的句柄带一个引用
+    // 语法错误、除数为常数 0、变量过多返回 E_INVALIDARG
+    HRESULT Compile(const char* source, IExpression** ppExpr);
+
+    // 查缓存（必要时编译）并求值
+    HRESULT Evaluate(const char* source, const int* vars, size_t count, int* result);
+
+    // 缓存中的表达式数
+    size_t CachedCount();
+}
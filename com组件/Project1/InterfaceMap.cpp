@@ -0,0 +1,128 @@
+// InterfaceMap.cpp - 表驱动的 QueryInterface 实现
+#include "InterfaceMap.h"
+#include "ComLog.h"
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#define INTERFACE_MAP_SSE2 1
+#else
+#define INTERFACE_MAP_SSE2 0
+#endif
+
+bool GuidEquals(REFGUID a, REFGUID b)
+{
+    static_assert(sizeof(GUID) == 16, "GUID must be 16 bytes");
+#if INTERFACE_MAP_SSE2
+    __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&a));
+    __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&b));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) == 0xFFFF;
+#else
+    uint64_t a0, a1, b0, b1;
+    std::memcpy(&a0, &a, 8);
+    std::memcpy(&a1, reinterpret_cast<const char*>(&a) + 8, 8);
+    std::memcpy(&b0, &b, 8);
+    std::memcpy(&b1, reinterpret_cast<const char*>(&b) + 8, 8);
+    return ((a0 ^ b0) | (a1 ^ b1)) == 0;
+#endif
+}
+
+// 哈希只用 IID 的第一个 32 位字（Data1）：各个接口的 IID 在这里几乎总是不同的；
+// 表中有两个 IID 的 Data1 相同时找不到完美哈希，这张表退回按顺序查找
+static inline uint32_t GuidFold(REFGUID g)
+{
+    uint32_t data1;
+    std::memcpy(&data1, &g, 4);
+    return data1;
+}
+
+// 找一个乘数，使表中每个 IID 落在不同的槽（槽数从表项数的两倍开始试）
+void InterfaceMap::BuildProbe() const
+{
+    uint8_t expected = Probe_None;
+    if (!m_probe.compare_exchange_strong(expected, Probe_Building, std::memory_order_acquire)) return;
+
+    uint32_t bits = 1;
+    while ((1u << bits) < m_count * 2) ++bits;
+    for (; bits <= kMaxSlotBits; ++bits)
+    {
+        for (uint32_t k = 0; k < 256; ++k)
+        {
+            uint32_t multiplier = 0x9E3779B1u + 2 * k;  // 奇数
+            uint32_t shift = 32 - bits;
+            std::memset(m_slots, 0, sizeof(m_slots));
+            bool perfect = true;
+            for (uint32_t i = 0; i < m_count && perfect; ++i)
+            {
+                uint8_t& slot = m_slots[(GuidFold(*m_entries[i].piid) * multiplier) >> shift];
+                perfect = slot == 0;
+                slot = (uint8_t)(i + 1);
+            }
+            if (perfect)
+            {
+                m_multiplier = multiplier;
+                m_shift = shift;
+                m_probe.store(Probe_Ready, std::memory_order_release);
+                return;
+            }
+        }
+    }
+    m_probe.store(Probe_Linear, std::memory_order_release);
+}
+
+const InterfaceEntry* InterfaceMap::LinearLookup(REFIID riid) const
+{
+    for (uint32_t i = 0; i < m_count; ++i)
+    {
+        if (GuidEquals(*m_entries[i].piid, riid)) return &m_entries[i];
+    }
+    return nullptr;
+}
+
+const InterfaceEntry* InterfaceMap::Lookup(REFIID riid) const
+{
+    uint8_t probe = m_probe.load(std::memory_order_acquire);
+    if (probe == Probe_Ready)
+    {
+        uint8_t slot = m_slots[(GuidFold(riid) * m_multiplier) >> m_shift];
+        if (slot == 0) return nullptr;
+        const InterfaceEntry* entry = &m_entries[slot - 1];
+        return GuidEquals(*entry->piid, riid) ? entry : nullptr;
+    }
+    if (probe == Probe_None) BuildProbe();  // 表项太多时直接标记为按顺序查找
+    return LinearLookup(riid);  // 建表期间或者建表失败
+}
+
+HRESULT InterfaceMap::Query(void* pThis, REFIID riid, void** ppvObject) const
+{
+    if (!ppvObject) return E_POINTER;  // 参数检查
+    *ppvObject = nullptr;
+
+    const InterfaceEntry* entry = Lookup(riid);
+    if (!entry)  // 不支持的接口
+    {
+        COM_LOG_TRACE("{} QueryInterface -> E_NOINTERFACE", m_tag);
+        return E_NOINTERFACE;
+    }
+
+    IUnknown* pUnk = static_cast<IUnknown*>(entry->cast(pThis));
+    if (entry->tearOff)
+    {
+        // 新建的 tear-off 对象引用计数已经是 1，不再 AddRef
+        if (!pUnk) return E_OUTOFMEMORY;
+        COM_LOG_TRACE("{} QueryInterface -> {} (tear-off)", m_tag, entry->name);
+        *ppvObject = pUnk;
+        return S_OK;
+    }
+    COM_LOG_TRACE("{} QueryInterface -> {}", m_tag, entry->name);
+
+    pUnk->AddRef();  // 成功返回接口，增加引用计数
+    *ppvObject = pUnk;
+    return S_OK;
+}
+
+void* InterfaceMap::Find(void* pThis, REFIID riid) const
+{
+    const InterfaceEntry* entry = Lookup(riid);
+    return entry && !entry->tearOff ? entry->cast(pThis) : nullptr;
+}
@@ -0,0 +1,115 @@
+// InterfaceMap.h - 表驱动的 QueryInterface
+// =====================================================
+// 每个类用一张编译期常量表描述自己支持的接口，QueryInterface 只需要查表：
+//
+//   static constexpr InterfaceEntry s_entries[] =
+//   {
+//       COM_INTERFACE_ENTRY(Calculator, ICalculator),             // 最常请求的接口放在最前面
+//       COM_INTERFACE_ENTRY2(Calculator, IUnknown, ICalculator),  // IUnknown 经由 ICalculator 分支
+//   };
+//   static InterfaceMap s_map("[Calculator]", s_entries);
+//
+//   HRESULT Calculator::QueryInterface(REFIID riid, void** ppv)
+//   {
+//       return s_map.Query(this, riid, ppv);
+//   }
+//
+// 新增接口只需要在表里加一行；很少用的接口可以写成 COM_INTERFACE_ENTRY_TEAR_OFF，
+// 请求时才创建辅助对象，不占每个实例的虚表指针（见 TearOff.h）
+//
+// 查找方式：
+//   - 表项中的 cast 函数就是一次 static_cast（编译后只是 this 加一个常量偏移）
+//   - GUID 比较用一条 16 字节 SIMD 比较指令完成
+//   - 按 IID 第一个 32 位字的哈希直接定位表项（完美哈希：表中每个 IID 占一个不同的槽），命中和不支持的接口
+//     都只比较一次，查找时间与接口数量无关
+//   - 哈希表在第一次查找时建好（Windows SDK 的 IID 定义在 uuid.lib 里，不是编译期常量），之后只读，
+//     多个线程同时 QueryInterface 不会互相写同一条缓存行；建表完成之前按表中顺序查找
+#pragma once
+#include "ComPlatform.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+struct InterfaceEntry
+{
+    const IID*  piid;
+    void*     (*cast)(void* pThis);  // 对象指针 → 接口指针
+    const char* name;                // 日志用
+    bool        tearOff;             // cast 新建一个 tear-off 对象（引用计数已为 1，失败时返回 nullptr）
+};
+
+// 把 Class* 转成 Itf*（多重继承时编译器自动加上正确的偏移）
+template <class Class, class Itf>
+void* InterfaceCast(void* pThis)
+{
+    return static_cast<Itf*>(static_cast<Class*>(pThis));
+}
+
+// 普通接口：IID_<Itf>
+#define COM_INTERFACE_ENTRY(Class, Itf) \
+    InterfaceEntry{ &IID_##Itf, &InterfaceCast<Class, Itf>, #Itf, false }
+
+// 有多条继承路径的接口（如 IUnknown）：指定经由哪个分支转换
+#define COM_INTERFACE_ENTRY2(Class, Itf, Branch) \
+    InterfaceEntry{ &IID_##Itf, &InterfaceCast<Class, Branch>, #Itf, false }
+
+// 新建 Class 的 tear-off 对象 TearOffClass，返回它的 Itf 接口
+template <class Class, class Itf, class TearOffClass>
+void* TearOffCreate(void* pThis)
+{
+    TearOffClass* p = new (std::nothrow) TearOffClass(static_cast<Class*>(pThis));
+    return p ? static_cast<Itf*>(p) : nullptr;
+}
+
+// tear-off 接口：请求时才创建 TearOffClass 对象
+#define COM_INTERFACE_ENTRY_TEAR_OFF(Class, Itf, TearOffClass) \
+    InterfaceEntry{ &IID_##Itf, &TearOffCreate<Class, Itf, TearOffClass>, #Itf, true }
+
+// 16 字节 GUID 比较
+bool GuidEquals(REFGUID a, REFGUID b);
+
+class InterfaceMap
+{
+private:
+    static const uint32_t kMaxSlotBits = 6;  // 哈希表最多 64 个槽；接口更多或找不到完美哈希时按顺序查找
+
+    enum : uint8_t
+    {
+        Probe_None,      // 还没有建表
+        Probe_Building,  // 某个线程正在建表
+        Probe_Ready,     // 按哈希查找
+        Probe_Linear,    // 建表失败，一直按顺序查找
+    };
+
+    const char*                  m_tag;      // 日志前缀，例如 "[Calculator]"
+    const InterfaceEntry*        m_entries;
+    uint32_t                     m_count;
+    mutable uint32_t             m_multiplier = 0;
+    mutable uint32_t             m_shift = 0;
+    mutable uint8_t              m_slots[1u << kMaxSlotBits] = {};  // 表项下标 + 1，0 表示空槽
+    mutable std::atomic<uint8_t> m_probe{ Probe_None };
+
+public:
+    template <size_t N>
+    constexpr InterfaceMap(const char* tag, const InterfaceEntry (&entries)[N])
+        : m_tag(tag)
+        , m_entries(entries)
+        , m_count((uint32_t)N)
+    {
+    }
+
+    InterfaceMap(const InterfaceMap&) = delete;
+    InterfaceMap& operator=(const InterfaceMap&) = delete;
+
+    // 标准 QueryInterface：成功时通过返回的接口 AddRef；tear-off 接口创建失败时返回 E_OUTOFMEMORY
+    HRESULT Query(void* pThis, REFIID riid, void** ppvObject) const;
+
+    // 只查表，不 AddRef；不支持时返回 nullptr（tear-off 接口不创建对象，也返回 nullptr）
+    void* Find(void* pThis, REFIID riid) const;
+
+private:
+    const InterfaceEntry* Lookup(REFIID riid) const;
+    const InterfaceEntry* LinearLookup(REFIID riid) const;
+    void BuildProbe() const;
+};
@@ -0,0 +1,503 @@
+// LocalServer.cpp - 进程外服务器：共享内存环形队列 + 客户端代理
+#include "LocalServer.h"
+#include "StandardCOM.h"
+#include "ComLog.h"
+#include "InterfaceMap.h"
+#include <cstdio>
+
+#ifdef _WIN32
+
+LocalServer::LocalServer() : m_shared(nullptr), m_calc(nullptr), m_served(0), m_name() {}
+LocalServer::~LocalServer() {}
+HRESULT LocalServer::Start(REFCLSID) { return E_NOTIMPL; }
+void LocalServer::Run() {}
+void LocalServer::Stop() {}
+
+HRESULT CreateLocalInstance(REFCLSID, REFIID, void** ppv)
+{
+    if (ppv) *ppv = nullptr;
+    return E_NOTIMPL;
+}
+
+#else  // !_WIN32
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <ctime>
+#include <new>
+#include <thread>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#define CPU_RELAX() _mm_pause()
+#else
+#define CPU_RELAX() sched_yield()
+#endif
+
+namespace
+{
+    const uint32_t kMagic = 0x43414C43;  // "CALC"：服务器初始化完成后才写入
+    const uint32_t kVersion = 2;
+    const uint32_t kRingSize = 256;      // 槽位数（2 的幂）
+
+    // 槽位的完成状态，也是客户端睡眠用的 futex 字
+    enum : uint32_t
+    {
+        kPending = 0,  // 已提交，服务器还没处理完
+        kDone    = 1,  // 结果已写入
+        kWaiting = 2,  // 客户端在 futex 上睡眠，完成时需要唤醒
+    };
+
+    // 一个槽位占一整条缓存行，不同客户端的调用互不干扰
+    struct alignas(64) Slot
+    {
+        // Vyukov 式序号：== pos 空闲可写；== pos + 1 已提交；== pos + kRingSize 已归还
+        std::atomic<uint64_t> seq;
+        std::atomic<uint64_t> owner;  // OwnerTag(pos, 领取者 pid)；pid 为 0 表示领取者还没写入
+        std::atomic<uint32_t> state;
+        uint32_t              op;  // AsyncOp
+        int32_t               a;
+        int32_t               b;
+        int32_t               result;
+        HRESULT               hr;
+    };
+
+    // 只依赖进程内的 futex 和原子操作在共享内存上同样有效
+    static_assert(std::atomic<uint32_t>::is_always_lock_free, "futex word must be lock-free");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "ring sequence must be lock-free");
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex word must be 32 bits");
+
+    // 多核时先忙等再睡眠；单核上忙等只会占住对方需要的 CPU
+    const unsigned s_spinCount = std::thread::hardware_concurrency() > 1 ? 4000 : 0;
+
+    // 跨进程的 futex（不能用 FUTEX_PRIVATE_FLAG）
+    void FutexWait(std::atomic<uint32_t>& word, uint32_t expected, long timeoutMs)
+    {
+        timespec ts = { timeoutMs / 1000, (timeoutMs % 1000) * 1000000L };
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected, &ts, nullptr, 0);
+    }
+
+    void FutexWake(std::atomic<uint32_t>& word, int count)
+    {
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, count, nullptr, nullptr, 0);
+    }
+
+    const long kWaitSliceMs = 100;  // 睡眠的最长时间，醒来后检查服务器是否还在
+    const long kClaimTimeoutMs = 1000;  // 领取了槽位却迟迟不写入 pid 的客户端，当作已经退出
+
+    // 高 32 位是位置，低 32 位是 pid：服务器跳过或回收槽位后，迟到的客户端按旧位置做的 CAS 必然失败
+    uint64_t OwnerTag(uint64_t pos, pid_t pid)
+    {
+        return (pos << 32) | static_cast<uint32_t>(pid);
+    }
+
+    bool ProcessGone(pid_t pid)
+    {
+        return kill(pid, 0) != 0 && errno == ESRCH;
+    }
+
+    // 共享内存名："/com.{GUID}"
+    void ShmName(REFCLSID clsid, char* name, size_t size)
+    {
+        snprintf(name, size, "/com.%08X-%04X-%04X-%02X%02X-%02X%02X%02X%02X%02X%02X",
+            clsid.Data1, clsid.Data2, clsid.Data3,
+            clsid.Data4[0], clsid.Data4[1], clsid.Data4[2], clsid.Data4[3],
+            clsid.Data4[4], clsid.Data4[5], clsid.Data4[6], clsid.Data4[7]);
+    }
+}
+
+struct LocalServerShared
+{
+    std::atomic<uint32_t> magic;
+    uint32_t              version;
+    pid_t                 serverPid;
+
+    alignas(64) std::atomic<uint64_t> enqueuePos;      // 客户端领取槽位（fetch_add）
+    alignas(64) std::atomic<uint32_t> serverWake;      // 服务器睡眠用的 futex 字
+    std::atomic<uint32_t>             serverSleeping;  // 服务器是否在（或即将）睡眠
+    std::atomic<uint32_t>             stop;
+
+    Slot slots[kRingSize];
+};
+
+// 服务器是否还活着（进程退出、或者已经 Stop）
+static bool ServerAlive(LocalServerShared* shared)
+{
+    if (shared->magic.load(std::memory_order_acquire) != kMagic) return false;
+    return kill(shared->serverPid, 0) == 0 || errno != ESRCH;
+}
+
+// 服务器在 pos 上等不到请求时检查是否有客户端中途退出：
+//   - 上一轮领取这个槽位的客户端没拿结果就退出了：替它归还，排队的客户端才能领取
+//   - 领取了 pos 的客户端在提交前退出了：跳过 pos，返回 true
+// pid 还没写入时无法判断，等满 kClaimTimeoutMs 再跳过；跳过与客户端写 pid 用同一个 CAS 决出先后
+static bool RecoverSlot(LocalServerShared& shared, uint64_t pos, std::chrono::steady_clock::time_point& ownerlessSince)
+{
+    Slot& slot = shared.slots[pos & (kRingSize - 1)];
+    uint64_t seq = slot.seq.load(std::memory_order_acquire);
+    uint64_t owner = slot.owner.load(std::memory_order_acquire);
+    pid_t pid = static_cast<pid_t>(owner & 0xFFFFFFFFu);
+
+    if (seq == pos - kRingSize + 1)
+    {
+        if (pid == 0 || owner != OwnerTag(pos - kRingSize, pid) || !ProcessGone(pid)) return false;
+        if (slot.owner.compare_exchange_strong(owner, OwnerTag(pos, 0), std::memory_order_acq_rel))
+        {
+            COM_LOG_WARN("[LocalServer] 客户端退出前没有归还槽位, 已回收: pid = {}", (long long)pid);
+            slot.seq.store(pos, std::memory_order_release);
+        }
+        return false;
+    }
+
+    if (seq != pos || shared.enqueuePos.load(std::memory_order_acquire) <= pos) return false;
+    if (owner != OwnerTag(pos, pid)) return false;
+    if (pid == 0)
+    {
+        auto now = std::chrono::steady_clock::now();
+        if (ownerlessSince == std::chrono::steady_clock::time_point()) ownerlessSince = now;
+        if (now - ownerlessSince < std::chrono::milliseconds(kClaimTimeoutMs)) return false;
+    }
+    else if (!ProcessGone(pid))
+    {
+        return false;
+    }
+    if (!slot.owner.compare_exchange_strong(owner, OwnerTag(pos + kRingSize, 0), std::memory_order_acq_rel))
+        return false;
+
+    COM_LOG_WARN("[LocalServer] 客户端提交前退出, 跳过槽位: pid = {}", (long long)pid);
+    slot.seq.store(pos + kRingSize, std::memory_order_release);
+    return true;
+}
+
+
+// ========================================
+// 服务器
+// ========================================
+
+LocalServer::LocalServer()
+    : m_shared(nullptr)
+    , m_calc(nullptr)
+    , m_served(0)
+    , m_name()
+{
+}
+
+LocalServer::~LocalServer()
+{
+    if (m_shared)
+    {
+        m_shared->magic.store(0, std::memory_order_release);  // 之后客户端的调用返回 RPC_E_DISCONNECTED
+        munmap(m_shared, sizeof(LocalServerShared));
+        shm_unlink(m_name);
+    }
+    if (m_calc) m_calc->Release();
+}
+
+HRESULT LocalServer::Start(REFCLSID rclsid)
+{
+    if (m_shared) return E_UNEXPECTED;
+
+    ComPtr<IClassFactory> pFactory;
+    HRESULT hr = DllGetClassObject(rclsid, IID_IClassFactory, (void**)pFactory.ReleaseAndGetAddressOf());
+    if (FAILED(hr)) return hr;
+    hr = pFactory->CreateInstance(nullptr, IID_ICalculator, (void**)&m_calc);
+    if (FAILED(hr)) return hr;
+
+    // 上一次没有正常退出的服务器可能留下了同名的共享内存
+    ShmName(rclsid, m_name, sizeof(m_name));
+    shm_unlink(m_name);
+
+    int fd = shm_open(m_name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0)
+    {
+        COM_LOG_ERROR("[LocalServer] shm_open 失败: errno = {}", errno);
+        return E_FAIL;
+    }
+    if (ftruncate(fd, sizeof(LocalServerShared)) != 0)
+    {
+        COM_LOG_ERROR("[LocalServer] ftruncate 失败: errno = {}", errno);
+        close(fd);
+        shm_unlink(m_name);
+        return E_FAIL;
+    }
+    void* p = mmap(nullptr, sizeof(LocalServerShared), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+    {
+        shm_unlink(m_name);
+        return E_OUTOFMEMORY;
+    }
+
+    // 新建的共享内存全是 0；原子对象在这里构造，其余字段逐个初始化
+    m_shared = new (p) LocalServerShared();
+    m_shared->version = kVersion;
+    m_shared->serverPid = getpid();
+    for (uint32_t i = 0; i < kRingSize; ++i)
+    {
+        m_shared->slots[i].seq.store(i, std::memory_order_relaxed);
+        m_shared->slots[i].owner.store(OwnerTag(i, 0), std::memory_order_relaxed);
+    }
+    m_shared->magic.store(kMagic, std::memory_order_release);  // 最后发布：客户端看到 magic 才连接
+
+    COM_LOG_DEBUG("[LocalServer] 开始服务: pid = {}", (long long)m_shared->serverPid);  // 日志只能引用静态字符串，不输出共享内存名
+    return S_OK;
+}
+
+void LocalServer::Run()
+{
+    if (!m_shared) return;
+    LocalServerShared& shared = *m_shared;
+
+    uint64_t pos = 0;  // 下一个要处理的槽位（只有服务器自己用）
+    std::chrono::steady_clock::time_point ownerlessSince;  // pos 被领取但还没有 pid 的起始时间
+    while (!shared.stop.load(std::memory_order_acquire))
+    {
+        Slot& slot = shared.slots[pos & (kRingSize - 1)];
+
+        // 等待下一个请求：先忙等，再睡眠
+        bool ready = false;
+        for (unsigned i = 0; i <= s_spinCount; ++i)
+        {
+            if (slot.seq.load(std::memory_order_acquire) == pos + 1)
+            {
+                ready = true;
+                break;
+            }
+            CPU_RELAX();
+        }
+        if (!ready)
+        {
+            // 先登记睡眠再检查一次；客户端先发布槽位再看登记（两边都是 seq_cst），不会漏唤醒
+            uint32_t wake = shared.serverWake.load(std::memory_order_seq_cst);
+            shared.serverSleeping.store(1, std::memory_order_seq_cst);
+            if (slot.seq.load(std::memory_order_seq_cst) != pos + 1 &&
+                !shared.stop.load(std::memory_order_seq_cst))
+                FutexWait(shared.serverWake, wake, kWaitSliceMs);
+            shared.serverSleeping.store(0, std::memory_order_relaxed);
+
+            if (RecoverSlot(shared, pos, ownerlessSince))
+            {
+                ++pos;
+                ownerlessSince = std::chrono::steady_clock::time_point();
+            }
+            continue;
+        }
+
+        // 参数在槽位里，结果直接写回槽位
+        switch (slot.op)
+        {
+        case AsyncOp_Add:      slot.hr = m_calc->Add(slot.a, slot.b, &slot.result); break;
+        case AsyncOp_Subtract: slot.hr = m_calc->Subtract(slot.a, slot.b, &slot.result); break;
+        case AsyncOp_Multiply: slot.hr = m_calc->Multiply(slot.a, slot.b, &slot.result); break;
+        case AsyncOp_Divide:   slot.hr = m_calc->Divide(slot.a, slot.b, &slot.result); break;
+        default:               slot.hr = E_INVALIDARG; break;
+        }
+
+        if (slot.state.exchange(kDone, std::memory_order_acq_rel) == kWaiting)
+            FutexWake(slot.state, INT_MAX);
+        ++pos;
+        ++m_served;
+        ownerlessSince = std::chrono::steady_clock::time_point();
+    }
+
+    COM_LOG_DEBUG("[LocalServer] 停止服务, 共处理 {} 次调用", m_served);
+}
+
+void LocalServer::Stop()
+{
+    if (!m_shared) return;
+    m_shared->stop.store(1, std::memory_order_seq_cst);
+    m_shared->serverWake.fetch_add(1, std::memory_order_seq_cst);
+    FutexWake(m_shared->serverWake, 1);
+}
+
+
+// ========================================
+// 客户端代理
+// ========================================
+
+namespace
+{
+    class CalculatorProxy final : public ICalculator
+    {
+    private:
+        RefCount           m_refCount;
+        LocalServerShared* m_shared;
+        pid_t              m_pid;  // 写入槽位的领取者（getpid 每次都是系统调用，创建时取一次）
+
+    public:
+        explicit CalculatorProxy(LocalServerShared* shared) : m_refCount(1), m_shared(shared), m_pid(getpid()) {}
+
+        ~CalculatorProxy()
+        {
+            munmap(m_shared, sizeof(LocalServerShared));
+        }
+
+        // IUnknown 接口
+        virtual HRESULT __stdcall QueryInterface(REFIID riid, void** ppvObject) override;
+
+        virtual ULONG __stdcall AddRef() override
+        {
+            return m_refCount.Increment();
+        }
+
+        virtual ULONG __stdcall Release() override
+        {
+            ULONG count = m_refCount.Decrement();
+            if (count == 0) delete this;
+            return count;
+        }
+
+        // ICalculator 接口：每次调用是一次往返
+        virtual HRESULT __stdcall Add(int a, int b, int* result) override { return Call(AsyncOp_Add, a, b, result); }
+        virtual HRESULT __stdcall Subtract(int a, int b, int* result) override { return Call(AsyncOp_Subtract, a, b, result); }
+        virtual HRESULT __stdcall Multiply(int a, int b, int* result) override { return Call(AsyncOp_Multiply, a, b, result); }
+        virtual HRESULT __stdcall Divide(int a, int b, int* result) override { return Call(AsyncOp_Divide, a, b, result); }
+
+    private:
+        HRESULT Call(AsyncOp op, int a, int b, int* result);
+    };
+
+    static constexpr InterfaceEntry s_proxyInterfaces[] =
+    {
+        COM_INTERFACE_ENTRY(CalculatorProxy, ICalculator),
+        COM_INTERFACE_ENTRY2(CalculatorProxy, IUnknown, ICalculator),
+    };
+    static constinit InterfaceMap s_proxyMap("[CalculatorProxy]", s_proxyInterfaces);
+
+    HRESULT __stdcall CalculatorProxy::QueryInterface(REFIID riid, void** ppvObject)
+    {
+        return s_proxyMap.Query(this, riid, ppvObject);
+    }
+
+    HRESULT CalculatorProxy::Call(AsyncOp op, int a, int b, int* result)
+    {
+        if (!result) return E_POINTER;
+        LocalServerShared& shared = *m_shared;
+        if (shared.magic.load(std::memory_order_acquire) != kMagic) return RPC_E_DISCONNECTED;
+
+        // 只领取已经空出来的槽位，领取后马上写入 pid；队列满时（同一槽位的上一次调用还没归还）等它空出来
+        // pid 写不进去说明服务器当作我们已经退出、跳过了这个位置，重新领取
+        uint64_t pos = shared.enqueuePos.load(std::memory_order_relaxed);
+        for (unsigned i = 0;; ++i)
+        {
+            Slot& next = shared.slots[pos & (kRingSize - 1)];
+            int64_t diff = static_cast<int64_t>(next.seq.load(std::memory_order_acquire) - pos);
+            if (diff == 0)
+            {
+                if (shared.enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    uint64_t owner = OwnerTag(pos, 0);
+                    if (next.owner.compare_exchange_strong(owner, OwnerTag(pos, m_pid), std::memory_order_acq_rel))
+                        break;
+                    pos = shared.enqueuePos.load(std::memory_order_relaxed);
+                }
+                continue;
+            }
+            if (diff < 0)
+            {
+                if (i < s_spinCount) CPU_RELAX();
+                else sched_yield();
+                if ((i & 1023) == 1023 && !ServerAlive(m_shared)) return RPC_E_DISCONNECTED;
+            }
+            pos = shared.enqueuePos.load(std::memory_order_relaxed);
+        }
+        Slot& slot = shared.slots[pos & (kRingSize - 1)];
+
+        slot.state.store(kPending, std::memory_order_relaxed);
+        slot.op = op;
+        slot.a = a;
+        slot.b = b;
+        slot.seq.store(pos + 1, std::memory_order_seq_cst);  // 提交
+
+        // 服务器在睡眠才唤醒（与服务器睡眠前的检查配对）
+        if (shared.serverSleeping.load(std::memory_order_seq_cst))
+        {
+            shared.serverWake.fetch_add(1, std::memory_order_seq_cst);
+            FutexWake(shared.serverWake, 1);
+        }
+
+        // 等待结果：先忙等，再登记 kWaiting 在 futex 上睡眠
+        uint32_t s = kPending;
+        for (unsigned i = 0; i < s_spinCount; ++i)
+        {
+            s = slot.state.load(std::memory_order_acquire);
+            if (s == kDone) break;
+            CPU_RELAX();
+        }
+        if (s != kDone)
+        {
+            uint32_t expected = kPending;
+            if (slot.state.compare_exchange_strong(expected, kWaiting, std::memory_order_acquire))
+                expected = kWaiting;
+            while (expected != kDone)
+            {
+                FutexWait(slot.state, kWaiting, kWaitSliceMs);
+                expected = slot.state.load(std::memory_order_acquire);
+                // 服务器已经退出：不归还槽位（连接已经不能再用）
+                if (expected != kDone && !ServerAlive(m_shared)) return RPC_E_DISCONNECTED;
+            }
+        }
+
+        *result = slot.result;
+        HRESULT hr = slot.hr;
+        slot.owner.store(OwnerTag(pos + kRingSize, 0), std::memory_order_relaxed);
+        slot.seq.store(pos + kRingSize, std::memory_order_release);  // 归还槽位
+        return hr;
+    }
+}
+
+HRESULT CreateLocalInstance(REFCLSID rclsid, REFIID riid, void** ppv)
+{
+    if (!ppv) return E_POINTER;
+    *ppv = nullptr;
+
+    char name[64];
+    ShmName(rclsid, name, sizeof(name));
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) return CLASS_E_CLASSNOTAVAILABLE;  // 没有服务器在运行
+
+    // 服务器可能刚创建还没设置大小，这时映射后访问会 SIGBUS
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(LocalServerShared))
+    {
+        close(fd);
+        return CLASS_E_CLASSNOTAVAILABLE;
+    }
+
+    void* p = mmap(nullptr, sizeof(LocalServerShared), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return CLASS_E_CLASSNOTAVAILABLE;
+
+    LocalServerShared* shared = static_cast<LocalServerShared*>(p);
+    if (!ServerAlive(shared) || shared->version != kVersion)
+    {
+        munmap(p, sizeof(LocalServerShared));
+        return CLASS_E_CLASSNOTAVAILABLE;
+    }
+
+    long long serverPid = shared->serverPid;  // 代理失败时会解除映射，先取出来供日志用
+    CalculatorProxy* proxy = new (std::nothrow) CalculatorProxy(shared);
+    if (!proxy)
+    {
+        munmap(p, sizeof(LocalServerShared));
+        return E_OUTOFMEMORY;
+    }
+    HRESULT hr = proxy->QueryInterface(riid, ppv);
+    proxy->Release();  // 成功时 QueryInterface 已经 AddRef；失败时销毁代理
+    COM_LOG_DEBUG("[LocalServer] 连接服务器: pid = {}", serverPid);
+    (void)serverPid;
+    return hr;
+}
+
+#endif  // _WIN32
@@ -0,0 +1,57 @@
+// LocalServer.h - 进程外服务器（本地服务器）
+// =====================================================
+// 一个宿主进程（CalcServer）提供 CLSID_Calculator，其他进程通过代理对象调用：
+//
+//   客户进程                                 服务器进程
+//   ICalculator* p;                           LocalServer server;
+//   CreateLocalInstance(CLSID_Calculator,     server.Start(CLSID_Calculator);
+//       IID_ICalculator, (void**)&p);         server.Run();   // 直到 Stop()
+//   p->Add(1, 2, &r);  ──── 共享内存 ────→    Calculator::Add
+//
+// 通道是一段 POSIX 共享内存（名字由 CLSID 生成），里面是一个多生产者/单消费者的环形队列：
+//   - 客户端（可以是多个进程、多个线程）领取一个槽位，把参数直接写进槽位
+//   - 服务器按顺序处理，结果也直接写回同一个槽位，客户端读出后归还槽位
+//     参数和结果除了槽位本身不做任何拷贝，也没有序列化
+//   - 等待方先忙等一小段（多核时），再在 futex 上睡眠；只有对方确实在睡眠时才发唤醒的系统调用
+//   - 槽位里记着领取者的 pid：客户端在调用中途退出时，服务器替它跳过或归还槽位，队列不会卡住
+//
+// 只在 Linux 上实现；Windows 上请使用系统的进程外 COM（CoCreateInstance + CLSCTX_LOCAL_SERVER），
+// 这里的函数返回 E_NOTIMPL
+#pragma once
+#include "ComPlatform.h"
+#include <cstddef>
+#include <cstdint>
+
+struct LocalServerShared;  // 共享内存的布局，定义在 LocalServer.cpp
+class ICalculator;
+
+class LocalServer
+{
+private:
+    LocalServerShared* m_shared;
+    ICalculator*       m_calc;
+    uint64_t           m_served;    // 已处理的调用数
+    char               m_name[64];  // 共享内存名
+
+public:
+    LocalServer();
+    ~LocalServer();  // 断开所有客户端并删除共享内存
+
+    LocalServer(const LocalServer&) = delete;
+    LocalServer& operator=(const LocalServer&) = delete;
+
+    // 创建共享内存并通过 DllGetClassObject 创建对象；之后客户端就可以连接
+    HRESULT Start(REFCLSID rclsid);
+
+    // 在当前线程上处理请求，直到 Stop()
+    void Run();
+
+    // 可以在任意线程或信号处理函数中调用
+    void Stop();
+
+    uint64_t Served() const { return m_served; }
+};
+
+// 连接本机上提供 rclsid 的服务器进程，返回代理对象的接口（目前只支持 IID_ICalculator/IID_IUnknown）
+// 服务器不存在时返回 CLASS_E_CLASSNOTAVAILABLE；服务器退出后代理上的调用返回 RPC_E_DISCONNECTED
+HRESULT CreateLocalInstance(REFCLSID rclsid, REFIID riid, void** ppv);
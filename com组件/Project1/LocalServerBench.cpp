@@ -0,0 +1,107 @@
+// LocalServerBench.cpp - 进程外调用的往返延迟测试
+// =====================================================
+// 独立的测试程序（有自己的 main，已在项目中排除编译；只在 Linux 上可用）
+// fork 出一个子进程运行 LocalServer，父进程通过代理逐次调用 ICalculator::Add，
+// 测量每次往返的延迟分布，并和进程内对象的同一调用对照
+//
+// 单核机器上不忙等，每次往返都包含两次 futex 唤醒和进程切换，延迟会高一到两个数量级
+//
+// Linux 编译：在仓库根目录 make（生成 build/LocalServerBench）
+#include "StandardCOM.h"
+#include "LocalServer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+static const int kWarmup = 10000;
+static const int kCalls = 200000;
+
+// 每次调用单独计时（纳秒）
+static void Measure(const char* name, ICalculator* p)
+{
+    vector<double> ns(kCalls);
+    int r = 0;
+    long long sum = 0;
+    for (int i = 0; i < kWarmup; ++i) p->Add(i, 1, &r);
+
+    for (int i = 0; i < kCalls; ++i)
+    {
+        auto begin = chrono::steady_clock::now();
+        p->Add(i, 1, &r);
+        auto end = chrono::steady_clock::now();
+        ns[i] = chrono::duration<double, nano>(end - begin).count();
+        sum += r;
+    }
+    if (sum != (long long)kCalls * (kCalls + 1) / 2) printf("  %s: 结果错误！\n", name);
+
+    sort(ns.begin(), ns.end());
+    double total = 0;
+    for (double x : ns) total += x;
+    auto pct = [&](double q) { return ns[(size_t)(q * (kCalls - 1))]; };
+    printf("%-12s %10.0f %10.0f %10.0f %10.0f %10.0f\n",
+        name, total / kCalls, pct(0.5), pct(0.99), pct(0.999), ns.back());
+}
+
+int main()
+{
+    pid_t child = fork();
+    if (child < 0)
+    {
+        perror("fork");
+        return 1;
+    }
+    if (child == 0)
+    {
+        // 服务器进程：父进程用 SIGTERM 结束它
+        static LocalServer server;
+        if (FAILED(server.Start(CLSID_Calculator))) _exit(1);
+        signal(SIGTERM, [](int) { server.Stop(); });
+        server.Run();
+        _exit(0);
+    }
+
+    // 等服务器就绪
+    ICalculator* pRemote = nullptr;
+    for (int i = 0; i < 500; ++i)
+    {
+        if (SUCCEEDED(CreateLocalInstance(CLSID_Calculator, IID_ICalculator, (void**)&pRemote))) break;
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    if (!pRemote)
+    {
+        fprintf(stderr, "连接服务器失败\n");
+        kill(child, SIGTERM);
+        waitpid(child, nullptr, 0);
+        return 1;
+    }
+
+    IClassFactory* pFactory = nullptr;
+    ICalculator* pLocal = nullptr;
+    DllGetClassObject(CLSID_Calculator, IID_IClassFactory, (void**)&pFactory);
+    pFactory->CreateInstance(nullptr, IID_ICalculator, (void**)&pLocal);
+
+    printf("ICalculator::Add 往返延迟（ns，%d 次调用，%u 个 CPU）\n",
+        kCalls, thread::hardware_concurrency());
+    printf("%-12s %10s %10s %10s %10s %10s\n", "", "mean", "p50", "p99", "p99.9", "max");
+    Measure("进程内", pLocal);
+    Measure("进程外", pRemote);
+
+    // 服务器退出后代理上的调用返回错误，而不是挂起
+    kill(child, SIGTERM);
+    waitpid(child, nullptr, 0);
+    int r = 0;
+    HRESULT hr = pRemote->Add(1, 2, &r);
+    printf("\n服务器退出后调用: %s\n", hr == RPC_E_DISCONNECTED ? "RPC_E_DISCONNECTED" : "意外结果");
+
+    pRemote->Release();
+    pLocal->Release();
+    pFactory->Release();
+    return 0;
+}
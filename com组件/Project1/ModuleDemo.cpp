@@ -0,0 +1,134 @@
+// ModuleDemo.cpp - 动态加载组件模块
+// =====================================================
+// 独立的演示程序（有自己的 main，已在项目中排除编译）
+// 本程序不链接 Calculator 的实现，只通过 ModuleLoader 从 libCalculator.so 中使用它：
+//   1. 登记 CLSID → 模块路径（不加载）
+//   2. 第一次创建对象时才加载模块
+//   3. 对象/锁存在时 FreeUnusedLibraries 不会卸载模块，全部释放后才卸载
+//   4. 再次使用时重新加载
+//   5. 热替换：切换到新版本的模块，旧对象继续运行旧代码，全部释放后旧模块被回收
+//
+// Linux 编译：在仓库根目录 make（生成 build/ModuleDemo、build/libCalculator.so 和
+// 模拟新版本的 build/libCalculator.v2.so）
+//   build/ModuleDemo [模块路径] [新版本模块路径]
+#include "StandardCOM.h"
+#include "ModuleLoader.h"
+#include <chrono>
+#include <cstdio>
+#include <dlfcn.h>
+
+using namespace std;
+
+static double NsPerCall(chrono::steady_clock::time_point begin, int n)
+{
+    return chrono::duration<double, nano>(chrono::steady_clock::now() - begin).count() / n;
+}
+
+static void ShowLoaded(const char* when)
+{
+    printf("%s 模块%s\n", when, ModuleLoader::IsLoaded(CLSID_Calculator) ? "已加载" : "未加载");
+}
+
+// 对象的代码在哪个模块里（看虚函数表的地址）
+static const char* ModuleOf(IUnknown* p)
+{
+    Dl_info info;
+    if (!dladdr(*reinterpret_cast<void**>(p), &info) || !info.dli_fname) return "?";
+    const char* name = info.dli_fname;
+    for (const char* s = name; *s; ++s)
+    {
+        if (*s == '/') name = s + 1;
+    }
+    return name;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* path = argc > 1 ? argv[1] : "build/libCalculator.so";
+    const char* path2 = argc > 2 ? argv[2] : "build/libCalculator.v2.so";
+    ModuleLoader::Register(CLSID_Calculator, path);
+    ShowLoaded("登记之后:");
+
+    // 第一次使用：加载模块
+    auto begin = chrono::steady_clock::now();
+    ICalculator* pCalc = nullptr;
+    HRESULT hr = ModuleLoader::CreateInstance(CLSID_Calculator, nullptr, IID_ICalculator, (void**)&pCalc);
+    double firstNs = NsPerCall(begin, 1);
+    if (FAILED(hr))
+    {
+        fprintf(stderr, "创建对象失败: 0x%08X（模块路径 %s）\n", (unsigned)hr, path);
+        return 1;
+    }
+    ShowLoaded("创建对象之后:");
+
+    int r = 0;
+    pCalc->Add(100, 50, &r);
+    printf("Add(100, 50) = %d\n", r);
+
+    // 之后的请求走缓存：不加锁、不查符号
+    const int n = 100000;
+    begin = chrono::steady_clock::now();
+    for (int i = 0; i < n; ++i)
+    {
+        IClassFactory* pFactory = nullptr;
+        ModuleLoader::GetClassObject(CLSID_Calculator, IID_IClassFactory, (void**)&pFactory);
+        pFactory->Release();
+    }
+    printf("首次 CreateInstance（含加载）: %.0f ns，之后 GetClassObject: %.1f ns\n", firstNs, NsPerCall(begin, n));
+
+    printf("\n对象存在时卸载: %zu 个模块\n", ModuleLoader::FreeUnusedLibraries());
+
+    // LockServer 也会阻止卸载
+    IClassFactory* pFactory = nullptr;
+    ModuleLoader::GetClassObject(CLSID_Calculator, IID_IClassFactory, (void**)&pFactory);
+    pFactory->LockServer(TRUE);
+    pFactory->Release();
+    pCalc->Release();
+    printf("LockServer(TRUE) 时卸载: %zu 个模块\n", ModuleLoader::FreeUnusedLibraries());
+
+    ModuleLoader::GetClassObject(CLSID_Calculator, IID_IClassFactory, (void**)&pFactory);
+    pFactory->LockServer(FALSE);
+    pFactory->Release();
+    printf("全部释放后卸载: %zu 个模块\n", ModuleLoader::FreeUnusedLibraries());
+    ShowLoaded("卸载之后:");
+
+    // 再次使用：重新加载
+    hr = ModuleLoader::CreateInstance(CLSID_Calculator, nullptr, IID_ICalculator, (void**)&pCalc);
+    if (SUCCEEDED(hr))
+    {
+        pCalc->Multiply(6, 7, &r);
+        printf("\n重新加载后 Multiply(6, 7) = %d\n", r);
+        pCalc->Release();
+    }
+    ShowLoaded("再次创建之后:");
+
+    // 热替换
+    printf("\n热替换到 %s\n", path2);
+    ICalculator* pOld = nullptr;
+    ICalculator* pNew = nullptr;
+    ModuleLoader::CreateInstance(CLSID_Calculator, nullptr, IID_ICalculator, (void**)&pOld);
+    hr = ModuleLoader::Replace(CLSID_Calculator, path2);
+    if (FAILED(hr))
+    {
+        fprintf(stderr, "替换失败: 0x%08X\n", (unsigned)hr);
+        pOld->Release();
+        return 1;
+    }
+    ModuleLoader::CreateInstance(CLSID_Calculator, nullptr, IID_ICalculator, (void**)&pNew);
+    printf("替换前创建的对象: %s\n", ModuleOf(pOld));
+    printf("替换后创建的对象: %s\n", ModuleOf(pNew));
+
+    pOld->Add(1, 2, &r);
+    printf("旧对象仍然可用: Add(1, 2) = %d\n", r);
+    size_t freed = ModuleLoader::FreeUnusedLibraries();
+    printf("旧对象存在时回收: %zu 个模块（等待回收 %zu）\n", freed, ModuleLoader::RetiringCount());
+
+    pOld->Release();
+    freed = ModuleLoader::FreeUnusedLibraries();
+    printf("旧对象释放后回收: %zu 个模块（等待回收 %zu）\n", freed, ModuleLoader::RetiringCount());
+
+    pNew->Multiply(6, 7, &r);
+    printf("新对象: Multiply(6, 7) = %d\n", r);
+    pNew->Release();
+    return 0;
+}
@@ -0,0 +1,364 @@
+// ModuleLoader.cpp - 组件模块加载器实现
+#include "ModuleLoader.h"
+#include "ClassRegistry.h"
+#include "ComLog.h"
+#include "ComPtr.h"
+#include "Epoch.h"
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+#ifndef _WIN32
+#include <dlfcn.h>
+#endif
+
+namespace ModuleLoader
+{
+    namespace
+    {
+        typedef HRESULT (__stdcall *PfnGetClassObject)(REFCLSID rclsid, REFIID riid, void** ppv);
+        typedef HRESULT (__stdcall *PfnCanUnloadNow)();
+
+        const size_t kMaxPath = 260;
+
+        struct Module
+        {
+            char path[kMaxPath];
+
+            // 已加载时非空；请求方在 Epoch 临界区里不加锁读取
+            // 卸载/替换时先撤下，等所有可能拿到旧值的请求离开临界区后才关闭模块
+            std::atomic<PfnGetClassObject> getClassObject{ nullptr };
+
+            // 以下只在持有 s_lock 时访问
+            void*             handle = nullptr;
+            PfnCanUnloadNow   canUnloadNow = nullptr;
+            PfnGetClassObject savedFn = nullptr;  // 撤下期间保存，取消卸载时恢复
+            size_t            entries = 0;        // 指向本模块的 CLSID 数；为 0 表示已被替换下来
+            bool              retiring = false;   // 已撤下，等待回收
+            uint64_t          retireEpoch = 0;
+            Module*           next = nullptr;
+        };
+
+        // 以 CLSID 为键的开放寻址表（与 ClassRegistry 相同的哈希），只增不删
+        struct Entry
+        {
+            CLSID                 clsid;
+            std::atomic<Module*>  module;  // Replace 时原子替换
+            std::atomic<bool>     used;    // release 发布：读到 true 时 clsid/module 已写好
+        };
+
+        const size_t kSlotCount = kMaxClasses * 2;
+        static_assert((kSlotCount & (kSlotCount - 1)) == 0, "slot count must be a power of two");
+
+        Entry      s_entries[kSlotCount];
+        size_t     s_classCount;
+        size_t     s_moduleCount;    // 仍被 CLSID 引用的模块数
+        Module*    s_modules;        // 所有模块（包括等待回收的）
+        std::mutex s_lock;           // 注册、加载、替换、卸载
+
+        Entry* FindEntry(REFCLSID rclsid)
+        {
+            size_t index = ClassRegistry::Hash(rclsid) & (kSlotCount - 1);
+            for (size_t probe = 0; probe < kSlotCount; ++probe)
+            {
+                Entry& e = s_entries[(index + probe) & (kSlotCount - 1)];
+                if (!e.used.load(std::memory_order_acquire)) return nullptr;
+                if (e.clsid == rclsid) return &e;
+            }
+            return nullptr;
+        }
+
+        void* OpenLibrary(const char* path)
+        {
+#ifdef _WIN32
+            return LoadLibraryA(path);
+#else
+            return dlopen(path, RTLD_NOW | RTLD_LOCAL);
+#endif
+        }
+
+        void* FindSymbol(void* handle, const char* name)
+        {
+#ifdef _WIN32
+            return reinterpret_cast<void*>(GetProcAddress(static_cast<HMODULE>(handle), name));
+#else
+            return dlsym(handle, name);
+#endif
+        }
+
+        void CloseLibrary(void* handle)
+        {
+#ifdef _WIN32
+            FreeLibrary(static_cast<HMODULE>(handle));
+#else
+            dlclose(handle);
+#endif
+        }
+
+        // 按路径查找模块，没有就新建（持有 s_lock）
+        Module* FindOrCreateModule(const char* path)
+        {
+            for (Module* m = s_modules; m; m = m->next)
+            {
+                if (m->entries > 0 && std::strcmp(m->path, path) == 0) return m;  // 被替换下来的模块不复用
+            }
+            if (s_moduleCount >= kMaxModules) return nullptr;
+
+            Module* m = new (std::nothrow) Module();
+            if (!m) return nullptr;
+            std::strcpy(m->path, path);
+            m->next = s_modules;
+            s_modules = m;
+            return m;
+        }
+
+        // 打开模块并查找导出函数，不发布（持有 s_lock）
+        HRESULT Open(Module& m)
+        {
+            void* handle = OpenLibrary(m.path);
+            if (!handle)
+            {
+                COM_LOG_WARN("[ModuleLoader] 加载模块失败");  // 日志只能引用静态字符串，不输出路径
+                return CO_E_DLLNOTFOUND;
+            }
+
+            PfnGetClassObject fn = reinterpret_cast<PfnGetClassObject>(FindSymbol(handle, "DllGetClassObject"));
+            if (!fn)
+            {
+                CloseLibrary(handle);
+                return CO_E_ERRORINDLL;
+            }
+
+            m.handle = handle;
+            m.canUnloadNow = reinterpret_cast<PfnCanUnloadNow>(FindSymbol(handle, "DllCanUnloadNow"));  // 没有的模块永不卸载
+            m.savedFn = fn;
+            COM_LOG_DEBUG("[ModuleLoader] 加载模块: handle = {}", static_cast<const void*>(handle));
+            return S_OK;
+        }
+
+        // 撤下函数指针，等待回收（持有 s_lock）
+        void Retire(Module& m)
+        {
+            PfnGetClassObject fn = m.getClassObject.exchange(nullptr, std::memory_order_seq_cst);
+            if (fn) m.savedFn = fn;
+            m.retiring = true;
+            m.retireEpoch = Epoch::Current();  // 必须在撤下之后读取
+        }
+
+        // 慢路径：加载 e 当前指向的模块（持有 s_lock）
+        HRESULT Load(Entry& e, PfnGetClassObject* pfn)
+        {
+            std::lock_guard<std::mutex> lock(s_lock);
+
+            // 重新读一次：等锁期间模块可能已经被替换，不能把换下来的旧模块再加载回来
+            Module& m = *e.module.load(std::memory_order_acquire);
+            PfnGetClassObject fn = m.getClassObject.load(std::memory_order_acquire);
+            if (!fn)
+            {
+                if (!m.handle)
+                {
+                    HRESULT hr = Open(m);
+                    if (FAILED(hr)) return hr;
+                }
+                // 模块还没关闭（正在等待卸载）：取消卸载，直接恢复
+                m.retiring = false;
+                fn = m.savedFn;
+                m.getClassObject.store(fn, std::memory_order_seq_cst);
+            }
+            *pfn = fn;
+            return S_OK;
+        }
+    }
+
+    HRESULT Register(REFCLSID rclsid, const char* path)
+    {
+        if (!path) return E_POINTER;
+        if (std::strlen(path) >= kMaxPath) return E_INVALIDARG;
+
+        std::lock_guard<std::mutex> lock(s_lock);
+        if (FindEntry(rclsid)) return E_INVALIDARG;
+        if (s_classCount >= kMaxClasses) return E_OUTOFMEMORY;
+
+        Module* module = FindOrCreateModule(path);  // 同一路径共用一个模块
+        if (!module) return E_OUTOFMEMORY;
+        if (module->entries++ == 0) ++s_moduleCount;
+
+        size_t index = ClassRegistry::Hash(rclsid) & (kSlotCount - 1);
+        while (s_entries[index].used.load(std::memory_order_relaxed))
+            index = (index + 1) & (kSlotCount - 1);
+
+        Entry& e = s_entries[index];
+        e.clsid = rclsid;
+        e.module.store(module, std::memory_order_relaxed);
+        e.used.store(true, std::memory_order_release);
+        ++s_classCount;
+        return S_OK;
+    }
+
+    HRESULT Replace(REFCLSID rclsid, const char* path)
+    {
+        if (!path) return E_POINTER;
+        if (std::strlen(path) >= kMaxPath) return E_INVALIDARG;
+
+        std::lock_guard<std::mutex> lock(s_lock);
+        Entry* e = FindEntry(rclsid);
+        if (!e) return REGDB_E_CLASSNOTREG;
+
+        Module* old = e->module.load(std::memory_order_relaxed);
+        if (std::strcmp(old->path, path) == 0) return S_FALSE;  // 已经是这个模块
+
+        Module* module = FindOrCreateModule(path);
+        if (!module) return E_OUTOFMEMORY;
+        bool created = module->entries == 0;
+
+        // 新模块先加载并确认能提供这个类，失败时保持原样
+        HRESULT hr = S_OK;
+        if (!module->handle) hr = Open(*module);
+        if (SUCCEEDED(hr))
+        {
+            IClassFactory* pFactory = nullptr;
+            hr = module->savedFn(rclsid, IID_IClassFactory, (void**)&pFactory);
+            if (SUCCEEDED(hr)) pFactory->Release();
+        }
+        if (FAILED(hr))
+        {
+            if (created)
+            {
+                if (module->handle) CloseLibrary(module->handle);
+                s_modules = module->next;  // 刚插在表头
+                delete module;
+            }
+            return hr;
+        }
+
+        // 发布：之后的请求拿到新模块；拿着旧指针的请求由 Epoch 保护
+        module->retiring = false;
+        module->getClassObject.store(module->savedFn, std::memory_order_seq_cst);
+        if (module->entries++ == 0) ++s_moduleCount;
+        e->module.store(module, std::memory_order_seq_cst);
+
+        // 旧模块不再被这个 CLSID 引用；没有其他 CLSID 用它时撤下，已有对象在最后一次 Release 前照常运行
+        if (--old->entries == 0)
+        {
+            --s_moduleCount;
+            Retire(*old);
+        }
+
+        // 路径在调用者或 Module 里，可能在日志线程格式化之前失效：只记录模块句柄
+        COM_LOG_DEBUG("[ModuleLoader] 替换模块: handle {} -> {}", static_cast<const void*>(old->handle), static_cast<const void*>(module->handle));
+        return S_OK;
+    }
+
+    HRESULT GetClassObject(REFCLSID rclsid, REFIID riid, void** ppv)
+    {
+        if (!ppv) return E_POINTER;
+        *ppv = nullptr;
+
+        Entry* e = FindEntry(rclsid);
+        if (!e) return REGDB_E_CLASSNOTREG;
+
+        // 热路径：进入临界区（一次原子写），读模块和函数指针，不加锁
+        Epoch::Guard guard;
+        Module* m = e->module.load(std::memory_order_seq_cst);
+        PfnGetClassObject fn = m->getClassObject.load(std::memory_order_seq_cst);
+        if (!fn)
+        {
+            HRESULT hr = Load(*e, &fn);
+            if (FAILED(hr)) return hr;
+        }
+        return fn(rclsid, riid, ppv);
+    }
+
+    HRESULT CreateInstance(REFCLSID rclsid, IUnknown* pUnkOuter, REFIID riid, void** ppv)
+    {
+        if (!ppv) return E_POINTER;
+        *ppv = nullptr;
+
+        ComPtr<IClassFactory> pFactory;  // 离开时 Release：对象本身会让模块保持加载
+        HRESULT hr = GetClassObject(rclsid, IID_IClassFactory, (void**)pFactory.ReleaseAndGetAddressOf());
+        if (FAILED(hr)) return hr;
+
+        return pFactory->CreateInstance(pUnkOuter, riid, ppv);
+    }
+
+    size_t FreeUnusedLibraries()
+    {
+        std::lock_guard<std::mutex> lock(s_lock);
+
+        // 1. 撤下空闲的模块（DllCanUnloadNow 只作初筛：撤下之前的请求仍可能创建对象）
+        for (Module* m = s_modules; m; m = m->next)
+        {
+            if (m->handle && !m->retiring && m->canUnloadNow && m->canUnloadNow() == S_OK)
+                Retire(*m);
+        }
+
+        // 2. 推进纪元：没有请求在进行时两步就能让刚撤下的模块满足回收条件
+        Epoch::TryAdvance();
+        Epoch::TryAdvance();
+
+        // 3. 回收：撤下之前开始的请求都已结束，此时 DllCanUnloadNow 的回答不会再被推翻
+        size_t freed = 0;
+        for (Module** link = &s_modules; Module* m = *link;)
+        {
+            if (!m->retiring || !Epoch::IsSafe(m->retireEpoch))
+            {
+                link = &m->next;
+                continue;
+            }
+
+            bool idle = !m->handle || (m->canUnloadNow && m->canUnloadNow() == S_OK);
+            if (!idle)
+            {
+                if (m->entries > 0)
+                {
+                    // 撤下期间又创建了对象：取消卸载
+                    m->retiring = false;
+                    m->getClassObject.store(m->savedFn, std::memory_order_seq_cst);
+                }
+                // 被替换下来的旧模块：等它的对象全部释放
+                link = &m->next;
+                continue;
+            }
+
+            if (m->handle)
+            {
+                COM_LOG_DEBUG("[ModuleLoader] 卸载模块: handle = {}", static_cast<const void*>(m->handle));  // m 随后可能被回收，不引用 m->path
+                CloseLibrary(m->handle);
+                m->handle = nullptr;
+                m->canUnloadNow = nullptr;
+                m->savedFn = nullptr;
+                ++freed;
+            }
+            m->retiring = false;
+
+            if (m->entries == 0)
+            {
+                *link = m->next;  // 被替换下来的模块：整个回收
+                delete m;
+                continue;
+            }
+            link = &m->next;  // 仍然登记着：下次请求时重新加载
+        }
+        return freed;
+    }
+
+    bool IsLoaded(REFCLSID rclsid)
+    {
+        Entry* e = FindEntry(rclsid);
+        if (!e) return false;
+        Epoch::Guard guard;
+        return e->module.load(std::memory_order_seq_cst)->getClassObject.load(std::memory_order_acquire) != nullptr;
+    }
+
+    size_t RetiringCount()
+    {
+        std::lock_guard<std::mutex> lock(s_lock);
+        size_t count = 0;
+        for (Module* m = s_modules; m; m = m->next)
+        {
+            if (m->retiring && m->entries == 0) ++count;
+        }
+        return count;
+    }
+}
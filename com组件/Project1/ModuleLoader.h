@@ -0,0 +1,55 @@
+// ModuleLoader.h - 组件模块（DLL / .so）加载器
+// =====================================================
+// 模拟 COM 运行时的 CoCreateInstance / CoFreeUnusedLibraries：
+//
+//   ModuleLoader::Register(CLSID_Calculator, "build/libCalculator.so");  // 只登记，不加载
+//   ModuleLoader::CreateInstance(CLSID_Calculator, nullptr, IID_ICalculator, (void**)&p);
+//   ...
+//   ModuleLoader::FreeUnusedLibraries();  // 卸载 DllCanUnloadNow 返回 S_OK 的模块
+//
+//   - 延迟加载：Register 只记录路径，第一次请求这个 CLSID 时才 dlopen/LoadLibrary，
+//     从来没用到的组件不影响进程启动
+//   - 以 CLSID 为键的哈希表缓存每个类对应的模块和 DllGetClassObject 地址，
+//     之后的请求不加锁、不做符号查找；多个 CLSID 可以共用一个模块（只加载一次）
+//   - 热替换：Replace 把 CLSID 切换到新模块（例如新版本的构建），之后的创建请求得到新实现；
+//     旧模块创建的对象照常运行旧代码，直到最后一次 Release，之后旧模块才被回收
+//   - 请求路径只进入一个 Epoch 临界区（见 Epoch.h），不加锁；卸载和替换先撤下函数指针，
+//     等纪元推进、所有可能拿着旧指针的请求都结束后才关闭模块
+//
+// 注意：和 COM 的 DllCanUnloadNow 一样，对象最后一次 Release 返回之前的几条指令仍在模块里执行；
+// 调用 FreeUnusedLibraries 的时机应当避开这个窗口（例如定期调用，而不是紧跟在 Release 之后）
+//
+// 注册在启动阶段进行（加锁）；查找和创建可以在任意线程并发进行
+#pragma once
+#include "ComPlatform.h"
+#include <cstddef>
+
+namespace ModuleLoader
+{
+    const size_t kMaxClasses = 64;  // 最多登记的类数
+    const size_t kMaxModules = 16;  // 最多登记的模块数
+
+    // 登记 rclsid 由 path 处的模块提供；同一路径只算一个模块
+    // 返回 E_INVALIDARG（重复的 CLSID）或 E_OUTOFMEMORY（表已满）
+    HRESULT Register(REFCLSID rclsid, const char* path);
+
+    // 取得类对象：必要时加载模块
+    // 未登记返回 REGDB_E_CLASSNOTREG；模块加载失败返回 CO_E_DLLNOTFOUND；缺少导出函数返回 CO_E_ERRORINDLL
+    HRESULT GetClassObject(REFCLSID rclsid, REFIID riid, void** ppv);
+
+    // 热替换：把 rclsid 切换到 path 处的模块（先加载并确认它能提供这个类，失败时保持原样）
+    // 已经是这个模块时返回 S_FALSE；旧模块在它的对象全部释放后由 FreeUnusedLibraries 回收
+    HRESULT Replace(REFCLSID rclsid, const char* path);
+
+    // 通过类工厂创建对象
+    HRESULT CreateInstance(REFCLSID rclsid, IUnknown* pUnkOuter, REFIID riid, void** ppv);
+
+    // 询问每个已加载的模块 DllCanUnloadNow，卸载可以卸载的（包括被替换下来的旧模块），返回卸载的模块数
+    size_t FreeUnusedLibraries();
+
+    // 被替换下来、还在等待回收的模块数
+    size_t RetiringCount();
+
+    // rclsid 所在的模块当前是否已加载
+    bool IsLoaded(REFCLSID rclsid);
+}
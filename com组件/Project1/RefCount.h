@@ -0,0 +1,83 @@
+// RefCount.h - 线程安全的引用计数
+// =====================================================
+// COM 对象可能被多个线程同时 AddRef/Release，普通的 ++/-- 会产生数据竞争
+// 这里用无锁原子操作，并选择最弱但仍然正确的内存序：
+//   - 增加：relaxed
+//     能调用 AddRef 说明调用者已经持有一个引用，对象不会在此期间被销毁，
+//     不需要和其他线程同步任何数据
+//   - 减少：release；减到 0 时再补一个 acquire 栅栏（等价于最后一次 acq_rel）
+//     保证其他线程在 Release 之前对对象的所有写入，在 delete 之前都可见
+//     ThreadSanitizer 不理解单独的栅栏，TSan 构建下直接用 acq_rel（否则会误报析构时的数据竞争）
+// Debug 构建（没有定义 NDEBUG）还按线程统计增减的次数，用来检查一段代码产生了多少次原子操作（见 ThreadOps）
+#pragma once
+#include "ComPlatform.h"
+#include <atomic>
+
+#if defined(__SANITIZE_THREAD__)
+#define REFCOUNT_TSAN 1
+#elif defined(__has_feature)
+#if __has_feature(thread_sanitizer)
+#define REFCOUNT_TSAN 1
+#endif
+#endif
+
+#if !defined(NDEBUG)
+#define REFCOUNT_COUNT_OPS 1
+#endif
+
+class RefCount
+{
+private:
+    std::atomic<ULONG> m_count;
+
+#if defined(REFCOUNT_COUNT_OPS)
+    static inline thread_local unsigned long long s_threadOps = 0;
+#endif
+
+public:
+    explicit RefCount(ULONG initial = 1) : m_count(initial) {}
+
+    RefCount(const RefCount&) = delete;
+    RefCount& operator=(const RefCount&) = delete;
+
+    // 返回增加后的值
+    ULONG Increment()
+    {
+#if defined(REFCOUNT_COUNT_OPS)
+        ++s_threadOps;
+#endif
+        return m_count.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    // 返回减少后的值；返回 0 时调用者负责销毁对象
+    ULONG Decrement()
+    {
+#if defined(REFCOUNT_COUNT_OPS)
+        ++s_threadOps;
+#endif
+#if defined(REFCOUNT_TSAN)
+        return m_count.fetch_sub(1, std::memory_order_acq_rel) - 1;
+#else
+        ULONG count = m_count.fetch_sub(1, std::memory_order_release) - 1;
+        if (count == 0)
+            std::atomic_thread_fence(std::memory_order_acquire);
+        return count;
+#endif
+    }
+
+    // 当前值，只用于调试输出
+    ULONG Get() const
+    {
+        return m_count.load(std::memory_order_relaxed);
+    }
+
+    // 当前线程至今对所有 RefCount 做过的增减次数；Release 构建中不统计，总是返回 0
+    static unsigned long long ThreadOps()
+    {
+#if defined(REFCOUNT_COUNT_OPS)
+        return s_threadOps;
+#else
+        return 0;
+#endif
+    }
+};
@@ -0,0 +1,82 @@
+// RefCountBench.cpp - AddRef/Release 多线程争用测试
+// =====================================================
+// 独立的测试程序（有自己的 main，已在项目中排除编译）
+// 测量不同线程数下 AddRef/Release 对的吞吐量，用于估算线程池规模：
+//   - 共享：所有线程操作同一个对象（同一条缓存行，最坏情况）
+//   - 独占：每个线程操作自己的对象（没有争用，作为对照）
+//
+// 需要用 Release 配置（NDEBUG）编译，日志语句在编译期被去掉，不影响测量
+// Linux 编译：
+//   g++ -std=c++20 -O2 -DNDEBUG -pthread StandardCOM.cpp BatchKernels.cpp ComLog.cpp ComModule.cpp SlabPool.cpp ClassRegistry.cpp InterfaceMap.cpp AsyncCalculator.cpp WorkStealingPool.cpp Expression.cpp Statistics.cpp RefProfiler.cpp LocalServer.cpp Apartment.cpp ModuleLoader.cpp Epoch.cpp RefCountBench.cpp -o RefCountBench
+#include "StandardCOM.h"
+#include <barrier>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+static const int kPairsPerThread = 2000000;
+
+// 返回所有线程合计的 AddRef/Release 对数每秒
+static double Run(unsigned threadCount, bool shared)
+{
+    vector<ICalculator*> objects(threadCount);
+    ICalculator* sharedObject = new Calculator();
+    for (unsigned t = 0; t < threadCount; ++t)
+        objects[t] = shared ? sharedObject : new Calculator();
+
+    barrier start(threadCount + 1);
+    barrier stop(threadCount + 1);
+    vector<thread> threads;
+    for (unsigned t = 0; t < threadCount; ++t)
+    {
+        threads.emplace_back([&, t]
+        {
+            ICalculator* p = objects[t];
+            start.arrive_and_wait();
+            for (int i = 0; i < kPairsPerThread; ++i)
+            {
+                p->AddRef();
+                p->Release();
+            }
+            stop.arrive_and_wait();
+        });
+    }
+
+    start.arrive_and_wait();
+    auto begin = chrono::steady_clock::now();
+    stop.arrive_and_wait();
+    auto end = chrono::steady_clock::now();
+
+    for (thread& th : threads) th.join();
+    if (!shared)
+    {
+        for (ICalculator* p : objects) p->Release();
+    }
+    sharedObject->Release();
+
+    double seconds = chrono::duration<double>(end - begin).count();
+    return (double)threadCount * kPairsPerThread / seconds;
+}
+
+int main()
+{
+    unsigned maxThreads = thread::hardware_concurrency();
+    if (maxThreads == 0) maxThreads = 4;
+
+    vector<unsigned> counts;
+    for (unsigned n = 1; n < maxThreads; n *= 2) counts.push_back(n);
+    counts.push_back(maxThreads);
+
+    printf("AddRef/Release 吞吐量（每线程 %d 对）\n", kPairsPerThread);
+    printf("%8s %16s %16s %16s\n", "threads", "shared Mpairs/s", "private Mpairs/s", "shared ns/pair");
+    for (unsigned n : counts)
+    {
+        double shared = Run(n, true);
+        double priv = Run(n, false);
+        printf("%8u %16.2f %16.2f %16.2f\n", n, shared / 1e6, priv / 1e6, 1e9 * n / shared);
+    }
+    return 0;
+}
@@ -0,0 +1,516 @@
+// RefProfiler.cpp - AddRef/Release 调用点剖析的实现
+#include "RefProfiler.h"
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <new>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#ifndef _WIN32
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <cstdlib>
+#endif
+
+namespace RefProfiler
+{
+    namespace Detail
+    {
+        std::atomic<bool> s_running{ false };
+    }
+
+    namespace
+    {
+        struct Event
+        {
+            int64_t      ns;         // 相对 s_origin
+            const void*  object;
+            const void*  caller;
+            const char*  className;  // 静态字符串
+            ULONG        count;      // 操作之后的引用计数
+            RefEventKind kind;
+        };
+
+        // ========================================
+        // 每线程的事件缓冲区
+        // ========================================
+        // 只有所属线程写：先写事件，再用 release 发布新的长度；汇总时只读已发布的部分
+        struct alignas(64) ThreadBuffer
+        {
+            std::atomic<size_t>   size{ 0 };
+            std::atomic<uint32_t> session{ 0 };    // 属于哪一次 Start；过期的缓冲区由所属线程自己清空
+            std::atomic<uint64_t> dropped{ 0 };    // 缓冲区满后丢弃的事件数
+            uint32_t              tid = 0;         // 时间线上的线程号（缓冲区的序号）
+            ThreadBuffer*         next = nullptr;  // 全局链表，只增不减
+            std::atomic<bool>     inUse{ true };
+            Event                 events[kEventsPerThread];
+        };
+
+        // 线程退出后缓冲区留在链表里（数据仍然有效），新线程优先复用空闲的缓冲区
+        std::atomic<ThreadBuffer*> s_buffers{ nullptr };
+        std::mutex                 s_lock;      // 注册新线程、Start、汇总
+        uint32_t                   s_threadCount = 0;
+        std::atomic<uint32_t>      s_session{ 0 };
+        std::atomic<uint32_t>      s_sampleInterval{ 1 };
+
+        const std::chrono::steady_clock::time_point s_origin = std::chrono::steady_clock::now();
+
+        struct BufferOwner
+        {
+            ThreadBuffer* buffer = nullptr;
+            ~BufferOwner()
+            {
+                if (buffer) buffer->inUse.store(false, std::memory_order_release);
+            }
+        };
+
+        thread_local BufferOwner t_owner;
+
+        ThreadBuffer* AttachThread()
+        {
+            std::lock_guard<std::mutex> lock(s_lock);
+            for (ThreadBuffer* b = s_buffers.load(std::memory_order_relaxed); b; b = b->next)
+            {
+                if (!b->inUse.load(std::memory_order_acquire))
+                {
+                    b->inUse.store(true, std::memory_order_relaxed);
+                    return t_owner.buffer = b;
+                }
+            }
+            ThreadBuffer* b = new (std::nothrow) ThreadBuffer();
+            if (!b) return nullptr;
+            b->tid = ++s_threadCount;
+            b->next = s_buffers.load(std::memory_order_relaxed);
+            s_buffers.store(b, std::memory_order_release);
+            return t_owner.buffer = b;
+        }
+
+        // 对象地址 → 是否取样。地址低位是对齐产生的 0，先混合一下
+        inline bool Sampled(const void* object, uint32_t interval)
+        {
+            uint64_t h = (uint64_t)(uintptr_t)object * 0x9E3779B97F4A7C15ull;
+            return (h >> 32) % interval == 0;
+        }
+
+        // ========================================
+        // 汇总
+        // ========================================
+        struct Sample
+        {
+            Event    event;
+            uint32_t tid;
+        };
+
+        // 一对 AddRef（或创建）→ Release
+        struct Pair
+        {
+            size_t acquire;  // samples 下标
+            size_t release;
+        };
+
+        // 对象的一次生命（同一地址可能先后分配给多个对象）
+        struct Instance
+        {
+            size_t create;
+            size_t destroy;  // SIZE_MAX：记录结束时还活着
+        };
+
+        struct PairKey
+        {
+            std::string  className;
+            RefEventKind acquireKind;
+            const void*  acquireSite;
+            const void*  releaseSite;
+
+            bool operator<(const PairKey& other) const
+            {
+                return std::tie(className, acquireKind, acquireSite, releaseSite) <
+                       std::tie(other.className, other.acquireKind, other.acquireSite, other.releaseSite);
+            }
+        };
+
+        struct PairStats
+        {
+            PairKey  key;
+            uint64_t count = 0;
+            int64_t  heldNs = 0;  // 合计持有时间
+        };
+
+        struct Analysis
+        {
+            std::vector<Sample>    samples;  // 按对象、时间排序
+            std::vector<Pair>      pairs;
+            std::vector<Instance>  instances;
+            std::vector<PairStats> hotPairs;  // 按次数从多到少
+            std::map<std::string, std::vector<int64_t>> lifetimes;  // 类名 → 各对象的寿命（ns，从小到大）
+            uint64_t dropped = 0;
+            uint64_t unpairedReleases = 0;  // 对应的 AddRef 不在记录里（Start 之前取得的引用或被丢弃）
+            uint64_t outstanding = 0;       // 记录结束时还没有 Release 的引用
+        };
+
+        void Collect(Analysis* a)
+        {
+            std::lock_guard<std::mutex> lock(s_lock);
+            uint32_t session = s_session.load(std::memory_order_relaxed);
+            for (ThreadBuffer* b = s_buffers.load(std::memory_order_acquire); b; b = b->next)
+            {
+                if (b->session.load(std::memory_order_acquire) != session) continue;
+                size_t n = b->size.load(std::memory_order_acquire);
+                for (size_t i = 0; i < n; ++i) a->samples.push_back({ b->events[i], b->tid });
+                a->dropped += b->dropped.load(std::memory_order_relaxed);
+            }
+        }
+
+        void Analyze(Analysis* a)
+        {
+            Collect(a);
+            std::vector<Sample>& s = a->samples;
+            // 同一线程的事件已经按顺序排好，stable_sort 保证时间相同时不打乱
+            std::stable_sort(s.begin(), s.end(), [](const Sample& x, const Sample& y)
+            {
+                if (x.event.object != y.event.object) return x.event.object < y.event.object;
+                return x.event.ns < y.event.ns;
+            });
+
+            // holds[n]：把计数加到 n 的那次 AddRef（或创建），等待把计数从 n 减下来的 Release
+            const size_t kNone = SIZE_MAX;
+            std::vector<size_t> holds;
+            size_t create = kNone;
+            std::map<PairKey, PairStats> byKey;
+
+            // 一个对象的记录结束（销毁、地址被新对象复用或者换到下一个地址）
+            auto endInstance = [&]()
+            {
+                a->outstanding += (uint64_t)std::count_if(holds.begin(), holds.end(), [&](size_t h) { return h != kNone; });
+                if (create != kNone) a->instances.push_back({ create, kNone });
+                holds.clear();
+                create = kNone;
+            };
+
+            for (size_t i = 0; i < s.size(); ++i)
+            {
+                const Event& e = s[i].event;
+                if (i > 0 && e.object != s[i - 1].event.object) endInstance();
+
+                if (e.kind == RefEvent_Create)
+                {
+                    endInstance();
+                    holds.assign(2, kNone);
+                    holds[1] = i;
+                    create = i;
+                    continue;
+                }
+
+                if (e.kind == RefEvent_AddRef)
+                {
+                    if (holds.size() <= e.count) holds.resize((size_t)e.count + 1, kNone);
+                    holds[e.count] = i;
+                    continue;
+                }
+
+                // Release：与把计数加到 count + 1 的那次配对
+                size_t level = (size_t)e.count + 1;
+                size_t h = level < holds.size() ? holds[level] : kNone;
+                if (h == kNone)
+                {
+                    ++a->unpairedReleases;
+                }
+                else
+                {
+                    holds[level] = kNone;
+                    a->pairs.push_back({ h, i });
+                    const Event& acquire = s[h].event;
+                    PairKey key = { e.className, acquire.kind, acquire.caller, e.caller };
+                    PairStats& stats = byKey[key];
+                    stats.key = key;
+                    ++stats.count;
+                    stats.heldNs += e.ns - acquire.ns;
+                }
+
+                if (e.count == 0 && create != kNone)  // 对象销毁
+                {
+                    a->instances.push_back({ create, i });
+                    a->lifetimes[e.className].push_back(e.ns - s[create].event.ns);
+                    create = kNone;
+                }
+                if (e.count == 0) endInstance();
+            }
+            endInstance();
+
+            for (auto& entry : byKey) a->hotPairs.push_back(entry.second);
+            std::stable_sort(a->hotPairs.begin(), a->hotPairs.end(), [](const PairStats& x, const PairStats& y)
+            {
+                return x.count > y.count;
+            });
+            for (auto& entry : a->lifetimes) std::sort(entry.second.begin(), entry.second.end());
+        }
+
+        int64_t Percentile(const std::vector<int64_t>& sorted, double q)
+        {
+            return sorted[(size_t)(q * (double)(sorted.size() - 1))];
+        }
+
+        // ========================================
+        // 调用点 → 文字
+        // ========================================
+        std::string Symbolize(const void* address)
+        {
+            char text[64];
+#ifdef _WIN32
+            HMODULE module = nullptr;
+            char path[MAX_PATH] = "?";
+            if (GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                                   (LPCSTR)address, &module))
+            {
+                GetModuleFileNameA(module, path, MAX_PATH);
+            }
+            const char* name = path;
+            for (const char* p = path; *p; ++p)
+            {
+                if (*p == '\\' || *p == '/') name = p + 1;
+            }
+            snprintf(text, sizeof(text), "+0x%llx", (unsigned long long)((const char*)address - (const char*)module));
+            return std::string(name) + text;
+#else
+            Dl_info info;
+            if (!dladdr(address, &info) || !info.dli_fname)
+            {
+                snprintf(text, sizeof(text), "%p", address);
+                return text;
+            }
+            if (info.dli_sname)
+            {
+                int status = 0;
+                char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+                std::string name = (status == 0 && demangled) ? demangled : info.dli_sname;
+                free(demangled);
+                snprintf(text, sizeof(text), "+0x%llx", (unsigned long long)((const char*)address - (const char*)info.dli_saddr));
+                return name + text;
+            }
+            const char* name = info.dli_fname;
+            for (const char* p = info.dli_fname; *p; ++p)
+            {
+                if (*p == '/') name = p + 1;
+            }
+            snprintf(text, sizeof(text), "+0x%llx", (unsigned long long)((const char*)address - (const char*)info.dli_fbase));
+            return std::string(name) + text;
+#endif
+        }
+
+        class SymbolCache
+        {
+        private:
+            std::map<const void*, std::string> m_names;
+
+        public:
+            const std::string& operator()(const void* address)
+            {
+                auto it = m_names.find(address);
+                if (it == m_names.end()) it = m_names.emplace(address, Symbolize(address)).first;
+                return it->second;
+            }
+        };
+
+        const char* AcquireName(RefEventKind kind)
+        {
+            return kind == RefEvent_Create ? "Create" : "AddRef";
+        }
+
+        // JSON 字符串（符号名里可能有引号或反斜杠）
+        void WriteString(FILE* f, const std::string& text)
+        {
+            fputc('"', f);
+            for (char c : text)
+            {
+                if (c == '"' || c == '\\') fputc('\\', f);
+                if ((unsigned char)c < 0x20) continue;
+                fputc(c, f);
+            }
+            fputc('"', f);
+        }
+
+        // 时间线的时间单位是微秒
+        double Us(int64_t ns)
+        {
+            return (double)ns / 1000.0;
+        }
+    }
+
+    void Start(uint32_t objectSampleInterval)
+    {
+        std::lock_guard<std::mutex> lock(s_lock);
+        s_sampleInterval.store(objectSampleInterval ? objectSampleInterval : 1, std::memory_order_relaxed);
+        s_session.fetch_add(1, std::memory_order_relaxed);
+        Detail::s_running.store(true, std::memory_order_release);
+    }
+
+    void Stop()
+    {
+        Detail::s_running.store(false, std::memory_order_release);
+    }
+
+    bool IsRunning()
+    {
+        return Detail::s_running.load(std::memory_order_relaxed);
+    }
+
+    void Record(RefEventKind kind, const char* className, const void* object, ULONG count, const void* caller)
+    {
+        uint32_t interval = s_sampleInterval.load(std::memory_order_relaxed);
+        if (interval > 1 && !Sampled(object, interval)) return;
+
+        ThreadBuffer* b = t_owner.buffer;
+        if (!b && !(b = AttachThread())) return;  // 内存不足：不记录
+
+        uint32_t session = s_session.load(std::memory_order_relaxed);
+        if (b->session.load(std::memory_order_relaxed) != session)
+        {
+            b->size.store(0, std::memory_order_relaxed);
+            b->dropped.store(0, std::memory_order_relaxed);
+            b->session.store(session, std::memory_order_release);
+        }
+
+        size_t i = b->size.load(std::memory_order_relaxed);
+        if (i == kEventsPerThread)
+        {
+            b->dropped.store(b->dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+        int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_origin).count();
+        b->events[i] = { ns, object, caller, className, count, kind };
+        b->size.store(i + 1, std::memory_order_release);
+    }
+
+    void PrintReport(FILE* out, size_t topPairs)
+    {
+        Analysis a;
+        Analyze(&a);
+        SymbolCache symbol;
+
+        fprintf(out, "引用计数事件 %zu 个（丢弃 %llu），配对 %zu，未配对的 Release %llu，仍持有的引用 %llu\n",
+                a.samples.size(), (unsigned long long)a.dropped, a.pairs.size(),
+                (unsigned long long)a.unpairedReleases, (unsigned long long)a.outstanding);
+
+        fprintf(out, "最热的调用点对:\n");
+        for (size_t i = 0; i < a.hotPairs.size() && i < topPairs; ++i)
+        {
+            const PairStats& p = a.hotPairs[i];
+            fprintf(out, "  %6llu 次  平均持有 %10.0f ns  %-10s %s %s\n      → Release %s\n",
+                    (unsigned long long)p.count, (double)p.heldNs / (double)p.count, p.key.className.c_str(),
+                    AcquireName(p.key.acquireKind), symbol(p.key.acquireSite).c_str(), symbol(p.key.releaseSite).c_str());
+        }
+
+        fprintf(out, "对象寿命:\n");
+        for (const auto& entry : a.lifetimes)
+        {
+            const std::vector<int64_t>& t = entry.second;
+            fprintf(out, "  %-10s %6zu 个  p50 %10lld ns  p90 %10lld ns  p99 %10lld ns  最长 %10lld ns\n",
+                    entry.first.c_str(), t.size(), (long long)Percentile(t, 0.50), (long long)Percentile(t, 0.90),
+                    (long long)Percentile(t, 0.99), (long long)t.back());
+
+            // 按数量级分组
+            static const char* const kRanges[] = { "< 1 us", "< 10 us", "< 100 us", "< 1 ms", "< 10 ms", "< 100 ms", "< 1 s", ">= 1 s" };
+            size_t counts[8] = {};
+            for (int64_t ns : t)
+            {
+                size_t k = 0;
+                for (int64_t limit = 1000; k < 7 && ns >= limit; limit *= 10) ++k;
+                ++counts[k];
+            }
+            for (size_t k = 0; k < 8; ++k)
+            {
+                if (counts[k]) fprintf(out, "      %-9s %6zu\n", kRanges[k], counts[k]);
+            }
+        }
+    }
+
+    bool WriteTrace(const char* path, size_t topPairs)
+    {
+        FILE* f = fopen(path, "w");
+        if (!f) return false;
+
+        Analysis a;
+        Analyze(&a);
+        SymbolCache symbol;
+        char object[32];
+
+        fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+        fprintf(f, "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"RefProfiler\"}}");
+        std::vector<bool> named;
+        for (const Sample& s : a.samples)
+        {
+            if (named.size() <= s.tid) named.resize(s.tid + 1, false);
+            if (named[s.tid]) continue;
+            named[s.tid] = true;
+            fprintf(f, ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"线程 %u\"}}", s.tid, s.tid);
+        }
+
+        // 每个 AddRef/Release 是线程上的一个短片段，参数里有对象、计数和调用点
+        for (const Sample& s : a.samples)
+        {
+            const Event& e = s.event;
+            snprintf(object, sizeof(object), "%p", e.object);
+            fprintf(f, ",\n{\"ph\":\"X\",\"cat\":\"ref\",\"name\":\"%s\",\"ts\":%.3f,\"dur\":0.001,\"pid\":1,\"tid\":%u,"
+                       "\"args\":{\"class\":\"%s\",\"object\":\"%s\",\"refs\":%u,\"caller\":",
+                    e.kind == RefEvent_Create ? "Create" : e.kind == RefEvent_AddRef ? "AddRef" : "Release",
+                    Us(e.ns), s.tid, e.className, object, (unsigned)e.count);
+            WriteString(f, symbol(e.caller));
+            fprintf(f, "}}");
+        }
+
+        // 配对的 AddRef → Release 用箭头连起来
+        for (size_t i = 0; i < a.pairs.size(); ++i)
+        {
+            const Sample& acquire = a.samples[a.pairs[i].acquire];
+            const Sample& release = a.samples[a.pairs[i].release];
+            fprintf(f, ",\n{\"ph\":\"s\",\"cat\":\"ref\",\"name\":\"ref\",\"id\":%zu,\"ts\":%.3f,\"pid\":1,\"tid\":%u}",
+                    i, Us(acquire.event.ns), acquire.tid);
+            fprintf(f, ",\n{\"ph\":\"f\",\"bp\":\"e\",\"cat\":\"ref\",\"name\":\"ref\",\"id\":%zu,\"ts\":%.3f,\"pid\":1,\"tid\":%u}",
+                    i, Us(release.event.ns), release.tid);
+        }
+
+        // 对象从创建到销毁是一条异步轨道；记录结束时还活着的对象没有结束事件
+        for (size_t i = 0; i < a.instances.size(); ++i)
+        {
+            const Sample& create = a.samples[a.instances[i].create];
+            snprintf(object, sizeof(object), "%p", create.event.object);
+            fprintf(f, ",\n{\"ph\":\"b\",\"cat\":\"object\",\"name\":\"%s\",\"id\":\"obj%zu\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,"
+                       "\"args\":{\"object\":\"%s\"}}",
+                    create.event.className, i, Us(create.event.ns), create.tid, object);
+            if (a.instances[i].destroy == SIZE_MAX) continue;
+            const Sample& destroy = a.samples[a.instances[i].destroy];
+            fprintf(f, ",\n{\"ph\":\"e\",\"cat\":\"object\",\"name\":\"%s\",\"id\":\"obj%zu\",\"ts\":%.3f,\"pid\":1,\"tid\":%u}",
+                    destroy.event.className, i, Us(destroy.event.ns), destroy.tid);
+        }
+
+        // 汇总（查看器会忽略这个字段）
+        fprintf(f, "\n],\n\"refProfile\":{\"events\":%zu,\"dropped\":%llu,\"pairs\":%zu,\"unpairedReleases\":%llu,\"outstanding\":%llu,\n\"hotPairs\":[",
+                a.samples.size(), (unsigned long long)a.dropped, a.pairs.size(),
+                (unsigned long long)a.unpairedReleases, (unsigned long long)a.outstanding);
+        for (size_t i = 0; i < a.hotPairs.size() && i < topPairs; ++i)
+        {
+            const PairStats& p = a.hotPairs[i];
+            fprintf(f, "%s\n{\"class\":\"%s\",\"acquire\":\"%s\",\"acquireSite\":", i ? "," : "",
+                    p.key.className.c_str(), AcquireName(p.key.acquireKind));
+            WriteString(f, symbol(p.key.acquireSite));
+            fprintf(f, ",\"releaseSite\":");
+            WriteString(f, symbol(p.key.releaseSite));
+            fprintf(f, ",\"count\":%llu,\"meanHeldNs\":%.0f}", (unsigned long long)p.count, (double)p.heldNs / (double)p.count);
+        }
+        fprintf(f, "],\n\"lifetimes\":[");
+        bool first = true;
+        for (const auto& entry : a.lifetimes)
+        {
+            const std::vector<int64_t>& t = entry.second;
+            fprintf(f, "%s\n{\"class\":\"%s\",\"count\":%zu,\"p50Ns\":%lld,\"p90Ns\":%lld,\"p99Ns\":%lld,\"maxNs\":%lld}",
+                    first ? "" : ",", entry.first.c_str(), t.size(), (long long)Percentile(t, 0.50),
+                    (long long)Percentile(t, 0.90), (long long)Percentile(t, 0.99), (long long)t.back());
+            first = false;
+        }
+        fprintf(f, "]}}\n");
+        return fclose(f) == 0;
+    }
+}
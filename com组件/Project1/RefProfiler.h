@@ -0,0 +1,97 @@
+// RefProfiler.h - AddRef/Release 的调用点剖析
+// =====================================================
+// AddRef/Release 的日志只有新的引用计数，看不出是哪段代码在反复增减。
+// 剖析模式把每次 AddRef/Release（以及对象创建）连同调用者的返回地址记下来，离线分析：
+//
+//   RefProfiler::Start();                    // 开始记录（objectSampleInterval > 1 时只记录一部分对象）
+//   ...                                      // 正常运行
+//   RefProfiler::Stop();
+//   RefProfiler::PrintReport(stdout, 10);    // 最热的 AddRef→Release 调用点对、对象寿命分布
+//   RefProfiler::WriteTrace("refs.json");    // Chrome trace / Perfetto 时间线（chrome://tracing 或 ui.perfetto.dev 打开）
+//
+// 组件里的写法（必须写在 AddRef/Release 函数体内，返回地址才是调用者）：
+//
+//   ULONG __stdcall Calculator::AddRef()
+//   {
+//       ULONG count = m_refCount.Increment();
+//       COM_REF_PROFILE(RefEvent_AddRef, "Calculator", this, count);
+//       ...
+//
+// 记录方式：
+//   - 每个线程写自己的事件缓冲区（单写者，定长，写满后丢弃并计数），记录路径上没有锁也没有原子读-改-写
+//   - 按对象取样：对象地址的哈希决定是否记录，被选中的对象的所有事件都记下来，AddRef 和 Release 才能配对
+//     （Calculator 来自对象池，地址会复用，取样选中的其实是池里的槽位）
+//   - 配对规则：把计数加到 n 的 AddRef 与之后把计数从 n 减下来的 Release 配成一对（后进先出），
+//     初始引用（创建时的 1）与减到 0 的 Release 配对，创建到销毁就是对象的寿命。
+//     多个线程同时增减同一个对象时事件按时间排序，时间几乎相同的可能错配，计入「未配对」
+//   - 编译期开关 COM_ENABLE_REFPROFILE：默认 Debug 编译进来、Release（NDEBUG）去掉；
+//     编译进来但没有 Start 时，每次 AddRef/Release 只多一次读全局标志
+//
+// 调用点显示为「符号+偏移」或「模块+偏移」，后者可以用 addr2line -e <模块> <偏移> 查到源代码行
+#pragma once
+#include "ComPlatform.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#ifndef COM_ENABLE_REFPROFILE
+#if defined(NDEBUG)
+#define COM_ENABLE_REFPROFILE 0
+#else
+#define COM_ENABLE_REFPROFILE 1
+#endif
+#endif
+
+enum RefEventKind : uint8_t
+{
+    RefEvent_Create,   // 构造函数：初始引用
+    RefEvent_AddRef,
+    RefEvent_Release,  // 计数减到 0 即对象销毁
+};
+
+namespace RefProfiler
+{
+    const size_t kEventsPerThread = 1 << 16;  // 每个线程的缓冲区容量
+
+    // 开始一次记录（丢弃上一次的数据）；每 objectSampleInterval 个对象记录大约一个
+    void Start(uint32_t objectSampleInterval = 1);
+    void Stop();
+    bool IsRunning();
+
+    // 记录一个事件（通过 COM_REF_PROFILE 调用）；count 是操作之后的引用计数
+    void Record(RefEventKind kind, const char* className, const void* object, ULONG count, const void* caller);
+
+    // 汇总最近一次记录：topPairs 个最热的调用点对和每个类的对象寿命分布。应在 Stop 之后调用
+    void PrintReport(FILE* out, size_t topPairs = 10);
+
+    // 写成 Chrome trace JSON：对象寿命、每次 AddRef/Release 以及配对的连线，汇总放在 refProfile 字段里
+    bool WriteTrace(const char* path, size_t topPairs = 20);
+
+    namespace Detail
+    {
+        extern std::atomic<bool> s_running;
+    }
+}
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define COM_RETURN_ADDRESS() _ReturnAddress()
+#else
+#define COM_RETURN_ADDRESS() __builtin_return_address(0)
+#endif
+
+#if COM_ENABLE_REFPROFILE
+
+#define COM_REF_PROFILE(kind, className, object, count)                                     \
+    do                                                                                      \
+    {                                                                                       \
+        if (RefProfiler::Detail::s_running.load(std::memory_order_relaxed))                 \
+            RefProfiler::Record(kind, className, object, count, COM_RETURN_ADDRESS());      \
+    } while (0)
+
+#else
+
+#define COM_REF_PROFILE(kind, className, object, count) do {} while (0)
+
+#endif  // COM_ENABLE_REFPROFILE
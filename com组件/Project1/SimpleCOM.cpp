@@ -2,20 +2,23 @@
 // =====================================================
 
 #include "SimpleCOM.h"  // 包含我们定义的接口和类声明
-#include <iostream>     // 用于输出调试信息
+#include "ComLog.h"      // 用于输出调试信息（异步日志，Release 编译时整体去掉）
+#include "InterfaceMap.h" // 表驱动的 QueryInterface
+#include "RefProfiler.h"  // 引用计数剖析（RefProfiler::Start 之后记录调用点）
 
 
 // =====================================================
 // 构造函数：创建 COM 对象时被调用
 // =====================================================
 SimpleCalculator::SimpleCalculator()
-{
     // 初始化引用计数为 1
     // 为什么是 1？因为创建对象的人已经持有了一个引用
-    m_refCount = 1;
+    : m_refCount(1)
+{
+    COM_REF_PROFILE(RefEvent_Create, "SimpleCalculator", this, 1);
 
     // 输出调试信息，帮助理解对象的生命周期
-    std::cout << "[COM] SimpleCalculator 对象被创建，引用计数 = " << m_refCount << std::endl;
+    COM_LOG_DEBUG("[COM] SimpleCalculator 对象被创建，引用计数 = {}", m_refCount.Get());
 }
 
 
@@ -25,7 +28,7 @@ SimpleCalculator::SimpleCalculator()
 SimpleCalculator::~SimpleCalculator()
 {
     // 输出调试信息
-    std::cout << "[COM] SimpleCalculator 对象被销毁" << std::endl;
+    COM_LOG_DEBUG("[COM] SimpleCalculator 对象被销毁");
 }
 
 
@@ -33,52 +36,34 @@ SimpleCalculator::~SimpleCalculator()
 // QueryInterface：查询接口
 // 这是 COM 的核心机制之一
 // =====================================================
-HRESULT __stdcall SimpleCalculator::QueryInterface(REFIID riid, void** ppvObject)
-{
-    // 首先检查输出参数是否有效
-    if (ppvObject == nullptr)
-    {
-        // 如果传入的指针是空的，返回错误
-        return E_POINTER;
-    }
 
-    // 初始化输出参数为 nullptr
-    *ppvObject = nullptr;
-
-    // 检查客户端请求的是哪个接口
-
-    // 情况1：客户端请求 IUnknown 接口
-    // 所有 COM 对象都支持 IUnknown
-    if (riid == IID_IUnknown)
-    {
-        // 将 this 指针转换为 IUnknown* 类型
-        // 注意：我们转换为 ISimpleCalculator* 再赋值
-        // 因为 ISimpleCalculator 继承自 IUnknown
-        *ppvObject = static_cast<ISimpleCalculator*>(this);
-
-        std::cout << "[COM] QueryInterface: 返回 IUnknown 接口" << std::endl;
-    }
-    // 情况2：客户端请求我们自定义的 ISimpleCalculator 接口
-    else if (riid == IID_ISimpleCalculator)
-    {
-        // 将 this 指针转换为 ISimpleCalculator* 类型
-        *ppvObject = static_cast<ISimpleCalculator*>(this);
-
-        std::cout << "[COM] QueryInterface: 返回 ISimpleCalculator 接口" << std::endl;
-    }
-    // 情况3：客户端请求的接口我们不支持
-    else
-    {
-        std::cout << "[COM] QueryInterface: 不支持请求的接口" << std::endl;
-        return E_NOINTERFACE;  // 返回"不支持此接口"的错误码
-    }
-
-    // 如果成功返回了接口指针，必须增加引用计数
-    // 这是 COM 的重要规则：每次给出接口指针都要 AddRef
-    AddRef();
+// 接口表：列出这个对象支持的所有接口
+// 每一行是 {接口 ID, 如何把 this 转换成该接口指针}
+//
+// 情况1：客户端请求我们自定义的 ISimpleCalculator 接口
+//        （最常请求的接口放在最前面，查找最快）
+// 情况2：客户端请求 IUnknown 接口
+//        所有 COM 对象都支持 IUnknown
+//        注意：我们经由 ISimpleCalculator 转换，因为 ISimpleCalculator 继承自 IUnknown
+// 情况3：表里没有的接口 —— 不支持，返回 E_NOINTERFACE
+//
+// 新增接口时只需要在表里加一行
+static constexpr InterfaceEntry s_simpleCalculatorInterfaces[] =
+{
+    COM_INTERFACE_ENTRY(SimpleCalculator, ISimpleCalculator),
+    COM_INTERFACE_ENTRY2(SimpleCalculator, IUnknown, ISimpleCalculator),
+};
+static constinit InterfaceMap s_simpleCalculatorMap("[COM]", s_simpleCalculatorInterfaces);
 
-    // S_OK 表示操作成功
-    return S_OK;
+HRESULT __stdcall SimpleCalculator::QueryInterface(REFIID riid, void** ppvObject)
+{
+    // InterfaceMap::Query 完成了 QueryInterface 的全部标准步骤：
+    //   1. 检查输出参数是否有效（空指针返回 E_POINTER）
+    //   2. 初始化输出参数为 nullptr
+    //   3. 在接口表中查找 riid，找不到返回 E_NOINTERFACE
+    //   4. 成功返回接口指针后调用 AddRef
+    //      这是 COM 的重要规则：每次给出接口指针都要 AddRef
+    return s_simpleCalculatorMap.Query(this, riid, ppvObject);
 }
 
 
@@ -88,14 +73,16 @@ HRESULT __stdcall SimpleCalculator::QueryInterface(REFIID riid, void** ppvObject
 ULONG __stdcall SimpleCalculator::AddRef()
 {
     // 增加引用计数（原子操作，线程安全）
-    // InterlockedIncrement 是 Windows API，保证多线程环境下的安全
-    // 但为了简单，我们直接使用 ++
-    m_refCount++;
+    // 作用和 Windows API InterlockedIncrement 一样，详见 RefCount.h
+    ULONG count = m_refCount.Increment();
+
+    // 剖析模式下记录调用者的地址（必须写在 AddRef 里面）
+    COM_REF_PROFILE(RefEvent_AddRef, "SimpleCalculator", this, count);
 
-    std::cout << "[COM] AddRef 调用，引用计数 = " << m_refCount << std::endl;
+    COM_LOG_TRACE("[COM] AddRef 调用，引用计数 = {}", count);
 
     // 返回新的引用计数值
-    return m_refCount;
+    return count;
 }
 
 
@@ -106,14 +93,18 @@ ULONG __stdcall SimpleCalculator::AddRef()
 ULONG __stdcall SimpleCalculator::Release()
 {
     // 减少引用计数
-    m_refCount--;
+    // 注意：必须使用 Decrement 的返回值，之后再读 m_refCount 是不安全的
+    // （另一个线程可能刚好把计数减到 0 并销毁了对象）
+    ULONG count = m_refCount.Decrement();
+
+    COM_REF_PROFILE(RefEvent_Release, "SimpleCalculator", this, count);
 
-    std::cout << "[COM] Release 调用，引用计数 = " << m_refCount << std::endl;
+    COM_LOG_TRACE("[COM] Release 调用，引用计数 = {}", count);
 
     // 如果引用计数降为 0，说明没有人再使用这个对象了
-    if (m_refCount == 0)
+    if (count == 0)
     {
-        std::cout << "[COM] 引用计数为 0，准备销毁对象" << std::endl;
+        COM_LOG_TRACE("[COM] 引用计数为 0，准备销毁对象");
 
         // 删除自己（调用析构函数）
         delete this;
@@ -123,7 +114,7 @@ ULONG __stdcall SimpleCalculator::Release()
     }
 
     // 返回当前引用计数
-    return m_refCount;
+    return count;
 }
 
 
@@ -132,7 +123,7 @@ ULONG __stdcall SimpleCalculator::Release()
 // =====================================================
 HRESULT __stdcall SimpleCalculator::Add(int a, int b, int* result)
 {
-    std::cout << "[COM] Add 方法被调用: " << a << " + " << b << std::endl;
+    COM_LOG_TRACE("[COM] Add 方法被调用: {} + {}", a, b);
 
     // 检查输出参数是否有效
     if (result == nullptr)
@@ -144,7 +135,7 @@ HRESULT __stdcall SimpleCalculator::Add(int a, int b, int* result)
     // 执行加法运算
     *result = a + b;
 
-    std::cout << "[COM] Add 方法返回结果: " << *result << std::endl;
+    COM_LOG_TRACE("[COM] Add 方法返回结果: {}", *result);
 
     // S_OK 表示操作成功
     return S_OK;
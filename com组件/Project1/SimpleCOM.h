@@ -3,11 +3,11 @@
 
 #pragma once  // 防止头文件被重复包含
 
-// 包含 Windows 基础头文件
-#include <Windows.h>
+// 包含 COM 基础头文件（Windows 上是 Windows.h / unknwn.h，其他平台是最小替身）
+#include "ComPlatform.h"
 
-// 包含 COM 基础头文件
-#include <objbase.h>
+// 线程安全的引用计数
+#include "RefCount.h"
 
 
 // =====================================================
@@ -64,7 +64,8 @@ private:
     // 引用计数器：记录有多少客户端在使用这个对象
     // COM 使用引用计数来管理对象的生命周期
     // 当引用计数为 0 时，对象会自动销毁
-    ULONG m_refCount;
+    // 使用原子操作，多个线程同时 AddRef/Release 也是安全的
+    RefCount m_refCount;
 
 public:
     // 构造函数：初始化引用计数为 1
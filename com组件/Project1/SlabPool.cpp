@@ -0,0 +1,215 @@
+// SlabPool.cpp - slab 分配器实现
+#include "SlabPool.h"
+#include <cstdlib>
+
+namespace
+{
+    const int kMaxPools = 16;  // 每个线程最多同时使用的池数，超出的池退化为 malloc
+
+    // 块头：放在对象前面，16 字节，保证对象本身 16 字节对齐
+    struct BlockHeader
+    {
+        SlabPool::ThreadCache* owner;  // 所属线程缓存；nullptr 表示直接 malloc 的块
+        BlockHeader*           next;   // 空闲时的链表指针
+    };
+
+    const size_t kHeaderSize = 16;
+    static_assert(sizeof(BlockHeader) <= kHeaderSize, "block header too large");
+
+    inline void* Payload(BlockHeader* block)
+    {
+        return reinterpret_cast<char*>(block) + kHeaderSize;
+    }
+
+    inline BlockHeader* HeaderOf(void* p)
+    {
+        return reinterpret_cast<BlockHeader*>(static_cast<char*>(p) - kHeaderSize);
+    }
+}
+
+struct SlabPool::ThreadCache
+{
+    ThreadCache*        next = nullptr;       // 池的缓存链表
+    BlockHeader*        localFree = nullptr;  // 只由所属线程访问
+    std::atomic<size_t> inUse{ 0 };           // 只由所属线程写，统计时其他线程读
+    std::atomic<size_t> highWater{ 0 };
+    std::atomic<size_t> capacity{ 0 };
+    std::atomic<bool>   orphaned{ false };
+
+    alignas(64) std::atomic<BlockHeader*> remoteFree{ nullptr };  // 其他线程释放的块
+};
+
+namespace
+{
+    // 每个线程的缓存表，下标是池的 id
+    thread_local bool t_exited = false;
+
+    struct ThreadCacheTable
+    {
+        SlabPool::ThreadCache* caches[kMaxPools] = {};
+
+        ~ThreadCacheTable()
+        {
+            for (SlabPool::ThreadCache* cache : caches)
+            {
+                if (cache) cache->orphaned.store(true, std::memory_order_release);
+            }
+            t_exited = true;
+        }
+    };
+
+    thread_local ThreadCacheTable t_table;
+}
+
+std::atomic<int> SlabPool::s_nextId{ 0 };
+
+SlabPool::SlabPool(size_t objectSize, size_t objectsPerSlab)
+    : m_blockSize((kHeaderSize + objectSize + 15) / 16 * 16)
+    , m_objectsPerSlab(objectsPerSlab ? objectsPerSlab : 1)
+    , m_id(s_nextId.fetch_add(1, std::memory_order_relaxed))
+    , m_caches(nullptr)
+    , m_slabs(0)
+    , m_remoteFrees(0)
+{
+}
+
+void* SlabPool::Allocate()
+{
+    ThreadCache* cache = GetCache();
+    if (!cache)  // 线程正在退出，或池太多：直接 malloc
+    {
+        BlockHeader* block = static_cast<BlockHeader*>(std::malloc(m_blockSize));
+        if (!block) return nullptr;
+        block->owner = nullptr;
+        return Payload(block);
+    }
+
+    if (!cache->localFree && !Refill(cache)) return nullptr;
+
+    BlockHeader* block = cache->localFree;
+    cache->localFree = block->next;
+
+    size_t used = cache->inUse.load(std::memory_order_relaxed) + 1;
+    cache->inUse.store(used, std::memory_order_relaxed);
+    if (used > cache->highWater.load(std::memory_order_relaxed))
+        cache->highWater.store(used, std::memory_order_relaxed);
+
+    return Payload(block);
+}
+
+void SlabPool::Free(void* p)
+{
+    if (!p) return;
+
+    BlockHeader* block = HeaderOf(p);
+    ThreadCache* owner = block->owner;
+    if (!owner)
+    {
+        std::free(block);
+        return;
+    }
+
+    if (!t_exited && t_table.caches[m_id] == owner)  // 本线程的块：直接放回本地链表
+    {
+        block->next = owner->localFree;
+        owner->localFree = block;
+        owner->inUse.store(owner->inUse.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+        return;
+    }
+
+    // 其他线程的块：无锁压入所属缓存的远程链表
+    // 所属线程一次性取走整个链表（exchange），所以这里没有 ABA 问题
+    BlockHeader* head = owner->remoteFree.load(std::memory_order_relaxed);
+    do
+    {
+        block->next = head;
+    } while (!owner->remoteFree.compare_exchange_weak(head, block,
+                                                      std::memory_order_release,
+                                                      std::memory_order_relaxed));
+    m_remoteFrees.fetch_add(1, std::memory_order_relaxed);
+}
+
+SlabPool::ThreadCache* SlabPool::GetCache()
+{
+    if (t_exited || m_id >= kMaxPools) return nullptr;
+
+    ThreadCache* cache = t_table.caches[m_id];
+    if (!cache) cache = CreateOrAdoptCache();
+    return cache;
+}
+
+SlabPool::ThreadCache* SlabPool::CreateOrAdoptCache()
+{
+    ThreadCache* cache = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        // 优先接管已退出线程留下的缓存，它的空闲块和远程链表都可以继续使用
+        for (ThreadCache* c = m_caches; c; c = c->next)
+        {
+            if (c->orphaned.load(std::memory_order_acquire))
+            {
+                c->orphaned.store(false, std::memory_order_relaxed);
+                cache = c;
+                break;
+            }
+        }
+
+        if (!cache)
+        {
+            cache = new ThreadCache();
+            cache->next = m_caches;
+            m_caches = cache;
+        }
+    }
+
+    t_table.caches[m_id] = cache;
+    return cache;
+}
+
+// 本地链表为空时调用：先取回其他线程释放的块，还没有再分配新的 slab
+bool SlabPool::Refill(ThreadCache* cache)
+{
+    BlockHeader* list = cache->remoteFree.exchange(nullptr, std::memory_order_acquire);
+    if (list)
+    {
+        size_t count = 0;
+        for (BlockHeader* b = list; b; b = b->next) ++count;
+        cache->localFree = list;
+        cache->inUse.store(cache->inUse.load(std::memory_order_relaxed) - count, std::memory_order_relaxed);
+        return true;
+    }
+
+    char* slab = static_cast<char*>(std::malloc(m_blockSize * m_objectsPerSlab));
+    if (!slab) return false;
+
+    for (size_t i = m_objectsPerSlab; i-- > 0;)
+    {
+        BlockHeader* block = reinterpret_cast<BlockHeader*>(slab + i * m_blockSize);
+        block->owner = cache;
+        block->next = cache->localFree;
+        cache->localFree = block;
+    }
+    cache->capacity.store(cache->capacity.load(std::memory_order_relaxed) + m_objectsPerSlab,
+                          std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(m_lock);
+    ++m_slabs;
+    return true;
+}
+
+PoolStats SlabPool::GetStats() const
+{
+    PoolStats stats = {};
+    std::lock_guard<std::mutex> lock(m_lock);
+    stats.slabs = m_slabs;
+    stats.remoteFrees = m_remoteFrees.load(std::memory_order_relaxed);
+    for (ThreadCache* c = m_caches; c; c = c->next)
+    {
+        stats.capacity += c->capacity.load(std::memory_order_relaxed);
+        stats.inUse += c->inUse.load(std::memory_order_relaxed);
+        stats.highWater += c->highWater.load(std::memory_order_relaxed);
+        ++stats.threadCaches;
+    }
+    return stats;
+}
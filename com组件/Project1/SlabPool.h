@@ -0,0 +1,60 @@
+// SlabPool.h - 固定大小对象的 slab 分配器
+// =====================================================
+// 用于频繁创建/销毁的小对象（例如 Calculator）：
+//   - 一次 malloc 一整块 slab，切成 N 个固定大小的块
+//   - 每个线程有自己的缓存（空闲链表），分配和本线程释放都不需要加锁、不需要原子 RMW
+//   - 其他线程释放的块挂到所属缓存的"远程释放"链表（无锁压栈），
+//     所属线程在本地链表用完时一次性取回
+//   - 稳定状态下（slab 已经够用）分配/释放都不会调用 malloc/free
+//
+// 线程退出后它的缓存被标记为"孤儿"，由之后第一个需要缓存的线程接管
+// slab 在进程结束前不归还给系统
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+// 对象池统计
+struct PoolStats
+{
+    size_t   slabs;         // 已分配的 slab 数
+    size_t   capacity;      // 总块数
+    size_t   inUse;         // 正在使用的块数（其他线程刚释放、尚未取回的块仍计入）
+    size_t   highWater;     // 各线程缓存使用量峰值之和（全局峰值的上界）
+    size_t   threadCaches;  // 线程缓存数（含孤儿）
+    uint64_t remoteFrees;   // 跨线程释放次数
+};
+
+class SlabPool
+{
+public:
+    struct ThreadCache;
+
+    SlabPool(size_t objectSize, size_t objectsPerSlab = 64);
+
+    SlabPool(const SlabPool&) = delete;
+    SlabPool& operator=(const SlabPool&) = delete;
+
+    // 分配失败返回 nullptr
+    void* Allocate();
+    void Free(void* p);
+
+    PoolStats GetStats() const;
+
+private:
+    ThreadCache* GetCache();
+    ThreadCache* CreateOrAdoptCache();
+    bool Refill(ThreadCache* cache);
+
+    const size_t m_blockSize;
+    const size_t m_objectsPerSlab;
+    const int    m_id;  // 线程局部缓存表中的下标
+
+    mutable std::mutex m_lock;    // 只保护缓存链表和 slab 分配
+    ThreadCache*       m_caches;  // 所有线程缓存（单向链表，只增不减）
+    size_t             m_slabs;
+    std::atomic<uint64_t> m_remoteFrees;
+
+    static std::atomic<int> s_nextId;
+};
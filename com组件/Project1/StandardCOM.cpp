@@ -1,96 +1,267 @@
 // StandardCOM.cpp - 标准 COM 组件实现
 #include "StandardCOM.h"
-#include <iostream>
+#include "BatchKernels.h"
+#include "ClassRegistry.h"
+#include "ComLog.h"
+#include "ComModule.h"
+#include "Expression.h"
+#include "InterfaceMap.h"
+#include "RefProfiler.h"
+#include "TearOff.h"
+#include <new>
 
 // ========================================
 // Calculator 实现
 // ========================================
 
+// 对象池故意不销毁：进程退出时可能还有对象没有释放
+static SlabPool& CalculatorPool()
+{
+    static SlabPool* pool = new SlabPool(sizeof(Calculator));
+    return *pool;
+}
+
+PoolStats GetCalculatorPoolStats()
+{
+    return CalculatorPool().GetStats();
+}
+
+void* Calculator::operator new(size_t size) noexcept
+{
+    if (size != sizeof(Calculator)) return ::operator new(size, std::nothrow);  // 派生类大小不同
+    return CalculatorPool().Allocate();
+}
+
+void Calculator::operator delete(void* p, size_t size) noexcept
+{
+    if (size != sizeof(Calculator))
+    {
+        ::operator delete(p);
+        return;
+    }
+    CalculatorPool().Free(p);
+}
+
 Calculator::Calculator() : m_refCount(1)  // 初始引用计数为 1
 {
-    std::cout << "[Calculator] 对象创建, RefCount = " << m_refCount << std::endl;
+    ComModule::AddObject();  // 对象存在期间模块不能卸载
+    COM_REF_PROFILE(RefEvent_Create, "Calculator", this, 1);
+    COM_LOG_DEBUG("[Calculator] 对象创建, RefCount = {}", m_refCount.Get());
 }
 
 Calculator::~Calculator()
 {
-    std::cout << "[Calculator] 对象销毁" << std::endl;
+    COM_LOG_DEBUG("[Calculator] 对象销毁");
+    ComModule::ReleaseObject();
 }
 
-HRESULT __stdcall Calculator::QueryInterface(REFIID riid, void** ppvObject)
+// ICalculatorDiagnostics 的 tear-off 对象：QueryInterface 请求时才创建
+class CalculatorDiagnostics : public TearOff<Calculator, ICalculatorDiagnostics, IID_ICalculatorDiagnostics>
 {
-    if (!ppvObject) return E_POINTER;  // 参数检查
-    *ppvObject = nullptr;
+public:
+    explicit CalculatorDiagnostics(Calculator* owner) : TearOff(owner)
+    {
+    }
 
-    if (riid == IID_IUnknown)  // 请求 IUnknown
+    virtual HRESULT __stdcall GetRefCount(ULONG* count) override
     {
-        *ppvObject = static_cast<ICalculator*>(this);
-        std::cout << "[Calculator] QueryInterface -> IUnknown" << std::endl;
+        if (!count) return E_POINTER;
+        *count = m_owner->m_refCount.Get() - 1;  // 减去本对象持有的引用
+        return S_OK;
     }
-    else if (riid == IID_ICalculator)  // 请求 ICalculator
+
+    virtual HRESULT __stdcall GetPoolStats(PoolStats* stats) override
     {
-        *ppvObject = static_cast<ICalculator*>(this);
-        std::cout << "[Calculator] QueryInterface -> ICalculator" << std::endl;
+        if (!stats) return E_POINTER;
+        *stats = GetCalculatorPoolStats();
+        return S_OK;
     }
-    else  // 不支持的接口
+
+    virtual HRESULT __stdcall GetBatchKernel(const char** name) override
     {
-        std::cout << "[Calculator] QueryInterface -> E_NOINTERFACE" << std::endl;
-        return E_NOINTERFACE;
+        if (!name) return E_POINTER;
+        *name = GetBestBatchKernels().name;
+        return S_OK;
     }
+};
 
-    AddRef();  // 成功返回接口，增加引用计数
-    return S_OK;
+// IExpressionCalculator 的 tear-off 对象：表达式和缓存与具体的 Calculator 对象无关（见 Expression.h）
+class CalculatorExpressions : public TearOff<Calculator, IExpressionCalculator, IID_IExpressionCalculator>
+{
+public:
+    explicit CalculatorExpressions(Calculator* owner) : TearOff(owner)
+    {
+    }
+
+    virtual HRESULT __stdcall Compile(const char* source, IExpression** ppExpr) override
+    {
+        return Expression::Compile(source, ppExpr);
+    }
+
+    virtual HRESULT __stdcall Evaluate(const char* source, const int* vars, size_t count, int* result) override
+    {
+        return Expression::Evaluate(source, vars, count, result);
+    }
+};
+
+#if COM_ENABLE_STATS
+// IStatistics 的 tear-off 对象：数据是整个模块的，Calculator 和 CalculatorFactory 共用
+template <class Owner>
+class ModuleStatistics : public TearOff<Owner, IStatistics, IID_IStatistics>
+{
+public:
+    explicit ModuleStatistics(Owner* owner) : TearOff<Owner, IStatistics, IID_IStatistics>(owner)
+    {
+    }
+
+    virtual HRESULT __stdcall GetSnapshot(CallStats* stats, size_t capacity, size_t* count) override
+    {
+        if (!stats && capacity) return E_POINTER;
+        CallStats all[Stat_Count];
+        Statistics::Snapshot(all);
+        for (size_t i = 0; i < capacity && i < Stat_Count; ++i) stats[i] = all[i];
+        if (count) *count = Stat_Count;
+        return capacity < Stat_Count ? S_FALSE : S_OK;
+    }
+
+    virtual HRESULT __stdcall Reset() override
+    {
+        Statistics::Reset();
+        return S_OK;
+    }
+};
+#endif
+
+// 接口表：最常请求的 ICalculator 放在最前面，新增接口只需加一行
+static constexpr InterfaceEntry s_calculatorInterfaces[] =
+{
+    COM_INTERFACE_ENTRY(Calculator, ICalculator),
+    COM_INTERFACE_ENTRY2(Calculator, IUnknown, ICalculator),
+    COM_INTERFACE_ENTRY(Calculator, IBatchCalculator),
+    COM_INTERFACE_ENTRY(Calculator, IBatchCalculator2),
+    COM_INTERFACE_ENTRY(Calculator, IAsyncCalculator),
+    COM_INTERFACE_ENTRY_TEAR_OFF(Calculator, IExpressionCalculator, CalculatorExpressions),
+    COM_INTERFACE_ENTRY_TEAR_OFF(Calculator, ICalculatorDiagnostics, CalculatorDiagnostics),
+#if COM_ENABLE_STATS
+    COM_INTERFACE_ENTRY_TEAR_OFF(Calculator, IStatistics, ModuleStatistics<Calculator>),
+#endif
+};
+static constinit InterfaceMap s_calculatorMap("[Calculator]", s_calculatorInterfaces);
+
+HRESULT __stdcall Calculator::QueryInterface(REFIID riid, void** ppvObject)
+{
+    COM_STATS_SCOPE(Stat_QueryInterface);
+    return s_calculatorMap.Query(this, riid, ppvObject);  // 查表，成功时 AddRef
 }
 
 ULONG __stdcall Calculator::AddRef()
 {
-    m_refCount++;
-    std::cout << "[Calculator] AddRef, RefCount = " << m_refCount << std::endl;
-    return m_refCount;
+    ULONG count = m_refCount.Increment();
+    COM_REF_PROFILE(RefEvent_AddRef, "Calculator", this, count);
+    COM_LOG_TRACE("[Calculator] AddRef, RefCount = {}", count);
+    return count;
 }
 
 ULONG __stdcall Calculator::Release()
 {
-    m_refCount--;
-    std::cout << "[Calculator] Release, RefCount = " << m_refCount << std::endl;
+    ULONG count = m_refCount.Decrement();  // 之后不能再读 m_refCount，其他线程可能已经把对象销毁
+    COM_REF_PROFILE(RefEvent_Release, "Calculator", this, count);  // 只用 this 的值作标识，不访问对象
+    COM_LOG_TRACE("[Calculator] Release, RefCount = {}", count);
 
-    if (m_refCount == 0)  // 引用计数为 0，销毁对象
+    if (count == 0)  // 引用计数为 0，销毁对象
     {
         delete this;
         return 0;
     }
-    return m_refCount;
+    return count;
 }
 
+// ICalculator 的方法只是包装：参数检查和运算都在 CalculatorCore 里，与直接调用的行为完全相同
+
 HRESULT __stdcall Calculator::Add(int a, int b, int* result)
 {
-    if (!result) return E_POINTER;  // 参数检查
-    *result = a + b;
-    std::cout << "[Calculator] Add: " << a << " + " << b << " = " << *result << std::endl;
-    return S_OK;
+    COM_STATS_SCOPE(Stat_Add);
+    return Core::Add(a, b, result);
 }
 
 HRESULT __stdcall Calculator::Subtract(int a, int b, int* result)
 {
-    if (!result) return E_POINTER;
-    *result = a - b;
-    std::cout << "[Calculator] Subtract: " << a << " - " << b << " = " << *result << std::endl;
-    return S_OK;
+    COM_STATS_SCOPE(Stat_Subtract);
+    return Core::Subtract(a, b, result);
 }
 
 HRESULT __stdcall Calculator::Multiply(int a, int b, int* result)
 {
-    if (!result) return E_POINTER;
-    *result = a * b;
-    std::cout << "[Calculator] Multiply: " << a << " * " << b << " = " << *result << std::endl;
-    return S_OK;
+    COM_STATS_SCOPE(Stat_Multiply);
+    return Core::Multiply(a, b, result);
 }
 
 HRESULT __stdcall Calculator::Divide(int a, int b, int* result)
 {
-    if (!result) return E_POINTER;
-    if (b == 0) return E_INVALIDARG;  // 除数为 0
-    *result = a / b;
-    std::cout << "[Calculator] Divide: " << a << " / " << b << " = " << *result << std::endl;
+    COM_STATS_SCOPE(Stat_Divide);
+    return Core::Divide(a, b, result);
+}
+
+// 批量运算：整个数组只有一次虚函数调用和一次参数检查
+
+HRESULT __stdcall Calculator::AddN(const int* a, const int* b, int* out, size_t n)
+{
+    if (n == 0) return S_OK;
+    if (!a || !b || !out) return E_POINTER;
+    const BatchKernelTable& kernels = GetBestBatchKernels();
+    kernels.add(a, b, out, n);
+    COM_LOG_TRACE("[Calculator] AddN: n = {} ({})", n, kernels.name);
+    return S_OK;
+}
+
+HRESULT __stdcall Calculator::SubtractN(const int* a, const int* b, int* out, size_t n)
+{
+    if (n == 0) return S_OK;
+    if (!a || !b || !out) return E_POINTER;
+    const BatchKernelTable& kernels = GetBestBatchKernels();
+    kernels.sub(a, b, out, n);
+    COM_LOG_TRACE("[Calculator] SubtractN: n = {} ({})", n, kernels.name);
+    return S_OK;
+}
+
+HRESULT __stdcall Calculator::MultiplyN(const int* a, const int* b, int* out, size_t n)
+{
+    if (n == 0) return S_OK;
+    if (!a || !b || !out) return E_POINTER;
+    const BatchKernelTable& kernels = GetBestBatchKernels();
+    kernels.mul(a, b, out, n);
+    COM_LOG_TRACE("[Calculator] MultiplyN: n = {} ({})", n, kernels.name);
+    return S_OK;
+}
+
+HRESULT __stdcall Calculator::DivideN(const int* a, const int* b, int* out, size_t n)
+{
+    if (n == 0) return S_OK;
+    if (!a || !b || !out) return E_POINTER;
+    const BatchKernelTable& kernels = GetBestBatchKernels();
+    if (kernels.hasZero(b, n)) return E_INVALIDARG;  // 与 Divide 一致：除数为 0
+    kernels.div(a, b, out, n);
+    COM_LOG_TRACE("[Calculator] DivideN: n = {} ({})", n, kernels.name);
+    return S_OK;
+}
+
+HRESULT __stdcall Calculator::PrepareDivisor(int divisor, BatchDivisor* prepared)
+{
+    if (!prepared) return E_POINTER;
+    if (!PrepareBatchDivisor(divisor, prepared)) return E_INVALIDARG;  // 与 Divide 一致：除数为 0
+    COM_LOG_TRACE("[Calculator] PrepareDivisor: {} -> magic = {}, shift = {}", divisor, prepared->magic, prepared->shift);
+    return S_OK;
+}
+
+HRESULT __stdcall Calculator::DivideByN(const int* a, const BatchDivisor* divisor, int* out, size_t n)
+{
+    if (!divisor) return E_POINTER;
+    if (divisor->divisor == 0) return E_INVALIDARG;  // 没有经过 PrepareDivisor
+    if (n == 0) return S_OK;
+    if (!a || !out) return E_POINTER;
+    const BatchKernelTable& kernels = GetBestBatchKernels();
+    kernels.divBy(a, *divisor, out, n);
+    COM_LOG_TRACE("[Calculator] DivideByN: n = {}, divisor = {} ({})", n, divisor->divisor, kernels.name);
     return S_OK;
 }
 
@@ -101,83 +272,91 @@ HRESULT __stdcall Calculator::Divide(int a, int b, int* result)
 
 CalculatorFactory::CalculatorFactory() : m_refCount(1)
 {
-    std::cout << "[Factory] 工厂创建, RefCount = " << m_refCount << std::endl;
+    COM_REF_PROFILE(RefEvent_Create, "Factory", this, 1);
+    COM_LOG_DEBUG("[Factory] 工厂创建, RefCount = {}", m_refCount.Get());
 }
 
 CalculatorFactory::~CalculatorFactory()
 {
-    std::cout << "[Factory] 工厂销毁" << std::endl;
+    COM_LOG_DEBUG("[Factory] 工厂销毁");
 }
 
-HRESULT __stdcall CalculatorFactory::QueryInterface(REFIID riid, void** ppvObject)
+static constexpr InterfaceEntry s_factoryInterfaces[] =
 {
-    if (!ppvObject) return E_POINTER;
-    *ppvObject = nullptr;
+    COM_INTERFACE_ENTRY(CalculatorFactory, IClassFactory),
+    COM_INTERFACE_ENTRY2(CalculatorFactory, IUnknown, IClassFactory),
+#if COM_ENABLE_STATS
+    COM_INTERFACE_ENTRY_TEAR_OFF(CalculatorFactory, IStatistics, ModuleStatistics<CalculatorFactory>),
+#endif
+};
+static constinit InterfaceMap s_factoryMap("[Factory]", s_factoryInterfaces);
 
-    if (riid == IID_IUnknown)  // 请求 IUnknown
-    {
-        *ppvObject = static_cast<IClassFactory*>(this);
-        std::cout << "[Factory] QueryInterface -> IUnknown" << std::endl;
-    }
-    else if (riid == IID_IClassFactory)  // 请求 IClassFactory
-    {
-        *ppvObject = static_cast<IClassFactory*>(this);
-        std::cout << "[Factory] QueryInterface -> IClassFactory" << std::endl;
-    }
-    else
-    {
-        std::cout << "[Factory] QueryInterface -> E_NOINTERFACE" << std::endl;
-        return E_NOINTERFACE;
-    }
-
-    AddRef();
-    return S_OK;
+HRESULT __stdcall CalculatorFactory::QueryInterface(REFIID riid, void** ppvObject)
+{
+    COM_STATS_SCOPE(Stat_QueryInterface);
+    return s_factoryMap.Query(this, riid, ppvObject);
 }
 
+// 注册表持有一个引用；其余引用都在客户端手里，客户端持有类工厂期间模块不能卸载
 ULONG __stdcall CalculatorFactory::AddRef()
 {
-    m_refCount++;
-    std::cout << "[Factory] AddRef, RefCount = " << m_refCount << std::endl;
-    return m_refCount;
+    ULONG count = m_refCount.Increment();
+    if (count == 2) ComModule::Lock();
+    COM_REF_PROFILE(RefEvent_AddRef, "Factory", this, count);
+    COM_LOG_TRACE("[Factory] AddRef, RefCount = {}", count);
+    return count;
 }
 
 ULONG __stdcall CalculatorFactory::Release()
 {
-    m_refCount--;
-    std::cout << "[Factory] Release, RefCount = " << m_refCount << std::endl;
+    ULONG count = m_refCount.Decrement();
+    if (count == 1) ComModule::Unlock();
+    COM_REF_PROFILE(RefEvent_Release, "Factory", this, count);
+    COM_LOG_TRACE("[Factory] Release, RefCount = {}", count);
 
-    if (m_refCount == 0)
+    if (count == 0)
     {
         delete this;
         return 0;
     }
-    return m_refCount;
+    return count;
 }
 
 HRESULT __stdcall CalculatorFactory::CreateInstance(IUnknown* pUnkOuter, REFIID riid, void** ppvObject)
 {
-    std::cout << "\n[Factory] CreateInstance 开始..." << std::endl;
+    COM_STATS_SCOPE(Stat_CreateInstance);
+    COM_LOG_TRACE("\n[Factory] CreateInstance 开始...");
 
     if (pUnkOuter != nullptr) return CLASS_E_NOAGGREGATION;  // 不支持聚合
     if (!ppvObject) return E_POINTER;
 
     *ppvObject = nullptr;
 
-    Calculator* pCalc = new Calculator();  // 创建 Calculator 对象
+    ComPtr<Calculator> pCalc;
+    pCalc.Attach(new Calculator());  // 接管初始引用（引用计数为 1）
     if (!pCalc) return E_OUTOFMEMORY;
 
-    HRESULT hr = pCalc->QueryInterface(riid, ppvObject);  // 获取请求的接口
-    pCalc->Release();  // 释放初始引用（QueryInterface 已经 AddRef）
+    // 普通接口：初始引用直接交给调用者，不需要 QueryInterface（AddRef）再 Release，没有原子操作
+    if (void* pItf = s_calculatorMap.Find(pCalc.Get(), riid))
+    {
+        *ppvObject = pItf;
+        pCalc.Detach();
+        COM_LOG_TRACE("[Factory] CreateInstance 完成\n");
+        return S_OK;
+    }
 
-    std::cout << "[Factory] CreateInstance 完成\n" << std::endl;
+    // tear-off 或不支持的接口：按标准流程 QueryInterface，初始引用在 pCalc 析构时释放
+    HRESULT hr = pCalc->QueryInterface(riid, ppvObject);
+    COM_LOG_TRACE("[Factory] CreateInstance 完成\n");
     return hr;
 }
 
 HRESULT __stdcall CalculatorFactory::LockServer(BOOL fLock)
 {
-    // 在真实的 COM DLL 中，这里会增加/减少全局锁计数
-    // 防止 DLL 在使用时被卸载
-    std::cout << "[Factory] LockServer: " << (fLock ? "LOCK" : "UNLOCK") << std::endl;
+    // 增加/减少模块的锁计数，防止模块在客户端还要用时被卸载
+    if (fLock) ComModule::Lock();
+    else ComModule::Unlock();
+    COM_LOG_DEBUG("[Factory] LockServer: {}, 锁计数 = {}", fLock ? "LOCK" : "UNLOCK", ComModule::LockCount());
     return S_OK;
 }
 
@@ -186,21 +365,28 @@ HRESULT __stdcall CalculatorFactory::LockServer(BOOL fLock)
 // 全局函数：模拟 DllGetClassObject
 // ========================================
 
-HRESULT DllGetClassObject(REFCLSID rclsid, REFIID riid, void** ppv)
+// 模块加载时创建 Calculator 的类工厂并注册，之后所有 DllGetClassObject 共用这一个工厂
+static ClassObjectRegistration s_calculatorClass(CLSID_Calculator, new CalculatorFactory());
+
+extern "C" HRESULT __stdcall DllGetClassObject(REFCLSID rclsid, REFIID riid, void** ppv)
 {
-    std::cout << "\n[DllGetClassObject] 请求类工厂..." << std::endl;
+    COM_STATS_SCOPE(Stat_DllGetClassObject);
+    COM_LOG_TRACE("\n[DllGetClassObject] 请求类工厂...");
 
-    if (rclsid != CLSID_Calculator) return CLASS_E_CLASSNOTAVAILABLE;  // 不支持的 CLSID
+    IClassFactory* pFactory = ClassRegistry::Find(rclsid);  // 哈希查表，不分配内存
+    if (!pFactory) return CLASS_E_CLASSNOTAVAILABLE;  // 不支持的 CLSID
     if (!ppv) return E_POINTER;
 
     *ppv = nullptr;
 
-    CalculatorFactory* pFactory = new CalculatorFactory();  // 创建类工厂
-    if (!pFactory) return E_OUTOFMEMORY;
-
-    HRESULT hr = pFactory->QueryInterface(riid, ppv);  // 获取工厂接口
-    pFactory->Release();  // 释放初始引用
+    HRESULT hr = pFactory->QueryInterface(riid, ppv);  // 获取工厂接口（AddRef）
 
-    std::cout << "[DllGetClassObject] 返回类工厂\n" << std::endl;
+    COM_LOG_TRACE("[DllGetClassObject] 返回类工厂\n");
     return hr;
 }
+
+// 没有对象、没有锁、也没有启动后台线程时，加载器可以卸载本模块
+extern "C" HRESULT __stdcall DllCanUnloadNow()
+{
+    return ComModule::CanUnloadNow();
+}
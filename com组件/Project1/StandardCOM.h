@@ -1,12 +1,43 @@
 // StandardCOM.h - 标准 COM 组件定义
 #pragma once
-#include <Windows.h>
-#include <unknwn.h>  // IClassFactory 在这里已经定义
+#include "ComPlatform.h"  // Windows.h / unknwn.h（IClassFactory 在这里已经定义）
+#include "BatchKernels.h"
+#include "CalculatorCore.h"
+#include "ComLog.h"
+#include "ComPtr.h"
+#include "RefCount.h"
+#include "SlabPool.h"
+#include "Statistics.h"
+#include <cstddef>
 
 // 接口 ID
 static const IID IID_ICalculator =
 { 0xAABBCCDD, 0x1234, 0x5678, { 0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC, 0xDE, 0xF0 } };
 
+static const IID IID_IBatchCalculator =
+{ 0xAABBCCDE, 0x1234, 0x5678, { 0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC, 0xDE, 0xF1 } };
+
+static const IID IID_IAsyncCalculator =
+{ 0xAABBCCDF, 0x1234, 0x5678, { 0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC, 0xDE, 0xF2 } };
+
+static const IID IID_IAsyncCall =
+{ 0xAABBCCE0, 0x1234, 0x5678, { 0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC, 0xDE, 0xF3 } };
+
+static const IID IID_ICalculatorDiagnostics =
+{ 0xAABBCCE1, 0x1234, 0x5678, { 0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC, 0xDE, 0xF4 } };
+
+static const IID IID_IExpression =
+{ 0xAABBCCE2, 0x1234, 0x5678, { 0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC, 0xDE, 0xF5 } };
+
+static const IID IID_IExpressionCalculator =
+{ 0xAABBCCE3, 0x1234, 0x5678, { 0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC, 0xDE, 0xF6 } };
+
+static const IID IID_IStatistics =
+{ 0xAABBCCE4, 0x1234, 0x5678, { 0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC, 0xDE, 0xF7 } };
+
+static const IID IID_IBatchCalculator2 =
+{ 0xAABBCCE5, 0x1234, 0x5678, { 0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC, 0xDE, 0xF8 } };
+
 // 类 ID
 static const CLSID CLSID_Calculator =
 { 0xDDCCBBAA, 0x4321, 0x8765, { 0x21, 0x43, 0x65, 0x87, 0xA9, 0xCB, 0xED, 0x0F } };
@@ -21,19 +52,170 @@ public:
     virtual HRESULT __stdcall Divide(int a, int b, int* result) = 0;       // 除法
 };
 
+// 批量接口：一次虚函数调用处理整个数组，out[i] = a[i] op b[i]
+// 内部按 CPU 选择 SSE2 / AVX2 / AVX-512 内核（见 BatchKernels.h）
+class __declspec(novtable) IBatchCalculator : public IUnknown
+{
+public:
+    virtual HRESULT __stdcall AddN(const int* a, const int* b, int* out, size_t n) = 0;
+    virtual HRESULT __stdcall SubtractN(const int* a, const int* b, int* out, size_t n) = 0;
+    virtual HRESULT __stdcall MultiplyN(const int* a, const int* b, int* out, size_t n) = 0;
+    virtual HRESULT __stdcall DivideN(const int* a, const int* b, int* out, size_t n) = 0;  // 任一除数为 0 返回 E_INVALIDARG，不写 out
+};
+
+// 批量接口第 2 版：已经发布的 IBatchCalculator 不能再改（老客户端按它的虚表布局调用），新方法放在派生接口里
+class __declspec(novtable) IBatchCalculator2 : public IBatchCalculator
+{
+public:
+    // 同一个除数除整个数组：PrepareDivisor 算一次乘数和移位量，之后 DivideByN 只做乘法和移位
+    // 结果与 Divide 逐位一致；除数为 0 时 PrepareDivisor 返回 E_INVALIDARG
+    virtual HRESULT __stdcall PrepareDivisor(int divisor, BatchDivisor* prepared) = 0;
+    virtual HRESULT __stdcall DivideByN(const int* a, const BatchDivisor* divisor, int* out, size_t n) = 0;
+};
+
+// 异步调用完成时的回调（在线程池的工作线程上执行）
+typedef void (__stdcall *AsyncCallback)(void* context);
+
+// 一次异步调用（或一批调用）的句柄
+class __declspec(novtable) IAsyncCall : public IUnknown
+{
+public:
+    virtual BOOL __stdcall IsCompleted() = 0;
+    virtual HRESULT __stdcall Wait(int* result) = 0;       // 阻塞到完成，返回运算本身的 HRESULT
+    virtual HRESULT __stdcall GetResult(int* result) = 0;  // 未完成时返回 E_PENDING
+    // 注册完成回调（只能注册一次）：返回 S_OK 表示完成时会回调；S_FALSE 表示已经完成，不会回调
+    virtual HRESULT __stdcall OnCompleted(AsyncCallback callback, void* context) = 0;
+};
+
+// 批量异步请求：结果直接写回数组
+enum AsyncOp : int
+{
+    AsyncOp_Add,
+    AsyncOp_Subtract,
+    AsyncOp_Multiply,
+    AsyncOp_Divide,
+};
+
+struct AsyncRequest
+{
+    AsyncOp op;
+    int     a;
+    int     b;
+    int     result;  // 输出
+    HRESULT hr;      // 输出
+};
+
+// 异步接口：调用立即返回，运算在工作窃取线程池上执行（见 WorkStealingPool.h）
+// C++20 调用方可以直接 co_await 返回的调用（见 AsyncTask.h）
+class __declspec(novtable) IAsyncCalculator : public IUnknown
+{
+public:
+    virtual HRESULT __stdcall AddAsync(int a, int b, IAsyncCall** ppCall) = 0;
+    virtual HRESULT __stdcall SubtractAsync(int a, int b, IAsyncCall** ppCall) = 0;
+    virtual HRESULT __stdcall MultiplyAsync(int a, int b, IAsyncCall** ppCall) = 0;
+    virtual HRESULT __stdcall DivideAsync(int a, int b, IAsyncCall** ppCall) = 0;
+
+    // 批量提交：一次入队、分块并行执行，全部完成后只通知一次
+    // requests 在完成前必须保持有效，count 为 0 时返回 E_INVALIDARG；完成后 GetResult 的 result 是失败的请求数，
+    // 全部成功返回 S_OK，否则返回 S_FALSE（各请求的错误码见 AsyncRequest::hr）
+    virtual HRESULT __stdcall SubmitBatch(AsyncRequest* requests, size_t count, IAsyncCall** ppCall) = 0;
+};
+
+// 诊断接口：很少使用，Calculator 以 tear-off 方式提供（请求时才创建，不占对象的虚表指针，见 TearOff.h）
+class __declspec(novtable) ICalculatorDiagnostics : public IUnknown
+{
+public:
+    virtual HRESULT __stdcall GetRefCount(ULONG* count) = 0;                // 对象的引用计数（不含诊断接口自己持有的引用）
+    virtual HRESULT __stdcall GetPoolStats(PoolStats* stats) = 0;           // Calculator 对象池的使用情况
+    virtual HRESULT __stdcall GetBatchKernel(const char** name) = 0;        // IBatchCalculator 选用的内核
+};
+
+// 编译好的表达式（见 Expression.h）：不可变，可以在多个线程上同时求值
+class __declspec(novtable) IExpression : public IUnknown
+{
+public:
+    // vars[i] 是第 i 个变量的值，count 不能少于 GetVariableCount；除数为 0 返回 E_INVALIDARG
+    virtual HRESULT __stdcall Evaluate(const int* vars, size_t count, int* result) = 0;
+    // 列式求值：out[i] = 表达式(columns[0][i], columns[1][i], ...)，按块用 SIMD 内核计算并分给多个线程
+    // columnCount 不能少于 GetVariableCount，out 不能与输入列重叠；除数为 0 的行输出 0，
+    // errors[i]（可以为空）置 1，其余行置 0。全部成功返回 S_OK，否则返回 S_FALSE，失败行数写入 failedRows（可以为空）
+    virtual HRESULT __stdcall EvaluateColumns(const int* const* columns, size_t columnCount, size_t rows,
+                                              int* out, unsigned char* errors, size_t* failedRows) = 0;
+    virtual HRESULT __stdcall GetVariableCount(size_t* count) = 0;
+    virtual HRESULT __stdcall GetVariableName(size_t index, const char** name) = 0;  // 表达式持有期间有效
+};
+
+// 表达式接口：一次调用求出整个公式，代替逐个调用 ICalculator 的方法
+// 支持 + - * / 、一元负号、括号、十进制整数和变量（标识符，按第一次出现的顺序编号）；运算语义与 ICalculator 一致
+// 语法错误、除数为常数 0 在编译时返回 E_INVALIDARG；Calculator 以 tear-off 方式提供
+class __declspec(novtable) IExpressionCalculator : public IUnknown
+{
+public:
+    // 编译（相同源文本只编译一次，之后从缓存取出），返回可重复使用的句柄
+    virtual HRESULT __stdcall Compile(const char* source, IExpression** ppExpr) = 0;
+    // 查缓存并求值：同一个公式反复求值时只有这一次调用
+    virtual HRESULT __stdcall Evaluate(const char* source, const int* vars, size_t count, int* result) = 0;
+};
+
+// 统计接口（见 Statistics.h）：整个模块各入口函数的调用次数和延迟分布
+// Calculator 和 CalculatorFactory 以 tear-off 方式提供；编译时关闭统计（COM_ENABLE_STATS=0）时不提供
+class __declspec(novtable) IStatistics : public IUnknown
+{
+public:
+    // 每个入口函数一项；capacity 少于 Stat_Count 时只写前 capacity 项并返回 S_FALSE，count 是总项数
+    virtual HRESULT __stdcall GetSnapshot(CallStats* stats, size_t capacity, size_t* count) = 0;
+    virtual HRESULT __stdcall Reset() = 0;  // 之后的快照从 0 开始
+};
+
 // 注意：IClassFactory 是 Windows 系统定义的标准接口
 // 定义在 unknwn.h 中，包含 CreateInstance 和 LockServer 方法
 
+// ComPtr<Itf>::As 用的接口 → IID 对应关系
+COM_DECLARE_INTERFACE_ID(ICalculator);
+COM_DECLARE_INTERFACE_ID(IBatchCalculator);
+COM_DECLARE_INTERFACE_ID(IBatchCalculator2);
+COM_DECLARE_INTERFACE_ID(IAsyncCalculator);
+COM_DECLARE_INTERFACE_ID(IAsyncCall);
+COM_DECLARE_INTERFACE_ID(ICalculatorDiagnostics);
+COM_DECLARE_INTERFACE_ID(IExpression);
+COM_DECLARE_INTERFACE_ID(IExpressionCalculator);
+COM_DECLARE_INTERFACE_ID(IStatistics);
+
 // 实现类
-class Calculator : public ICalculator
+// 每个继承的接口占一个虚表指针；ICalculatorDiagnostics 是 tear-off，不在这里继承
+// 四则运算在 CalculatorCore 里（不占空间）：ICalculator 的方法只是转给它的包装，
+// 已经持有 Calculator 的进程内代码可以通过 Direct() 直接调用，不经过虚函数表
+class Calculator : public ICalculator, public IBatchCalculator2, public IAsyncCalculator,
+                   private CalculatorCore<Calculator>
 {
 private:
-    ULONG m_refCount;  // 引用计数
+    RefCount m_refCount;  // 引用计数（原子操作，线程安全）
+
+    using Core = CalculatorCore<Calculator>;
+    friend class CalculatorDiagnostics;
+    friend Core;
+
+    // CalculatorCore 的钩子：每次运算写一条日志（Release 构建中编译期去掉，直接调用时完全内联）
+    static void OnResult(char op, int a, int b, int result)
+    {
+        switch (op)
+        {
+        case '+': COM_LOG_TRACE("[Calculator] Add: {} + {} = {}", a, b, result); break;
+        case '-': COM_LOG_TRACE("[Calculator] Subtract: {} - {} = {}", a, b, result); break;
+        case '*': COM_LOG_TRACE("[Calculator] Multiply: {} * {} = {}", a, b, result); break;
+        case '/': COM_LOG_TRACE("[Calculator] Divide: {} / {} = {}", a, b, result); break;
+        }
+    }
 
 public:
     Calculator();
     virtual ~Calculator();
 
+    // 对象内存来自专用的 slab 对象池，稳定状态下创建/销毁不调用 malloc
+    // 分配失败时返回 nullptr（new 表达式不抛异常）
+    static void* operator new(size_t size) noexcept;
+    static void operator delete(void* p, size_t size) noexcept;
+
     // IUnknown 接口
     virtual HRESULT __stdcall QueryInterface(REFIID riid, void** ppvObject) override;
     virtual ULONG __stdcall AddRef() override;
@@ -44,13 +226,36 @@ public:
     virtual HRESULT __stdcall Subtract(int a, int b, int* result) override;
     virtual HRESULT __stdcall Multiply(int a, int b, int* result) override;
     virtual HRESULT __stdcall Divide(int a, int b, int* result) override;
+
+    // IBatchCalculator 接口
+    virtual HRESULT __stdcall AddN(const int* a, const int* b, int* out, size_t n) override;
+    virtual HRESULT __stdcall SubtractN(const int* a, const int* b, int* out, size_t n) override;
+    virtual HRESULT __stdcall MultiplyN(const int* a, const int* b, int* out, size_t n) override;
+    virtual HRESULT __stdcall DivideN(const int* a, const int* b, int* out, size_t n) override;
+
+    // IBatchCalculator2 接口
+    virtual HRESULT __stdcall PrepareDivisor(int divisor, BatchDivisor* prepared) override;
+    virtual HRESULT __stdcall DivideByN(const int* a, const BatchDivisor* divisor, int* out, size_t n) override;
+
+    // IAsyncCalculator 接口（实现在 AsyncCalculator.cpp）
+    virtual HRESULT __stdcall AddAsync(int a, int b, IAsyncCall** ppCall) override;
+    virtual HRESULT __stdcall SubtractAsync(int a, int b, IAsyncCall** ppCall) override;
+    virtual HRESULT __stdcall MultiplyAsync(int a, int b, IAsyncCall** ppCall) override;
+    virtual HRESULT __stdcall DivideAsync(int a, int b, IAsyncCall** ppCall) override;
+    virtual HRESULT __stdcall SubmitBatch(AsyncRequest* requests, size_t count, IAsyncCall** ppCall) override;
+
+    // 同步执行一个请求（异步调用在工作线程上通过它完成）
+    HRESULT Execute(AsyncOp op, int a, int b, int* result);
+
+    // 静态分派：与 ICalculator 的方法行为完全相同，但可以内联
+    const CalculatorCore<Calculator>& Direct() const { return *this; }
 };
 
 // 类工厂实现
 class CalculatorFactory : public IClassFactory
 {
 private:
-    ULONG m_refCount;  // 引用计数
+    RefCount m_refCount;  // 引用计数（原子操作，线程安全）
 
 public:
     CalculatorFactory();
@@ -66,5 +271,10 @@ public:
     virtual HRESULT __stdcall LockServer(BOOL fLock) override;
 };
 
-// 全局函数：模拟 COM 注册
-HRESULT DllGetClassObject(REFCLSID rclsid, REFIID riid, void** ppv);
+// Calculator 对象池的使用情况
+PoolStats GetCalculatorPoolStats();
+
+// 模块导出函数（与 Windows SDK 的声明一致：extern "C" + __stdcall）
+// 编译成动态库时通过 ModuleLoader 按名字查找
+extern "C" COM_EXPORT HRESULT __stdcall DllGetClassObject(REFCLSID rclsid, REFIID riid, void** ppv);
+extern "C" COM_EXPORT HRESULT __stdcall DllCanUnloadNow();
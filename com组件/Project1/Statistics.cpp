@@ -0,0 +1,273 @@
+// Statistics.cpp - 入口函数的调用计数和延迟直方图实现
+#include "Statistics.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <new>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define STATS_HAS_TSC 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#else
+#define STATS_HAS_TSC 0
+#endif
+
+namespace Statistics
+{
+    namespace
+    {
+        const char* const kNames[Stat_Count] =
+        {
+            "ICalculator::Add",
+            "ICalculator::Subtract",
+            "ICalculator::Multiply",
+            "ICalculator::Divide",
+            "QueryInterface",
+            "CreateInstance",
+            "DllGetClassObject",
+        };
+
+        // ========================================
+        // 直方图分桶：小于 16 的值每个一个桶；之后每个 2 的幂区间 [2^e, 2^(e+1)) 均分 16 份
+        // ========================================
+        const uint32_t kSub = 16;
+        const int      kSubBits = 4;
+        const int      kMaxExponent = 43;  // 2^44 个时钟周期（几个小时）以上都记在最后一个桶
+        const size_t   kBuckets = (kMaxExponent - kSubBits + 2) * kSub;
+
+        inline int HighBit(uint64_t v)
+        {
+#if defined(_MSC_VER)
+            unsigned long index;
+            _BitScanReverse64(&index, v);
+            return (int)index;
+#else
+            return 63 - __builtin_clzll(v);
+#endif
+        }
+
+        inline size_t BucketOf(uint64_t ticks)
+        {
+            if (ticks < kSub) return (size_t)ticks;
+            int e = HighBit(ticks);
+            if (e > kMaxExponent) return kBuckets - 1;
+            return (size_t)(e - kSubBits + 1) * kSub + (size_t)((ticks >> (e - kSubBits)) & (kSub - 1));
+        }
+
+        // 桶的下界
+        inline uint64_t BucketLow(size_t index)
+        {
+            if (index < kSub) return index;
+            int e = (int)(index / kSub) + kSubBits - 1;
+            return (uint64_t)(kSub + index % kSub) << (e - kSubBits);
+        }
+
+        // ========================================
+        // 每线程的计数块
+        // ========================================
+        // 只有所属线程写：用 relaxed 的读 + 写代替读-改-写（没有 lock 前缀），快照线程读到的总是某个完整的值
+        inline void Bump(std::atomic<uint64_t>& counter, uint64_t by = 1)
+        {
+            counter.store(counter.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+        }
+
+        struct alignas(64) Counters
+        {
+            uint32_t              countdown = kSampleInterval;  // 减到 0 时计时一次（只有所属线程访问）
+            std::atomic<uint64_t> calls{ 0 };
+            std::atomic<uint64_t> samples{ 0 };
+            std::atomic<uint64_t> ticks{ 0 };
+            std::atomic<uint64_t> buckets[kBuckets] = {};
+        };
+
+        struct alignas(64) ThreadBlock
+        {
+            Counters          counters[Stat_Count];
+            ThreadBlock*      next = nullptr;  // 全局链表，只增不减
+            std::atomic<bool> inUse{ true };
+        };
+
+        // 线程退出后计数块留在链表里（数据仍计入总数），新线程优先复用空闲的块
+        std::atomic<ThreadBlock*> s_blocks{ nullptr };
+        std::mutex                s_lock;      // 注册新线程、Reset、Snapshot
+
+        struct BlockOwner
+        {
+            ThreadBlock* block = nullptr;
+            ~BlockOwner()
+            {
+                if (block) block->inUse.store(false, std::memory_order_release);
+            }
+        };
+
+        thread_local BlockOwner t_owner;
+
+        ThreadBlock* AttachThread()
+        {
+            std::lock_guard<std::mutex> lock(s_lock);
+            for (ThreadBlock* b = s_blocks.load(std::memory_order_relaxed); b; b = b->next)
+            {
+                if (!b->inUse.load(std::memory_order_acquire))
+                {
+                    b->inUse.store(true, std::memory_order_relaxed);
+                    return t_owner.block = b;
+                }
+            }
+            ThreadBlock* b = new (std::nothrow) ThreadBlock();
+            if (!b) return nullptr;
+            b->next = s_blocks.load(std::memory_order_relaxed);
+            s_blocks.store(b, std::memory_order_release);
+            return t_owner.block = b;
+        }
+
+        // ========================================
+        // 时间戳：x86 上用 TSC（不经过系统调用），快照时按 steady_clock 换算成纳秒
+        // ========================================
+        inline uint64_t Ticks()
+        {
+#if STATS_HAS_TSC
+            return __rdtsc();
+#else
+            return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+        }
+
+        struct Clock
+        {
+            uint64_t                              ticks;
+            std::chrono::steady_clock::time_point time;
+        };
+        const Clock s_origin = { Ticks(), std::chrono::steady_clock::now() };
+
+        double NsPerTick()
+        {
+#if STATS_HAS_TSC
+            // 两次读数间隔太短时误差大：至少等 1 ms
+            Clock now;
+            do
+            {
+                now = { Ticks(), std::chrono::steady_clock::now() };
+            } while (now.time - s_origin.time < std::chrono::milliseconds(1));
+            double ns = std::chrono::duration<double, std::nano>(now.time - s_origin.time).count();
+            return now.ticks > s_origin.ticks ? ns / (double)(now.ticks - s_origin.ticks) : 0.0;
+#else
+            return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::duration(1)).count();
+#endif
+        }
+
+        // 所有线程的合计（Reset 时保存为基线）
+        struct Totals
+        {
+            uint64_t calls;
+            uint64_t samples;
+            uint64_t ticks;
+            uint64_t buckets[kBuckets];
+        };
+        Totals* s_baseline = nullptr;  // s_lock 保护；第一次 Reset 时分配
+
+        void Collect(Totals* totals)
+        {
+            for (int id = 0; id < Stat_Count; ++id)
+            {
+                Totals& t = totals[id];
+                t = {};
+                for (ThreadBlock* b = s_blocks.load(std::memory_order_acquire); b; b = b->next)
+                {
+                    const Counters& c = b->counters[id];
+                    t.calls += c.calls.load(std::memory_order_relaxed);
+                    t.samples += c.samples.load(std::memory_order_relaxed);
+                    t.ticks += c.ticks.load(std::memory_order_relaxed);
+                    for (size_t i = 0; i < kBuckets; ++i)
+                        t.buckets[i] += c.buckets[i].load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // 第 q 分位的样本所在桶（取桶的中点）
+        double Percentile(const Totals& t, double q, double nsPerTick)
+        {
+            uint64_t rank = (uint64_t)(q * (double)(t.samples - 1)) + 1;
+            uint64_t seen = 0;
+            for (size_t i = 0; i < kBuckets; ++i)
+            {
+                seen += t.buckets[i];
+                if (seen >= rank) return (double)(BucketLow(i) + BucketLow(i + 1)) / 2 * nsPerTick;
+            }
+            return 0.0;
+        }
+    }
+
+    uint64_t Begin(StatId id)
+    {
+        ThreadBlock* b = t_owner.block;
+        if (!b && !(b = AttachThread())) return 0;  // 内存不足：不统计
+        Counters& c = b->counters[id];
+        Bump(c.calls);
+
+        if (--c.countdown != 0) return 0;
+        c.countdown = kSampleInterval;
+        return Ticks();
+    }
+
+    void End(StatId id, uint64_t start)
+    {
+        Counters& c = t_owner.block->counters[id];
+        uint64_t ticks = Ticks() - start;
+        Bump(c.samples);
+        Bump(c.ticks, ticks);
+        Bump(c.buckets[BucketOf(ticks)]);
+    }
+
+    void Snapshot(CallStats* stats)
+    {
+        static Totals totals[Stat_Count];  // s_lock 保护（约 40 KB，不放在栈上）
+        const double nsPerTick = NsPerTick();
+
+        std::lock_guard<std::mutex> lock(s_lock);
+        Collect(totals);
+        for (int id = 0; id < Stat_Count; ++id)
+        {
+            Totals& t = totals[id];
+            if (s_baseline)
+            {
+                const Totals& base = s_baseline[id];
+                t.calls -= base.calls;
+                t.samples -= base.samples;
+                t.ticks -= base.ticks;
+                for (size_t i = 0; i < kBuckets; ++i) t.buckets[i] -= base.buckets[i];
+            }
+
+            CallStats& s = stats[id];
+            s = {};
+            s.name = kNames[id];
+            s.calls = t.calls;
+            s.samples = t.samples;
+            if (t.samples == 0) continue;
+
+            s.meanNs = (double)t.ticks / (double)t.samples * nsPerTick;
+            s.p50Ns = Percentile(t, 0.50, nsPerTick);
+            s.p90Ns = Percentile(t, 0.90, nsPerTick);
+            s.p99Ns = Percentile(t, 0.99, nsPerTick);
+            s.p999Ns = Percentile(t, 0.999, nsPerTick);
+            for (size_t i = kBuckets; i-- > 0;)
+            {
+                if (t.buckets[i])
+                {
+                    s.maxNs = (double)BucketLow(i + 1) * nsPerTick;
+                    break;
+                }
+            }
+        }
+    }
+
+    void Reset()
+    {
+        std::lock_guard<std::mutex> lock(s_lock);
+        if (!s_baseline) s_baseline = new (std::nothrow) Totals[Stat_Count];
+        if (s_baseline) Collect(s_baseline);
+    }
+}
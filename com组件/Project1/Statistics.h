@@ -0,0 +1,103 @@
+// Statistics.h - 入口函数的调用计数和延迟直方图
+// =====================================================
+// 统计 ICalculator 的四个方法、QueryInterface、CreateInstance、DllGetClassObject 的调用次数和耗时，
+// 通过 IStatistics 接口查询（Calculator 和 CalculatorFactory 都以 tear-off 方式提供，数据是整个模块的）：
+//
+//   HRESULT __stdcall Calculator::Add(int a, int b, int* result)
+//   {
+//       COM_STATS_SCOPE(Stat_Add);   // 构造时取时间戳，析构时记录
+//       ...
+//   }
+//
+// 开销：
+//   - 每个线程写自己的计数块（按缓存行对齐），没有原子读-改-写，也没有线程间共享的缓存行
+//   - 调用次数每次都记；耗时每 kSampleInterval 次取样一次（读时间戳计数器本身要十几纳秒），
+//     每个线程的第 kSampleInterval 次调用才第一次计时，冷启动（缓存未命中、第一次解析符号）的那几次不进样本；
+//     直方图和平均值都按样本计算，调用次数不到 kSampleInterval 的入口函数可能没有样本（samples 为 0）
+//   - 直方图按 HDR 的方式分桶：每个 2 的幂区间再均分 16 份，相对误差不超过 1/16
+//   - 编译期开关 COM_ENABLE_STATS：默认 Debug 开、Release（NDEBUG）关；关闭时宏展开为空，
+//     IStatistics 也不在接口表里
+//
+// Reset 不改写各线程的计数块（那样会和正在写的线程竞争），而是记下当前值作为基线，之后的快照减去基线
+#pragma once
+#include "ComPlatform.h"
+#include <cstddef>
+#include <cstdint>
+
+#ifndef COM_ENABLE_STATS
+#if defined(NDEBUG)
+#define COM_ENABLE_STATS 0
+#else
+#define COM_ENABLE_STATS 1
+#endif
+#endif
+
+// 统计的入口函数
+enum StatId : int
+{
+    Stat_Add,
+    Stat_Subtract,
+    Stat_Multiply,
+    Stat_Divide,
+    Stat_QueryInterface,
+    Stat_CreateInstance,
+    Stat_DllGetClassObject,
+    Stat_Count,
+};
+
+// 一个入口函数的快照
+struct CallStats
+{
+    const char* name;     // 入口函数名（静态字符串）
+    uint64_t    calls;    // 调用次数
+    uint64_t    samples;  // 计时的样本数
+    double      meanNs;
+    double      p50Ns;
+    double      p90Ns;
+    double      p99Ns;
+    double      p999Ns;
+    double      maxNs;    // 最大样本所在桶的上界
+};
+
+namespace Statistics
+{
+    const uint32_t kSampleInterval = 16;  // 每多少次调用计时一次
+
+    // 当前线程开始一次调用；返回 0 表示这次不计时，否则返回时间戳
+    uint64_t Begin(StatId id);
+
+    // 记录耗时（start 是 Begin 的返回值）
+    void End(StatId id, uint64_t start);
+
+    // 所有线程的数据加起来，减去上次 Reset 时的基线；stats 至少要有 Stat_Count 个元素
+    void Snapshot(CallStats* stats);
+
+    void Reset();
+}
+
+#if COM_ENABLE_STATS
+
+class StatScope
+{
+private:
+    StatId   m_id;
+    uint64_t m_start;
+
+public:
+    explicit StatScope(StatId id) : m_id(id), m_start(Statistics::Begin(id)) {}
+    ~StatScope()
+    {
+        if (m_start) Statistics::End(m_id, m_start);
+    }
+
+    StatScope(const StatScope&) = delete;
+    StatScope& operator=(const StatScope&) = delete;
+};
+
+#define COM_STATS_SCOPE(id) StatScope comStatScope_(id)
+
+#else
+
+#define COM_STATS_SCOPE(id) do {} while (0)
+
+#endif  // COM_ENABLE_STATS
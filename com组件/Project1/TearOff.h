@@ -0,0 +1,70 @@
+// TearOff.h - tear-off 接口
+// =====================================================
+// 对象用多重继承实现的每个接口都在每个实例里占一个虚表指针。很少用的接口（诊断、统计）
+// 可以不继承，而是在 QueryInterface 请求它时才临时创建一个小的辅助对象：
+//
+//   class CalculatorDiagnostics : public TearOff<Calculator, ICalculatorDiagnostics, IID_ICalculatorDiagnostics>
+//   {
+//       ...  // 通过 m_owner 访问所有者
+//   };
+//
+//   COM_INTERFACE_ENTRY_TEAR_OFF(Calculator, ICalculatorDiagnostics, CalculatorDiagnostics),  // 接口表中的一行
+//
+//   - 辅助对象有自己的引用计数，并持有所有者的一个引用：所有者至少活得和它一样长
+//   - COM 标识规则不变：对它请求 IUnknown 或其他接口都转给所有者，得到的 IUnknown 与所有者相同
+//   - 不缓存：每次 QueryInterface 都新建一个（所有者里不需要任何额外成员），
+//     所以只适合偶尔请求的接口；常用接口仍然用继承
+#pragma once
+#include "ComPlatform.h"
+#include "InterfaceMap.h"
+#include "RefCount.h"
+
+template <class Owner, class Itf, const IID& Iid>
+class TearOff : public Itf
+{
+protected:
+    Owner*   m_owner;     // 所有者（持有一个引用）
+    RefCount m_refCount;
+
+public:
+    explicit TearOff(Owner* owner) : m_owner(owner), m_refCount(1)
+    {
+        m_owner->AddRef();
+    }
+
+    virtual ~TearOff()
+    {
+        m_owner->Release();
+    }
+
+    TearOff(const TearOff&) = delete;
+    TearOff& operator=(const TearOff&) = delete;
+
+    virtual HRESULT __stdcall QueryInterface(REFIID riid, void** ppvObject) override
+    {
+        if (!ppvObject) return E_POINTER;
+        if (GuidEquals(riid, Iid))
+        {
+            m_refCount.Increment();
+            *ppvObject = static_cast<Itf*>(this);
+            return S_OK;
+        }
+        return m_owner->QueryInterface(riid, ppvObject);  // IUnknown 和其他接口都由所有者回答
+    }
+
+    virtual ULONG __stdcall AddRef() override
+    {
+        return m_refCount.Increment();
+    }
+
+    virtual ULONG __stdcall Release() override
+    {
+        ULONG count = m_refCount.Decrement();
+        if (count == 0)
+        {
+            delete this;
+            return 0;
+        }
+        return count;
+    }
+};
@@ -1,20 +1,161 @@
 // TestStandardCOM.cpp - 测试标准 COM 组件
 #include "StandardCOM.h"
+#include "Apartment.h"
+#include "AsyncTask.h"
+#include "BatchKernels.h"
+#include "ComLog.h"
+#include "RefProfiler.h"
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
 
 using namespace std;
 
+// 协程示例：两次异步调用串起来，co_await 期间不占用线程
+static CalcTask<int> AddThenMultiply(IAsyncCalculator* p, int a, int b, int c)
+{
+    CalcResult sum = co_await StartAsync(p, AsyncOp_Add, a, b);
+    CalcResult product = co_await StartAsync(p, AsyncOp_Multiply, sum.value, c);
+    co_return product.value;
+}
+
 // 设置控制台 UTF-8 编码
 void SetupConsoleUTF8()
 {
+#ifdef _WIN32
     SetConsoleOutputCP(65001);
     SetConsoleCP(65001);
+#endif
+}
+
+// 用 Scalar 内核作为标准，检查每个可用的 SIMD 内核结果是否逐位一致
+// 不变除数（divBy）和逐个除法比较，Scalar 自己的 divBy 也要检查
+// 长度取 1000 + 13，保证主循环和尾部都被覆盖
+bool VerifyBatchKernels()
+{
+    const size_t n = 1013;
+    vector<int> a(n), b(n);
+    srand(12345);
+    for (size_t i = 0; i < n; ++i)
+    {
+        a[i] = (rand() << 16) ^ rand();
+        b[i] = (rand() << 16) ^ rand();
+        if (b[i] == 0) b[i] = 1;
+    }
+    // 边界值
+    const int edges[] = { INT_MIN, INT_MAX, -1, 1, 7, -7 };
+    for (size_t i = 0; i < 6; ++i)
+    {
+        for (size_t j = 0; j < 6; ++j)
+        {
+            a[i * 6 + j] = edges[i];
+            b[i * 6 + j] = edges[j];
+        }
+    }
+
+    const BatchKernelTable* ref = GetBatchKernels(BatchIsa::Scalar);
+    vector<int> expect(n), actual(n);
+    bool allOk = true;
+
+    const BatchIsa isas[] = { BatchIsa::Scalar, BatchIsa::SSE2, BatchIsa::AVX2, BatchIsa::AVX512 };
+    for (BatchIsa isa : isas)
+    {
+        const BatchKernelTable* k = GetBatchKernels(isa);
+        if (!k) continue;  // 当前 CPU 不支持
+
+        bool ok = true;
+        ref->add(a.data(), b.data(), expect.data(), n);
+        k->add(a.data(), b.data(), actual.data(), n);
+        ok = ok && expect == actual;
+        ref->sub(a.data(), b.data(), expect.data(), n);
+        k->sub(a.data(), b.data(), actual.data(), n);
+        ok = ok && expect == actual;
+        ref->mul(a.data(), b.data(), expect.data(), n);
+        k->mul(a.data(), b.data(), actual.data(), n);
+        ok = ok && expect == actual;
+        ref->div(a.data(), b.data(), expect.data(), n);
+        k->div(a.data(), b.data(), actual.data(), n);
+        ok = ok && expect == actual;
+        ok = ok && !k->hasZero(b.data(), n);
+        for (size_t j = 0; j < 6 && ok; ++j)
+        {
+            // 不变除数：与逐个除法比较
+            BatchDivisor d;
+            PrepareBatchDivisor(edges[j], &d);
+            vector<int> divisors(n, edges[j]);
+            ref->div(a.data(), divisors.data(), expect.data(), n);
+            k->divBy(a.data(), d, actual.data(), n);
+            ok = expect == actual;
+        }
+
+        cout << "  [" << k->name << "] " << (ok ? "与 Scalar 一致" : "结果不一致！") << endl;
+        allOk = allOk && ok;
+    }
+    return allOk;
+}
+
+// 检查创建和传递接口时的引用计数原子操作次数（RefCount::ThreadOps，只在 Debug 构建中统计）
+bool VerifyRefCountOps(IClassFactory* pFactory)
+{
+#if defined(REFCOUNT_COUNT_OPS)
+    bool allOk = true;
+    auto check = [&](const char* what, unsigned long long ops, unsigned long long expected)
+    {
+        cout << "  " << what << ": " << ops << " 次" << (ops == expected ? "" : "（多余！）") << endl;
+        allOk = allOk && ops == expected;
+    };
+
+    unsigned long long begin = RefCount::ThreadOps();
+    ComPtr<ICalculator> calc;
+    pFactory->CreateInstance(nullptr, IID_ICalculator, (void**)calc.ReleaseAndGetAddressOf());
+    check("CreateInstance（初始引用直接交给调用者）", RefCount::ThreadOps() - begin, 0);
+
+    begin = RefCount::ThreadOps();
+    ComPtr<ICalculator> moved = std::move(calc);
+    check("移动 ComPtr", RefCount::ThreadOps() - begin, 0);
+
+    begin = RefCount::ThreadOps();
+    {
+        ComPtr<ICalculator> copy = moved;
+    }
+    check("拷贝并销毁 ComPtr", RefCount::ThreadOps() - begin, 2);
+
+    begin = RefCount::ThreadOps();
+    {
+        ComPtr<IBatchCalculator> batch = moved.As<IBatchCalculator>();
+    }
+    check("As<IBatchCalculator> 并销毁", RefCount::ThreadOps() - begin, 2);
+
+    begin = RefCount::ThreadOps();
+    moved.Reset();
+    check("释放最后一个引用", RefCount::ThreadOps() - begin, 1);
+    return allOk;
+#else
+    (void)pFactory;
+    cout << "  Release 构建不统计" << endl;
+    return true;
+#endif
 }
 
-int main()
+// 参数：引用计数剖析的时间线写到哪个文件（可选，Chrome trace JSON）
+// 退出码：所有校验都通过时为 0，否则为 1
+int main(int argc, char* argv[])
 {
     SetupConsoleUTF8();
 
+    // 演示程序：让组件日志和下面的输出按顺序显示（默认是后台线程异步输出）
+    ComLog::SetSynchronous(true);
+
+    bool allPassed = true;  // 各项校验的结果，决定退出码
+
+#if COM_ENABLE_REFPROFILE
+    RefProfiler::Start();  // 记录整个演示过程中每次 AddRef/Release 的调用点
+#endif
+
     cout << "\n========================================" << endl;
     cout << "   标准 COM 组件示例" << endl;
     cout << "   Standard COM Component" << endl;
@@ -25,11 +166,11 @@ int main()
     // ========================================
     cout << "【步骤 1】获取类工厂\n" << endl;
 
-    IClassFactory* pFactory = nullptr;
+    ComPtr<IClassFactory> pFactory;  // 智能指针：离开作用域时自动 Release
     HRESULT hr = DllGetClassObject(
         CLSID_Calculator,      // 请求 Calculator 的类工厂
         IID_IClassFactory,     // 请求 IClassFactory 接口
-        (void**)&pFactory
+        (void**)pFactory.ReleaseAndGetAddressOf()
     );
 
     if (FAILED(hr) || !pFactory)
@@ -43,20 +184,24 @@ int main()
     // ========================================
     cout << "【步骤 2】通过类工厂创建对象\n" << endl;
 
-    ICalculator* pCalc = nullptr;
+    ComPtr<ICalculator> pCalc;
     hr = pFactory->CreateInstance(
         nullptr,               // 不使用聚合
         IID_ICalculator,       // 请求 ICalculator 接口
-        (void**)&pCalc
+        (void**)pCalc.ReleaseAndGetAddressOf()
     );
 
     if (FAILED(hr) || !pCalc)
     {
         cout << "错误：无法创建 Calculator 对象！" << endl;
-        pFactory->Release();
-        return -1;
+        return -1;  // pFactory 自动释放
     }
 
+    cout << "\n引用计数原子操作:" << endl;
+    bool refOpsOk = VerifyRefCountOps(pFactory.Get());
+    cout << (refOpsOk ? "没有多余的操作\n" : "存在多余的操作！\n") << endl;
+    allPassed = allPassed && refOpsOk;
+
     // ========================================
     // 步骤 3: 使用对象
     // ========================================
@@ -76,33 +221,307 @@ int main()
     pCalc->Divide(100, 50, &result);     // 100 / 50
     cout << "结果: " << result << "\n" << endl;
 
+    // 直接调用（CalculatorCore）与经过虚函数表的调用共用同一份代码，边界值上结果也完全相同
+    {
+        DirectCalculator direct;
+        const int edges[] = { INT_MIN, INT_MAX, -1, 0, 1, 7 };
+        bool same = true;
+        for (int a : edges)
+        {
+            for (int b : edges)
+            {
+                int r1 = 0, r2 = 0;
+                same = same && pCalc->Add(a, b, &r1) == direct.Add(a, b, &r2) && r1 == r2;
+                same = same && pCalc->Subtract(a, b, &r1) == direct.Subtract(a, b, &r2) && r1 == r2;
+                same = same && pCalc->Multiply(a, b, &r1) == direct.Multiply(a, b, &r2) && r1 == r2;
+                same = same && pCalc->Divide(a, b, &r1) == direct.Divide(a, b, &r2) && r1 == r2;
+            }
+        }
+        cout << "直接调用与 COM 调用: " << (same ? "结果一致" : "结果不一致！") << "\n" << endl;
+        allPassed = allPassed && same;
+    }
+
     // ========================================
     // 步骤 4: 测试 QueryInterface
     // ========================================
     cout << "【步骤 4】测试 QueryInterface\n" << endl;
 
-    IUnknown* pUnk = nullptr;
-    hr = pCalc->QueryInterface(IID_IUnknown, (void**)&pUnk);
-    if (SUCCEEDED(hr) && pUnk)
+    ComPtr<IUnknown> pUnk = pCalc.As<IUnknown>();  // 类型化的 QueryInterface
+    if (pUnk)
     {
         cout << "成功获取 IUnknown 接口\n" << endl;
-        pUnk->Release();  // 释放 IUnknown 接口
+
+        // 诊断接口是 tear-off：请求时才创建，对它请求 IUnknown 得到的仍是同一个对象
+        ICalculatorDiagnostics* pDiag = nullptr;
+        if (SUCCEEDED(pCalc->QueryInterface(IID_ICalculatorDiagnostics, (void**)&pDiag)))
+        {
+            ULONG refs = 0;
+            const char* kernel = nullptr;
+            IUnknown* pUnk2 = nullptr;
+            pDiag->GetRefCount(&refs);
+            pDiag->GetBatchKernel(&kernel);
+            pDiag->QueryInterface(IID_IUnknown, (void**)&pUnk2);
+            cout << "\n诊断接口: RefCount = " << refs << ", 批量内核 " << kernel
+                 << ", IUnknown " << (pUnk2 == pUnk.Get() ? "相同" : "不同！") << endl;
+            cout << "对象大小: " << sizeof(Calculator) << " 字节（诊断接口不占虚表指针）\n" << endl;
+            if (pUnk2) pUnk2->Release();
+            pDiag->Release();
+        }
+        pUnk.Reset();  // 释放 IUnknown 接口
     }
 
     // ========================================
-    // 步骤 5: 释放对象
+    // 步骤 5: 测试 IBatchCalculator（批量运算）
     // ========================================
-    cout << "【步骤 5】释放对象\n" << endl;
+    cout << "【步骤 5】测试 IBatchCalculator\n" << endl;
+
+    IBatchCalculator* pBatch = nullptr;
+    hr = pCalc->QueryInterface(IID_IBatchCalculator, (void**)&pBatch);
+    if (SUCCEEDED(hr) && pBatch)
+    {
+        int xs[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+        int ys[] = { 10, 20, 30, 40, 50, 60, 70, 80, 90, 100 };
+        int zs[10] = {};
+
+        pBatch->AddN(xs, ys, zs, 10);  // 一次调用完成 10 次加法
+        cout << "结果:";
+        for (int z : zs) cout << " " << z;
+        cout << "\n" << endl;
+
+        // 同一个除数：准备一次，之后只做乘法和移位（IBatchCalculator2）
+        IBatchCalculator2* pBatch2 = nullptr;
+        if (SUCCEEDED(pBatch->QueryInterface(IID_IBatchCalculator2, (void**)&pBatch2)) && pBatch2)
+        {
+            BatchDivisor by7;
+            hr = pBatch2->PrepareDivisor(-7, &by7);
+            bool divideOk = hr == S_OK;
+            pBatch2->DivideByN(ys, &by7, zs, 10);
+            cout << "除以 -7:";
+            for (int i = 0; i < 10; ++i)
+            {
+                cout << " " << zs[i];
+                divideOk = divideOk && zs[i] == ys[i] / -7;
+            }
+            cout << endl;
+            hr = pBatch2->PrepareDivisor(0, &by7);
+            cout << "除数 0: " << (hr == E_INVALIDARG ? "E_INVALIDARG" : "意外结果") << "\n" << endl;
+            allPassed = allPassed && divideOk && hr == E_INVALIDARG;
+            pBatch2->Release();
+        }
+        else
+        {
+            allPassed = false;
+        }
+
+        pBatch->Release();
+    }
+
+    cout << "校验 SIMD 内核:" << endl;
+    bool kernelsOk = VerifyBatchKernels();
+    cout << (kernelsOk ? "全部通过\n" : "存在错误！\n") << endl;
+    allPassed = allPassed && kernelsOk;
+
+    // ========================================
+    // 步骤 6: 测试 IAsyncCalculator（异步运算）
+    // ========================================
+    cout << "【步骤 6】测试 IAsyncCalculator\n" << endl;
+
+    IAsyncCalculator* pAsync = nullptr;
+    hr = pCalc->QueryInterface(IID_IAsyncCalculator, (void**)&pAsync);
+    if (SUCCEEDED(hr) && pAsync)
+    {
+        IAsyncCall* pCall = nullptr;
+        bool divideOk = false;
+        if (SUCCEEDED(pAsync->DivideAsync(100, 0, &pCall)))
+        {
+            int result = 0;
+            hr = pCall->Wait(&result);  // 除零错误在完成时返回
+            divideOk = hr == E_INVALIDARG;
+            cout << "100 / 0 (异步): " << (divideOk ? "E_INVALIDARG" : "意外结果") << endl;
+            pCall->Release();
+        }
+
+        int value = AddThenMultiply(pAsync, 2, 3, 4).Get();
+        cout << "(2 + 3) * 4 (协程): " << value << (value == 20 ? "" : "（应为 20）") << "\n" << endl;
+        allPassed = allPassed && divideOk && value == 20;
+        pAsync->Release();
+    }
+    else
+    {
+        allPassed = false;
+    }
+
+    // ========================================
+    // 步骤 7: 测试 IExpressionCalculator（表达式）
+    // ========================================
+    cout << "【步骤 7】测试 IExpressionCalculator\n" << endl;
+
+    IExpressionCalculator* pExpr = nullptr;
+    hr = pCalc->QueryInterface(IID_IExpressionCalculator, (void**)&pExpr);
+    if (SUCCEEDED(hr) && pExpr)
+    {
+        // 编译一次，之后每次求值只有一次调用
+        IExpression* pFormula = nullptr;
+        if (SUCCEEDED(pExpr->Compile("(x + 3) * y - x / 7", &pFormula)))
+        {
+            int vars[] = { 10, 2 };
+            hr = pFormula->Evaluate(vars, 2, &result);
+            cout << "(x + 3) * y - x / 7, x = 10, y = 2: " << result << endl;
+            allPassed = allPassed && hr == S_OK && result == 25;
+
+            // 列式求值：整列一起算，除数为 0 的行单独标记，不影响其他行
+            pFormula->Release();
+            pExpr->Compile("x / y", &pFormula);
+            int xs[] = { 10, 20, 30, 40 };
+            int ys[] = { 2, 0, 3, 0 };
+            const int* columns[] = { xs, ys };
+            int out[4];
+            unsigned char errors[4];
+            size_t failed = 0;
+            hr = pFormula->EvaluateColumns(columns, 2, 4, out, errors, &failed);
+            cout << "x / y 列式求值:";
+            for (int i = 0; i < 4; ++i) cout << " " << (errors[i] ? "失败" : to_string(out[i]));
+            cout << "（" << (hr == S_FALSE ? "S_FALSE" : "S_OK") << ", 失败 " << failed << " 行）" << endl;
+            bool columnsOk = hr == S_FALSE && failed == 2
+                && out[0] == 5 && out[2] == 10 && out[1] == 0 && out[3] == 0
+                && !errors[0] && errors[1] && !errors[2] && errors[3];
+
+            // 超过一个分块的列，逐行对照直接计算的结果
+            const size_t rows = 100000;
+            vector<int> bigX(rows), bigY(rows), bigOut(rows);
+            vector<unsigned char> bigErrors(rows);
+            size_t expectFailed = 0;
+            for (size_t i = 0; i < rows; ++i)
+            {
+                bigX[i] = (int)i * 3 - 50000;
+                bigY[i] = (int)(i % 7) - 3;
+                if (bigY[i] == 0) ++expectFailed;
+            }
+            const int* bigColumns[] = { bigX.data(), bigY.data() };
+            hr = pFormula->EvaluateColumns(bigColumns, 2, rows, bigOut.data(), bigErrors.data(), &failed);
+            bool bigOk = hr == S_FALSE && failed == expectFailed;
+            for (size_t i = 0; i < rows && bigOk; ++i)
+            {
+                bool isZero = bigY[i] == 0;
+                bigOk = (bigErrors[i] != 0) == isZero && (isZero || bigOut[i] == bigX[i] / bigY[i]);
+            }
+            cout << "x / y 列式求值 " << rows << " 行: " << (bigOk ? "结果正确" : "结果错误！") << endl;
+            allPassed = allPassed && columnsOk && bigOk;
+            pFormula->Release();
+        }
+        else
+        {
+            allPassed = false;
+        }
+
+        // 常量部分在编译时折叠，除数为常数 0 在编译时报错
+        hr = pExpr->Evaluate("2 * (3 + 4) - 1", nullptr, 0, &result);
+        cout << "2 * (3 + 4) - 1: " << result << endl;
+        allPassed = allPassed && hr == S_OK && result == 13;
+        hr = pExpr->Evaluate("x / (2 - 2)", nullptr, 0, &result);
+        cout << "x / (2 - 2): " << (hr == E_INVALIDARG ? "E_INVALIDARG" : "意外结果") << "\n" << endl;
+        allPassed = allPassed && hr == E_INVALIDARG;
+        pExpr->Release();
+    }
+    else
+    {
+        allPassed = false;
+    }
+
+    // ========================================
+    // 步骤 8: 测试单线程套间（跨线程代理）
+    // ========================================
+    cout << "【步骤 8】测试单线程套间\n" << endl;
+    {
+        Apartment sta;
+        ICalculator* pProxy = nullptr;
+        if (SUCCEEDED(sta.CreateInstance(CLSID_Calculator, IID_ICalculator, (void**)&pProxy)))
+        {
+            // 4 个线程共用同一个代理，调用都在套间线程上执行
+            vector<thread> threads;
+            vector<long long> sums(4, 0);
+            for (int t = 0; t < 4; ++t)
+            {
+                threads.emplace_back([pProxy, &sums, t] {
+                    for (int i = 0; i < 25; ++i)
+                    {
+                        int r = 0;
+                        pProxy->Add(i, t, &r);
+                        sums[t] += r;
+                    }
+                });
+            }
+            for (thread& th : threads) th.join();
+
+            long long total = 0;
+            for (long long s : sums) total += s;
+            ApartmentStats st = sta.GetStats();
+            cout << "\n4 个线程各调用 25 次 Add, 总和: " << total << " (应为 1350)" << endl;
+            cout << "套间线程: 调用 " << st.calls << ", 批次 " << st.batches << ", 唤醒 " << st.wakes << "\n" << endl;
+            allPassed = allPassed && total == 1350;
+            pProxy->Release();  // 真实对象在套间线程上释放
+        }
+        else
+        {
+            allPassed = false;
+        }
+    }
+
+    // ========================================
+    // 步骤 9: 释放对象
+    // ========================================
+    cout << "【步骤 9】释放对象\n" << endl;
+
+#if COM_ENABLE_STATS
+    // 释放之前看一下入口函数的统计（整个模块的数据，任何一个对象上查询都一样）
+    if (ComPtr<IStatistics> pStats = pCalc.As<IStatistics>())
+    {
+        CallStats stats[Stat_Count];
+        size_t count = 0;
+        pStats->GetSnapshot(stats, Stat_Count, &count);
+        cout << "\n入口函数统计（耗时每 " << Statistics::kSampleInterval << " 次取样一次）:" << endl;
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (stats[i].calls == 0) continue;
+            if (stats[i].samples == 0)
+            {
+                printf("  %-24s %6llu 次  未取样\n", stats[i].name, (unsigned long long)stats[i].calls);
+                continue;
+            }
+            printf("  %-24s %6llu 次  平均 %8.0f ns  p50 %8.0f ns  p99 %8.0f ns\n", stats[i].name,
+                   (unsigned long long)stats[i].calls, stats[i].meanNs, stats[i].p50Ns, stats[i].p99Ns);
+        }
+        cout << endl;
+    }
+#endif
+
+    pCalc.Reset();         // 释放 Calculator 对象
+    pFactory.Reset();      // 释放类工厂
+
+#if COM_ENABLE_REFPROFILE
+    RefProfiler::Stop();
+    cout << "\n引用计数剖析:" << endl;
+    RefProfiler::PrintReport(stdout, 5);
+    if (argc > 1)
+        cout << (RefProfiler::WriteTrace(argv[1]) ? "时间线已写入 " : "无法写入 ") << argv[1] << endl;
+#else
+    (void)argc;
+    (void)argv;
+#endif
 
-    pCalc->Release();      // 释放 Calculator 对象
-    pFactory->Release();   // 释放类工厂
+    // Calculator 的内存来自对象池，释放后块留在池里供下次使用
+    PoolStats stats = GetCalculatorPoolStats();
+    cout << "\n对象池: 使用中 " << stats.inUse << " / 容量 " << stats.capacity
+         << ", 峰值 " << stats.highWater << ", slab " << stats.slabs << endl;
 
     cout << "\n========================================" << endl;
-    cout << "程序执行完毕" << endl;
+    cout << (allPassed ? "程序执行完毕" : "程序执行完毕（有校验失败）") << endl;
     cout << "========================================\n" << endl;
 
+#ifdef _WIN32
     system("pause");
-    return 0;
+#endif
+    return allPassed ? 0 : 1;
 }
 
 /*
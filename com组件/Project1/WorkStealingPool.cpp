@@ -0,0 +1,322 @@
+// WorkStealingPool.cpp - 工作窃取线程池实现
+#include "WorkStealingPool.h"
+#include "ComModule.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#define CPU_RELAX() _mm_pause()
+#else
+#define CPU_RELAX() std::this_thread::yield()
+#endif
+
+namespace
+{
+    // Chase-Lev 双端队列（固定容量）
+    // 所有者：Push/Pop 在 bottom 端；窃取者：Steal 在 top 端，用 CAS 竞争
+    // 只剩最后一个元素时所有者和窃取者都通过 top 上的 CAS 决出归属
+    class WorkDeque
+    {
+    private:
+        static const int64_t kMask = (int64_t)WorkStealingPool::kDequeCapacity - 1;
+        static_assert((WorkStealingPool::kDequeCapacity & (WorkStealingPool::kDequeCapacity - 1)) == 0,
+            "deque capacity must be a power of two");
+
+        alignas(64) std::atomic<int64_t> m_top{ 0 };     // 窃取端
+        alignas(64) std::atomic<int64_t> m_bottom{ 0 };  // 所有者端
+        std::atomic<PoolTask*> m_slots[WorkStealingPool::kDequeCapacity];
+
+    public:
+        // 只能由所有者调用；满了返回 false
+        bool Push(PoolTask* task)
+        {
+            int64_t b = m_bottom.load(std::memory_order_relaxed);
+            int64_t t = m_top.load(std::memory_order_acquire);
+            if (b - t > kMask) return false;
+
+            m_slots[b & kMask].store(task, std::memory_order_relaxed);
+            // seq_cst：与准备睡眠的线程对 HasWork 的检查构成 Dekker 式配对，不会漏掉唤醒
+            m_bottom.store(b + 1, std::memory_order_seq_cst);
+            return true;
+        }
+
+        // 只能由所有者调用（LIFO）
+        PoolTask* Pop()
+        {
+            int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+            m_bottom.store(b, std::memory_order_seq_cst);  // 先占住队尾，再看 top
+            int64_t t = m_top.load(std::memory_order_seq_cst);
+
+            if (t > b)  // 空
+            {
+                m_bottom.store(b + 1, std::memory_order_relaxed);
+                return nullptr;
+            }
+
+            PoolTask* task = m_slots[b & kMask].load(std::memory_order_relaxed);
+            if (t == b)  // 最后一个元素，可能和窃取者竞争
+            {
+                if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                    task = nullptr;  // 被偷走了
+                m_bottom.store(b + 1, std::memory_order_relaxed);
+            }
+            return task;
+        }
+
+        // 任意线程调用（FIFO）；竞争失败也返回 nullptr
+        PoolTask* Steal()
+        {
+            int64_t t = m_top.load(std::memory_order_seq_cst);
+            int64_t b = m_bottom.load(std::memory_order_seq_cst);
+            if (t >= b) return nullptr;
+
+            PoolTask* task = m_slots[t & kMask].load(std::memory_order_relaxed);
+            if (!m_top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                return nullptr;
+            return task;
+        }
+
+        bool Empty() const
+        {
+            return m_bottom.load(std::memory_order_seq_cst) <= m_top.load(std::memory_order_seq_cst);
+        }
+    };
+
+    // 只有所属线程写，其他线程读统计值
+    inline void Bump(std::atomic<uint64_t>& counter, uint64_t n = 1)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+}
+
+struct alignas(64) WorkStealingPool::Worker
+{
+    WorkDeque   deque;
+    std::thread thread;
+    unsigned    index;
+    uint32_t    rng;  // 选择窃取对象的随机数状态
+
+    std::atomic<uint64_t> executed{ 0 };
+    std::atomic<uint64_t> stolen{ 0 };
+    std::atomic<uint64_t> injected{ 0 };
+    std::atomic<uint64_t> sleeps{ 0 };
+};
+
+static thread_local WorkStealingPool* t_pool = nullptr;
+static thread_local void*             t_worker = nullptr;
+
+// 多核时空闲线程先自旋一会儿再睡眠，单核上自旋只会拖慢提交者
+static const unsigned s_spinCount = std::thread::hardware_concurrency() > 1 ? 256 : 0;
+
+
+WorkStealingPool::WorkStealingPool(unsigned threadCount)
+    : m_injectHead(nullptr)
+    , m_injectTail(nullptr)
+    , m_injectCount(0)
+    , m_wakeSeq(0)
+    , m_sleeping(0)
+    , m_stop(false)
+{
+    if (threadCount == 0) threadCount = std::thread::hardware_concurrency();
+    if (threadCount == 0) threadCount = 4;
+
+    m_workers.resize(threadCount);
+    for (unsigned i = 0; i < threadCount; ++i)
+    {
+        m_workers[i] = new Worker;
+        m_workers[i]->index = i;
+        m_workers[i]->rng = 0x9E3779B9u * (i + 1);
+    }
+    // 全部 Worker 创建好之后再启动线程，窃取时遍历的数组不再变化
+    ComModule::Pin();  // 工作线程运行的是本模块的代码
+    for (Worker* w : m_workers)
+        w->thread = std::thread([this, w] { WorkerMain(w); });
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    m_stop.store(true, std::memory_order_seq_cst);
+    m_wakeSeq.fetch_add(1, std::memory_order_seq_cst);
+    m_wakeSeq.notify_all();
+
+    // 先全部 join 再释放：还在运行的线程可能正在窃取别的 Worker 的 deque
+    for (Worker* w : m_workers) w->thread.join();
+    for (Worker* w : m_workers) delete w;
+}
+
+WorkStealingPool& WorkStealingPool::Default()
+{
+    // 故意不销毁：进程退出时可能还有异步调用在途
+    static WorkStealingPool* pool = new WorkStealingPool();
+    return *pool;
+}
+
+void WorkStealingPool::Submit(PoolTask* task)
+{
+    task->next = nullptr;
+
+    // 工作线程上提交（例如协程在工作线程上恢复后发起的下一个调用）：放进自己的 deque
+    if (t_pool == this && static_cast<Worker*>(t_worker)->deque.Push(task))
+    {
+        WakeWorkers(1);  // 有空闲线程时让它来偷
+        return;
+    }
+    SubmitList(task, task, 1);
+}
+
+void WorkStealingPool::SubmitList(PoolTask* head, PoolTask* tail, size_t count)
+{
+    if (!head || count == 0) return;
+    tail->next = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_injectLock);
+        if (m_injectTail) m_injectTail->next = head;
+        else m_injectHead = head;
+        m_injectTail = tail;
+        m_injectCount.fetch_add(count, std::memory_order_seq_cst);
+    }
+    WakeWorkers(count);
+}
+
+void WorkStealingPool::WakeWorkers(size_t count)
+{
+    // 没有线程睡眠时不做任何系统调用
+    if (m_sleeping.load(std::memory_order_seq_cst) == 0) return;
+
+    m_wakeSeq.fetch_add(1, std::memory_order_seq_cst);
+    if (count > 1) m_wakeSeq.notify_all();
+    else m_wakeSeq.notify_one();
+}
+
+PoolCounters WorkStealingPool::GetCounters() const
+{
+    PoolCounters c = {};
+    for (const Worker* w : m_workers)
+    {
+        c.executed += w->executed.load(std::memory_order_relaxed);
+        c.stolen += w->stolen.load(std::memory_order_relaxed);
+        c.injected += w->injected.load(std::memory_order_relaxed);
+        c.sleeps += w->sleeps.load(std::memory_order_relaxed);
+    }
+    return c;
+}
+
+bool WorkStealingPool::HasWork() const
+{
+    if (m_injectCount.load(std::memory_order_seq_cst) != 0) return true;
+    for (const Worker* w : m_workers)
+    {
+        if (!w->deque.Empty()) return true;
+    }
+    return false;
+}
+
+PoolTask* WorkStealingPool::TakeInjected(Worker* self)
+{
+    if (m_injectCount.load(std::memory_order_relaxed) == 0) return nullptr;
+
+    PoolTask* head;
+    size_t taken = 1;
+    {
+        std::lock_guard<std::mutex> lock(m_injectLock);
+        head = m_injectHead;
+        if (!head) return nullptr;
+
+        PoolTask* last = head;
+        while (taken < kInjectBatch && last->next)
+        {
+            last = last->next;
+            ++taken;
+        }
+        m_injectHead = last->next;
+        if (!m_injectHead) m_injectTail = nullptr;
+        last->next = nullptr;
+        m_injectCount.fetch_sub(taken, std::memory_order_seq_cst);
+    }
+    Bump(self->injected, taken);
+
+    // 第一个自己执行，其余放进自己的 deque（其他线程可以来偷）
+    PoolTask* rest = head->next;
+    while (rest)
+    {
+        PoolTask* next = rest->next;
+        if (!self->deque.Push(rest))
+        {
+            SubmitList(rest, rest, 1);  // deque 满了（极少见），放回注入队列
+        }
+        rest = next;
+    }
+    if (taken > 1) WakeWorkers(taken - 1);
+    return head;
+}
+
+PoolTask* WorkStealingPool::Steal(Worker* self)
+{
+    size_t n = m_workers.size();
+    if (n < 2) return nullptr;
+
+    // xorshift 随机选起点，避免所有空闲线程都去偷同一个
+    self->rng ^= self->rng << 13;
+    self->rng ^= self->rng >> 17;
+    self->rng ^= self->rng << 5;
+    size_t start = self->rng % n;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        Worker* victim = m_workers[(start + i) % n];
+        if (victim == self) continue;
+        if (PoolTask* task = victim->deque.Steal())
+        {
+            Bump(self->stolen);
+            return task;
+        }
+    }
+    return nullptr;
+}
+
+PoolTask* WorkStealingPool::FindWork(Worker* self)
+{
+    if (PoolTask* task = self->deque.Pop()) return task;
+    if (PoolTask* task = TakeInjected(self)) return task;
+    return Steal(self);
+}
+
+void WorkStealingPool::WorkerMain(Worker* self)
+{
+    t_pool = this;
+    t_worker = self;
+
+    for (;;)
+    {
+        if (PoolTask* task = FindWork(self))
+        {
+            task->run(task);
+            Bump(self->executed);
+            continue;
+        }
+
+        // 短暂自旋：新任务通常很快就会到来，省掉一次睡眠/唤醒
+        bool found = false;
+        for (unsigned i = 0; i < s_spinCount && !found; ++i)
+        {
+            CPU_RELAX();
+            found = HasWork();
+        }
+        if (found) continue;
+
+        if (m_stop.load(std::memory_order_acquire))
+        {
+            if (!HasWork()) return;  // 已提交的任务全部执行完才退出
+            continue;
+        }
+
+        // 睡眠前先登记，再检查一次；提交者先放任务再看登记数（两边都是 seq_cst），不会漏唤醒
+        uint32_t seq = m_wakeSeq.load(std::memory_order_seq_cst);
+        m_sleeping.fetch_add(1, std::memory_order_seq_cst);
+        if (!HasWork() && !m_stop.load(std::memory_order_seq_cst))
+        {
+            Bump(self->sleeps);
+            m_wakeSeq.wait(seq, std::memory_order_seq_cst);
+        }
+        m_sleeping.fetch_sub(1, std::memory_order_seq_cst);
+    }
+}
@@ -0,0 +1,81 @@
+// WorkStealingPool.h - 工作窃取线程池
+// =====================================================
+// 异步调用（IAsyncCalculator）在这里执行：
+//   - 每个工作线程有自己的双端队列（Chase-Lev 无锁 deque）：
+//     本线程从队尾压入/弹出（LIFO，缓存友好），其他空闲线程从队头窃取（FIFO）
+//   - 非工作线程提交的任务进入全局注入队列，工作线程一次取走一批（最多 kInjectBatch 个），
+//     第一个自己执行，其余放进自己的 deque 供别的线程窃取
+//   - 没有任务时先短暂自旋，再在原子变量上睡眠；提交者只在确实有线程睡眠时才唤醒
+//
+// 任务是侵入式的（PoolTask 嵌在调用对象里），提交和执行都不分配内存
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 任务：嵌入到具体的调用对象中，run 负责执行并处理自己的生命周期
+struct PoolTask
+{
+    void     (*run)(PoolTask* self);
+    PoolTask* next;  // 注入队列和批量提交时的链表指针
+};
+
+// 线程池统计（近似值：计数器由各工作线程独立累加）
+struct PoolCounters
+{
+    uint64_t executed;  // 执行的任务数
+    uint64_t stolen;    // 从其他线程窃取的任务数
+    uint64_t injected;  // 从注入队列取走的任务数
+    uint64_t sleeps;    // 进入睡眠的次数
+};
+
+class WorkStealingPool
+{
+public:
+    static const size_t kDequeCapacity = 4096;  // 每个 deque 的容量（满了改放注入队列）
+    static const size_t kInjectBatch = 32;      // 一次从注入队列取走的最大任务数
+
+    // threadCount 为 0 时使用 CPU 核数
+    explicit WorkStealingPool(unsigned threadCount = 0);
+    ~WorkStealingPool();  // 执行完已提交的任务后退出
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // 提交一个任务；在本池的工作线程上调用时直接放进自己的 deque
+    void Submit(PoolTask* task);
+
+    // 一次提交一串任务（通过 next 连接，共 count 个），只加一次锁、只唤醒一次
+    void SubmitList(PoolTask* head, PoolTask* tail, size_t count);
+
+    unsigned WorkerCount() const { return (unsigned)m_workers.size(); }
+    PoolCounters GetCounters() const;
+
+    // 进程级默认线程池（故意不销毁）
+    static WorkStealingPool& Default();
+
+private:
+    struct Worker;
+
+    void WorkerMain(Worker* self);
+    PoolTask* FindWork(Worker* self);
+    PoolTask* TakeInjected(Worker* self);
+    PoolTask* Steal(Worker* self);
+    bool HasWork() const;
+    void WakeWorkers(size_t count);
+
+    std::vector<Worker*> m_workers;
+
+    // 注入队列（FIFO 链表）
+    std::mutex          m_injectLock;
+    PoolTask*           m_injectHead;
+    PoolTask*           m_injectTail;
+    std::atomic<size_t> m_injectCount;
+
+    std::atomic<uint32_t> m_wakeSeq;   // 睡眠线程在它上面等待，唤醒时加一
+    std::atomic<uint32_t> m_sleeping;  // 正在睡眠（或准备睡眠）的线程数
+    std::atomic<bool>     m_stop;
+};
@@ -2,6 +2,7 @@
 // =====================================================
 
 #include "SimpleCOM.h"  // 包含 COM 组件的接口定义
+#include "ComLog.h"     // 组件的调试日志
 #include <iostream>     // 用于控制台输出
 #include <Windows.h>    // Windows API
 
@@ -76,6 +77,10 @@ int main()
     // 首先设置控制台为 UTF-8 编码，以正确显示中文
     SetupConsoleUTF8();
 
+    // 组件日志默认由后台线程异步输出
+    // 演示程序改为同步输出，这样日志会和下面的提示按顺序出现
+    ComLog::SetSynchronous(true);
+
     cout << "\n============================================" << endl;
     cout << "     最简单的 COM 组件学习示例" << endl;
     cout << "     Simple COM Component Tutorial" << endl;
@@ -173,6 +178,7 @@ int main()
 
     // 当我们不再需要 COM 对象时，必须调用 Release
     // 这是 COM 编程的重要规则：谁调用了 AddRef/QueryInterface，谁就要调用 Release
+    // 这里手动调用是为了演示规则；实际代码用 ComPtr（见 ComPtr.h）在离开作用域时自动释放
     if (pCalculator != nullptr)
     {
         cout << "调用 Release 释放接口指针" << endl;